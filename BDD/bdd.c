@@ -28,58 +28,31 @@ extern int memlimit;
 
 struct stat_record_ stat_record[BDD_STAT_INDEX_SIZE];
 
-boolean table_has_been_doubled;
-
 
 /* if something is cached for (p, q), then return it; otherwise, return
    0.  In any case, set *h to the hash value calculated) */
 
 static GNUC_INLINE unsigned lookup_cache(bdd_manager *bddm, unsigned *h,
 				  unsigned p, unsigned q)  {
-  unsigned temp, res;
-   cache_record *cache_ptr;
 #ifdef _BDD_STAT_
     bddm->number_lookup_cache++;
 #endif
   *h = HASH2(p, q, bddm->cache_mask); 
-  cache_ptr = &bddm->cache[*h];
-  CACHE_LOOKUP_RECORD(bddm, (*cache_ptr), p, q, res, temp);
-  return (res);
+  return (CACHE_LOOKUP_RECORD(bddm->cache[*h], p, q));
 }
 
-/* insert in cache, while calculating cache value.  Note: bddm->cache
-   may change during this operation */
+/* insert in cache, replacing what was there */
 GNUC_INLINE void insert_cache(bdd_manager *bddm, unsigned h, 
 			      unsigned p, unsigned q, unsigned res){
-  unsigned temp;
-  unsigned p_, q_, r_;
-
  cache_record *cache_ptr = &bddm->cache[h];
 
 #ifdef _BDD_STAT_
     bddm->number_insert_cache++;
+    if (CACHE_FULL_RECORD(*cache_ptr))
+      bddm->number_cache_collissions++;
 #endif
 
-  if (!CACHE_FULL_BIN0((*cache_ptr)))  
-      {CACHE_STORE_BIN0((*cache_ptr), p, q, res);} 
-  else if (!CACHE_FULL_BIN1((*cache_ptr)))  
-      {CACHE_STORE_BIN1((*cache_ptr), p, q, res);} 
-  else {	 
-#ifdef _BDD_STAT_
-    bddm->number_cache_collissions++;
-#endif
-    CACHE_NEW_RECORD(bddm, temp); 
-    cache_ptr = &bddm->cache[h]; /*since preceding creation of record
-			           may have changed bddm->cache*/
-    CACHE_LOAD_BIN0((*cache_ptr), p_, q_, r_);
-    CACHE_STORE_BIN0(bddm->cache[temp], p_, q_, r_); 
-    CACHE_LOAD_BIN1((*cache_ptr), p_, q_, r_);
-    CACHE_STORE_BIN1(bddm->cache[temp], p_, q_, r_); 
-    CACHE_STORE_BIN0((*cache_ptr), p, q, res); 
-    CACHE_CLEAR_BIN1((*cache_ptr));
-    bddm->cache[temp].next = (*cache_ptr).next; 
-    cache_ptr->next = temp;
-  }
+  CACHE_STORE_RECORD(*cache_ptr, p, q, res);
 }
 
 
@@ -87,7 +60,7 @@ GNUC_INLINE void insert_cache(bdd_manager *bddm, unsigned h,
 
 unsigned bdd_ifindex(bdd_manager *bddm, unsigned p) {
   unsigned index;
-  LOAD_index(&bddm->node_table[p], index);
+  LOAD_index_seen(bddm, &bddm->node_table[p], index);
   return (index);
 }
 
@@ -155,111 +128,63 @@ GNUC_INLINE unsigned bdd_find_node_hashed(bdd_manager *bddm,
 					  void (*update_fn)(unsigned 
 							    (*new_place)(unsigned node))) {
   unsigned h;
-  bdd_record *ptr;
-  unsigned i0, i1;
+  bdd_record *ptr, *home;
+  unsigned key[BDD_LRI_WORDS];
   unsigned i;
-  unsigned temp;
 
-  table_has_been_doubled = FALSE;
+  bdd_current_context()->table_has_been_doubled = FALSE;
 
 start: 
  
-  h = HASH3(l, r, indx, bddm->table_mask) +  BDD_NUMBER_OF_BINS;
-  ptr = &bddm->node_table[h];
-  TWO_UNS_STR_lri(i0, i1, l, r, indx);
+  h = HASH3(l, r, indx, bddm->table_mask);
+  home = &bddm->node_table[BDD_FIRST_NODE + (h << BDD_LOG_NODES_PER_LINE)];
+  KEY_lri(key, l, r, indx);
   
-  /*look in primary bucket indicated by hash function*/
-  for (i = BDD_NUMBER_OF_BINS; i--; ) {
-    if (LOAD_r(ptr + i) == BDD_UNUSED) {
-      goto insert_in_existing;
-    } else {
-      if (i0 == (ptr + i)->lri[0] && i1 == (ptr + i)->lri[1]) {      
-	return (h + i);
+  /*look in the line indicated by hash function and then in the
+    following ones, until the node or a free record is found; the
+    table is never full, so this terminates*/
+  for (;;) {
+    ptr = &bddm->node_table[BDD_FIRST_NODE + (h << BDD_LOG_NODES_PER_LINE)];
+    for (i = 0; i < BDD_NODES_PER_LINE; i++) {
+      if (LOAD_r(ptr + i) == BDD_UNUSED) {
+	goto insert;
+      } else {
+	if (MATCH_KEY_lri(ptr + i, key)) {
+	  return ((ptr - bddm->node_table) + i);
+	}
       }
     }
-  }
-  
-  /*now look in overflow area*/
-  for (temp = ptr->next; temp; temp = bddm->node_table[temp].next) {
 #ifdef _BDD_STAT_
-    bddm->number_node_link_followed++;
+    bddm->number_node_probes++;
 #endif
-    ptr = &bddm->node_table[temp];
-    for (i = BDD_NUMBER_OF_BINS; i--; ) {
-      if (LOAD_r(ptr + i) == BDD_UNUSED) {  
-	goto insert_in_existing;
-      }
-      else if (i0 == (ptr + i)->lri[0] && i1 == (ptr + i)->lri[1]) { 
-	return (temp + i);
-      }
-    }
+    h = (h + 1) & bddm->table_mask;
   }
 
-  goto insert_in_new_bucket;
-
+  /*we didn't find the node, but found an available record*/
+insert:
 
-  /*we didn't find the node, but found an available bin*/
-insert_in_existing:
-
-  bddm->table_elements++;
-  
-  (ptr + i)->lri[0] = i0;
-  (ptr + i)->lri[1] = i1;
-  (ptr + i)->mark = 0;
-  return ((ptr - bddm->node_table) + i);
-
-  /*no room; create a new bucket in overflow area*/
-insert_in_new_bucket:
-
-
-#ifdef _BDD_STAT_
-  bddm->number_node_collissions++;
-#endif
-   
   /*but first check that table is not too full to warrant doubling*/
-  if (bddm->table_elements > bddm->table_double_trigger) {
+  if (bddm->table_elements >= bddm->table_double_trigger) {
 /*    printf("double_table_and_cache_hashed called:\n"); */
     /*only change  l and r if node is not a leaf*/
     double_table_and_cache_hashed(bddm, some_roots, update_fn,
 				  &l, &r, (indx != BDD_LEAF_INDEX));
     /*now nodes l and r are possibly to be found in new places, and we
       should use quite a different primary bucket, so...*/
-    table_has_been_doubled = TRUE;
+    bdd_current_context()->table_has_been_doubled = TRUE;
     goto start;
   }
- 
 
-  /*and check that overflow area is big enough; be careful with ptr,
-    which should be pointing to same indexed position even if
-    node_table is moved */
-  if (bddm->table_overflow + BDD_NUMBER_OF_BINS > bddm->table_total_size) {
-    unsigned ptr_as_index = ptr - bddm->node_table;
-    bddm->table_total_size += bddm->table_overflow_increment;
-    bddm->node_table = mem_resize(bddm->node_table, 
-					(size_t) (sizeof (bdd_record))
-					* bddm->table_total_size);
-    ptr = bddm->node_table + ptr_as_index;
-  }
-  /* now do the insertion */
+#ifdef _BDD_STAT_
+  if (ptr + i != home)
+    bddm->number_node_collissions++;
+#endif
 
   bddm->table_elements++;
-
-  ptr->next = bddm->table_overflow;
-
-  ptr = &bddm->node_table[bddm->table_overflow];
-  (ptr + (BDD_NUMBER_OF_BINS - 1))->lri[0] = i0;
-  (ptr + (BDD_NUMBER_OF_BINS - 1))->lri[1] = i1;
-  (ptr + (BDD_NUMBER_OF_BINS - 1))->mark = 0;
-  ptr->next = 0; /*unnecessary to initialize other next fields in
-		   same bucket as we only use the next field of the 0th*/
-
-
-  /*but mark other bins as unused*/
-  for (i = BDD_NUMBER_OF_BINS - 1; i--; ) {
-    (ptr + i)->lri[1] = BDD_UNUSED; (ptr + i)->lri[0] = BDD_UNUSED;
-  }
-  /*advance table_overflow to next available bucket*/
-  return ((bddm->table_overflow += BDD_NUMBER_OF_BINS) - 1);
+  
+  STR_KEY_lri(ptr + i, key);
+  (ptr + i)->mark = 0;
+  return ((ptr - bddm->node_table) + i);
 }
 
 
@@ -310,21 +235,19 @@ struct local_##record {\
   record *a;\
   record *a_last;\
   bdd_manager *bddm_p, *bddm_q, *bddm_r;\
-}; \
-unsigned local_##record##_in_use = 0; \
-struct local_##record *local_##record##_primary = NULL
+}
 
 #define DECLARE_POINTER_TO_LOCAL(record, pointer) \
 struct local_##record *pointer
 
 /* we keep a distinguished local record, kept through
-local_##record##_primary; usually, we can just use that one without
+ctx->local_##record##_primary; usually, we can just use that one without
 wasting time getting memory */
 
 #define NEW_LOCAL(record, local, bddm_p, bddm_q, bddm_r) \
 record *a; \
-if (local_##record##_primary && (local_##record##_in_use == 0)) \
-   local = local_##record##_primary; /* use the current one */ \
+if (ctx->local_##record##_primary && (ctx->local_##record##_in_use == 0)) \
+   local = ctx->local_##record##_primary; /* use the current one */ \
 else { \
   local = (struct local_##record *) \
      mem_alloc((size_t)(sizeof (struct local_##record))); \
@@ -332,15 +255,15 @@ else { \
   local->act_stack = (record*) \
       mem_alloc((size_t)(sizeof (record)) * local->a_size); \
   local->a_last = &(local->act_stack[local->a_size - 1]); \
-  if (!local_##record##_primary) \
-    local_##record##_primary = local; \
+  if (!ctx->local_##record##_primary) \
+    ctx->local_##record##_primary = local; \
 }; \
 local->a = local->act_stack; \
 a = local->a; \
 local->bddm_p = bddm_p; \
 local->bddm_q = bddm_q; \
 local->bddm_r = bddm_r; \
-local_##record##_in_use++
+ctx->local_##record##_in_use++
 
 #define INCREMENT_LOCAL(local) \
 if (local->a == local->a_last) { \
@@ -366,10 +289,16 @@ local->a == local->act_stack \
 local->act_stack \
 
 #define FREE_LOCAL(record,local) \
-if (local_##record##_in_use > 1) { \
+if (ctx->local_##record##_in_use > 1) { \
   mem_free(local->act_stack); \
   mem_free(local); }; \
-local_##record##_in_use--
+ctx->local_##record##_in_use--
+
+#define FREE_PRIMARY(record) \
+if (ctx->local_##record##_primary) { \
+  mem_free(ctx->local_##record##_primary->act_stack); \
+  mem_free(ctx->local_##record##_primary); \
+  ctx->local_##record##_primary = NULL; }
 
 
 
@@ -411,7 +340,7 @@ const unsigned hash_value_invalid = (unsigned) (-1);
 
 void bdd_prepare_apply1(bdd_manager *bddm) {
   bdd_record *p; 
-  for (p = &bddm->node_table[BDD_NUMBER_OF_BINS]; 
+  for (p = &bddm->node_table[BDD_FIRST_NODE]; 
        p < &bddm->node_table[bddm->table_total_size];  
        p++) {
     p->mark = 0;
@@ -427,13 +356,13 @@ typedef struct {
 /* declare the type of activation frames for apply1 */
 DECLARE_LOCAL(activation_record_apply1);
 
-/* apply1_ptr points to the current activation frame for
+/* ctx->apply1_ptr points to the current activation frame for
    an apply1 operation */
-DECLARE_POINTER_TO_LOCAL(activation_record_apply1, apply1_ptr);
-
 
 void update_activation_stack(unsigned (*new_place)(unsigned node)) {
   activation_record_apply1 *a_;
+  DECLARE_POINTER_TO_LOCAL(activation_record_apply1, apply1_ptr) =
+    bdd_current_context()->apply1_ptr;
   if (apply1_ptr->bddm_p == apply1_ptr->bddm_r) {
     for (a_ = apply1_ptr->act_stack; a_ <= apply1_ptr->a ; a_++) {   
       a_->p = new_place(a_->p);
@@ -459,6 +388,7 @@ unsigned bdd_apply1_internal(bdd_manager *bddm_p, unsigned p,
   unsigned tmp1, tmpp;
 
   bdd_record *p_table;
+  bdd_context *ctx;
 
   p_table = bddm_p->node_table; 
   node_ptr = &p_table[p];
@@ -484,13 +414,14 @@ unsigned bdd_apply1_internal(bdd_manager *bddm_p, unsigned p,
 
     DECLARE_SEQUENTIAL_LIST(intermediate, unsigned)
     
+    ctx = bdd_current_context();
     NEW_LOCAL(activation_record_apply1, local,
 	      bddm_p, bddm_p, bddm_r); /* second last argument is dummy */
 
     MAKE_SEQUENTIAL_LIST(intermediate, unsigned, 1024);
 
-    old_apply1_ptr = apply1_ptr;
-    apply1_ptr = local;
+    old_apply1_ptr = ctx->apply1_ptr;
+    ctx->apply1_ptr = local;
 
   start:
     node_ptr = &p_table[p];
@@ -504,7 +435,7 @@ unsigned bdd_apply1_internal(bdd_manager *bddm_p, unsigned p,
     if ((res = node_ptr->mark) != 0) 
       goto finish;
     else {
-      LOAD_index(node_ptr,a->index); /*get index*/ /*CACHE MISS STALL*/
+      LOAD_index_seen(bddm_p, node_ptr, a->index); /*get index*/ /*CACHE MISS STALL*/
     
       if (a->index == BDD_LEAF_INDEX) {
 	/*we are at leaf*/
@@ -556,7 +487,7 @@ unsigned bdd_apply1_internal(bdd_manager *bddm_p, unsigned p,
 	if (add_roots) {
 	  PUSH_SEQUENTIAL_LIST(bddm_r->roots, unsigned, res);
 	}
-	apply1_ptr = old_apply1_ptr;
+	ctx->apply1_ptr = old_apply1_ptr;
 	return (res);
       }
       else {
@@ -594,14 +525,14 @@ typedef struct {
 
 DECLARE_LOCAL(activation_record_apply2_hashed);
 
-/* apply2_ptr contains pointer to current activation frame
+/* ctx->apply2_ptr contains pointer to current activation frame
    of bdd_apply2_hashed */
 
-DECLARE_POINTER_TO_LOCAL(activation_record_apply2_hashed, apply2_ptr);
-
 void update_activation_stack_apply2_hashed
 (unsigned (*new_place)(unsigned node)) {
   activation_record_apply2_hashed *a_;
+  DECLARE_POINTER_TO_LOCAL(activation_record_apply2_hashed, apply2_ptr) =
+    bdd_current_context()->apply2_ptr;
   if (apply2_ptr->bddm_p == apply2_ptr->bddm_r) {
     for (a_ = apply2_ptr->act_stack; a_ <= apply2_ptr->a ; a_++) {   
       a_->p = new_place(a_->p);
@@ -635,6 +566,7 @@ unsigned bdd_apply2_hashed(bdd_manager *bddm_p, unsigned p,
   unsigned tmp1, tmpp, tmpq;
   unsigned h;
   bdd_record *p_table, *q_table;
+  bdd_context *ctx;
 
   res = lookup_cache(bddm_r, &h, p, q); /*CACHE MISS STALL*/
 
@@ -654,13 +586,14 @@ unsigned bdd_apply2_hashed(bdd_manager *bddm_p, unsigned p,
 
     DECLARE_SEQUENTIAL_LIST(intermediate, unsigned)
 
+    ctx = bdd_current_context();
     NEW_LOCAL(activation_record_apply2_hashed, local,
 		bddm_p, bddm_q, bddm_r);
 
     MAKE_SEQUENTIAL_LIST(intermediate, unsigned, 1024);
 
-    old_apply2_ptr = apply2_ptr;
-    apply2_ptr = local;
+    old_apply2_ptr = ctx->apply2_ptr;
+    ctx->apply2_ptr = local;
 
   start:
   
@@ -682,9 +615,9 @@ unsigned bdd_apply2_hashed(bdd_manager *bddm_p, unsigned p,
       q_table = bddm_q->node_table;
   
       node_ptr = &p_table[p];
-      LOAD_index(node_ptr,p_i); /*get indices*/ /*CACHE MISS STALL*/
+      LOAD_index_seen(bddm_p, node_ptr, p_i); /*get indices*/ /*CACHE MISS STALL*/
       node_ptr = &q_table[q];
-      LOAD_index(node_ptr,q_i);                 /*CACHE MISS STALL*/
+      LOAD_index_seen(bddm_q, node_ptr, q_i);                 /*CACHE MISS STALL*/
       a->p = p; /*this for later insert_cache operation*/
       a->q = q;
       a->h = h;
@@ -764,7 +697,7 @@ unsigned bdd_apply2_hashed(bdd_manager *bddm_p, unsigned p,
 	FREE_LOCAL(activation_record_apply2_hashed, local);	
 	FREE_SEQUENTIAL_LIST(intermediate);
 	PUSH_SEQUENTIAL_LIST(bddm_r->roots, unsigned, res);
-	apply2_ptr = old_apply2_ptr;
+	ctx->apply2_ptr = old_apply2_ptr;
 	return res;
       }
       else {
@@ -829,9 +762,9 @@ unsigned bdd_apply2_sequential(bdd_manager *bddm_p, unsigned p,
     q_table = bddm_q->node_table;
 
     node_ptr = &p_table[p];
-    LOAD_index(node_ptr,p_i); /*get indices*/ /*CACHE MISS STALL*/
+    LOAD_index_seen(bddm_p, node_ptr, p_i); /*get indices*/ /*CACHE MISS STALL*/
     node_ptr = &q_table[q];
-    LOAD_index(node_ptr,q_i);                 /*CACHE MISS STALL*/
+    LOAD_index_seen(bddm_q, node_ptr, q_i);                 /*CACHE MISS STALL*/
     a->inter_m = 0; /*to denote that we are 
 				descending along the left*/
     a->result_node = bdd_get_free_node_sequential(bddm_r);
@@ -923,10 +856,10 @@ typedef struct {
 
 DECLARE_LOCAL(activation_record_project);
 
-DECLARE_POINTER_TO_LOCAL(activation_record_project, apply_project_ptr);
-
 void update_activation_stack_project(unsigned (*new_place)(unsigned node)) {
   activation_record_project *a_;
+  DECLARE_POINTER_TO_LOCAL(activation_record_project, apply_project_ptr) =
+    bdd_current_context()->apply_project_ptr;
   if (apply_project_ptr->bddm_p == apply_project_ptr->bddm_r) {
     for (a_ = apply_project_ptr->act_stack; 
 	 a_ <= apply_project_ptr->a ; a_++) {   
@@ -957,6 +890,7 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
   unsigned h;
   bdd_record *p_table;
   unsigned q;
+  bdd_context *ctx;
   
   res = lookup_cache(bddm_r, &h, p, 0); /*CACHE MISS STALL*/
   if (res) {
@@ -973,13 +907,14 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
     DECLARE_POINTER_TO_LOCAL(activation_record_project, old_apply_project_ptr);
     DECLARE_SEQUENTIAL_LIST(intermediate, unsigned)
     
+    ctx = bdd_current_context();
     NEW_LOCAL(activation_record_project, local,
 	      bddm_p, bddm_p, bddm_r); /* second last argument is dummy */
 
     MAKE_SEQUENTIAL_LIST(intermediate, unsigned, 1024);
 
-    old_apply_project_ptr = apply_project_ptr;
-    apply_project_ptr = local;
+    old_apply_project_ptr = ctx->apply_project_ptr;
+    ctx->apply_project_ptr = local;
 
   
     q = 0;
@@ -988,7 +923,7 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
     p_table = bddm_p->node_table;
 
     node_ptr = &p_table[p];  
-    LOAD_index(node_ptr, a->index); /*get index*/ /*CACHE MISS STALL*/
+    LOAD_index_seen(bddm_p, node_ptr, a->index); /*get index*/ /*CACHE MISS STALL*/
     PUSH_SEQUENTIAL_LIST(intermediate, unsigned, going_left);
   
     if (q != 0) {
@@ -1021,7 +956,7 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
 	res = bdd_find_leaf_hashed(bddm_r, project_leaf_function(tmpp, tmpp), 
 				   SEQUENTIAL_LIST(intermediate),
 				   &update_activation_stack_project); 
-	apply_project_ptr = local;
+	ctx->apply_project_ptr = local;
 	if (a->h == hash_value_invalid)
 	  a->h = HASH2(a->p, a->q, bddm_r->cache_mask); 
 	insert_cache(bddm_r, a->h, a->p, 0, res);
@@ -1053,7 +988,7 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
 				   SEQUENTIAL_LIST(intermediate),
 				   &update_activation_stack_project); /*CACHE MISS STALL*/
       }
-      apply_project_ptr = local;
+      ctx->apply_project_ptr = local;
       if (a->h == hash_value_invalid)
 	a->h = HASH2(a->p, 0, bddm_r->cache_mask); 
       insert_cache(bddm_r, a->h, a->p, 0, res); /*CACHE MISS STALL*/
@@ -1071,9 +1006,9 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
       if (res) 
 	goto finish;
       else {
-	LOAD_index(node_ptr,p_i); /*get indices*/ /*CACHE MISS STALL*/
+	LOAD_index_seen(bddm_p, node_ptr, p_i); /*get indices*/ /*CACHE MISS STALL*/
 	node_ptr = &p_table[q];
-	LOAD_index(node_ptr,q_i);                 /*CACHE MISS STALL*/
+	LOAD_index_seen(bddm_p, node_ptr, q_i);                 /*CACHE MISS STALL*/
 	a->p = p; /*this for later insert_cache operation*/
 	a->h = h;
       
@@ -1086,7 +1021,7 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
 	  res = bdd_find_leaf_hashed(bddm_r, project_leaf_function(tmpp, tmpq),
 				     SEQUENTIAL_LIST(intermediate),
 				     &update_activation_stack_project); 
-	  apply_project_ptr = local;
+	  ctx->apply_project_ptr = local;
 	  if (a->h == hash_value_invalid)
 	    a->h = HASH2(a->p, a->q, bddm_r->cache_mask); 
 	  insert_cache(bddm_r, a->h, a->p, a->q, res); 
@@ -1145,7 +1080,7 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
 				   res, a->index,
 				   SEQUENTIAL_LIST(intermediate),
 				   &update_activation_stack_project); /*CACHE MISS STALL*/
-      apply_project_ptr = local;
+      ctx->apply_project_ptr = local;
       if (a->h == hash_value_invalid)
 	a->h = HASH2(a->p, a->q, bddm_r->cache_mask); 
       insert_cache(bddm_r, a->h, a->p, a->q, res); /*CACHE MISS STALL*/
@@ -1155,7 +1090,7 @@ unsigned bdd_project(bdd_manager *bddm_p, unsigned p, unsigned var_index,
 	FREE_LOCAL(activation_record_project,local);	
 	FREE_SEQUENTIAL_LIST(intermediate);
 	PUSH_SEQUENTIAL_LIST(bddm_r->roots, unsigned, res);
-	apply_project_ptr = old_apply_project_ptr;
+	ctx->apply_project_ptr = old_apply_project_ptr;
 	return res;
       }
       else {
@@ -1253,41 +1188,71 @@ void bdd_operate_on_nodes(bdd_manager *bddm_p, unsigned p,
   }
 }
 
-/* BDD_CALL_LEAFS */
+/* release the distinguished activation stacks of a context that is
+   no longer used */
 
-void (*leaf_function_global)(unsigned value);
+void bdd_free_activation_stacks(bdd_context *ctx) {
+  invariant(ctx->local_activation_record_apply1_in_use == 0 &&
+	    ctx->local_activation_record_apply2_hashed_in_use == 0 &&
+	    ctx->local_activation_record_project_in_use == 0);
+  FREE_PRIMARY(activation_record_apply1);
+  FREE_PRIMARY(activation_record_apply2_hashed);
+  FREE_PRIMARY(activation_record_project);
+}
+
+void bdd_recover_context(bdd_context *ctx) {
+  if (!ctx) {
+    bdd_context *old = bdd_use_context((bdd_context *) 0);
+    ctx = bdd_use_context(old);
+  }
+  /* the primary stacks are kept; others in use are lost */
+  ctx->local_activation_record_apply1_in_use = 0;
+  ctx->local_activation_record_apply2_hashed_in_use = 0;
+  ctx->local_activation_record_project_in_use = 0;
+  ctx->apply1_ptr = 0;
+  ctx->apply2_ptr = 0;
+  ctx->apply_project_ptr = 0;
+  ctx->old_bddm = (bdd_manager *) 0;
+}
+
+/* BDD_CALL_LEAFS */
 
 void bbd_operate_on_leaf (bdd_record *node_pointer) {
   unsigned indx, tmpp, tmp1;
   LOAD_index(node_pointer, indx); 
   if (indx == BDD_LEAF_INDEX) {
     LOAD_lr(node_pointer, tmpp, tmp1);
-    (*leaf_function_global) (tmpp);
+    (*bdd_current_context()->leaf_function) (tmpp);
   }
 }
 
 void bdd_call_leafs(bdd_manager *bddm_p, unsigned p, 
 		    void (*leaf_function)(unsigned value)) {
-  leaf_function_global = leaf_function;
+  bdd_context *ctx = bdd_current_context();
+  void (*old_leaf_function)(unsigned value) = ctx->leaf_function;
+  ctx->leaf_function = leaf_function;
   bdd_operate_on_nodes (bddm_p, p, bbd_operate_on_leaf);
+  ctx->leaf_function = old_leaf_function;
 }
 
 /* BDD_REPLACE_INDICES */
 
-unsigned *indices_map_global;
-
 void bbd_replace_index (bdd_record *node_pointer) {
   unsigned indx, l, r;
+  unsigned *indices_map = bdd_current_context()->indices_map;
   LOAD_lri(node_pointer, l, r, indx); 
   if (indx != BDD_LEAF_INDEX) {
-    invariant(indices_map_global[indx] <= BDD_MAX_INDEX);
-    STR_lri(node_pointer, l, r, indices_map_global[indx]);
+    invariant(indices_map[indx] <= BDD_MAX_INDEX);
+    STR_lri(node_pointer, l, r, indices_map[indx]);
   }
 }
 
 void bdd_replace_indices (bdd_manager *bddm_p, unsigned p, 
 			  unsigned indices_map []) {
-  indices_map_global = indices_map;
+  bdd_context *ctx = bdd_current_context();
+  invariant(!bdd_manager_renamed(bddm_p));
+  ctx->indices_map = indices_map;
+  bdd_forget_used_indices(bddm_p);
   bdd_operate_on_nodes (bddm_p, p, bbd_replace_index);
 }
 
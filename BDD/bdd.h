@@ -41,12 +41,29 @@ typedef unsigned boolean;
 #define TRUE 1
 #define FALSE 0
 
+/* a BDD node has one of two layouts, chosen when the package is
+   compiled: the packed layout keeps the children in three bytes each
+   and the index in two, whereas the wide layout (BDD_WIDE_NODES) gives
+   each of them a full word; both layouts take four words per node */
+
+#ifdef BDD_WIDE_NODES
+
+#define BDD_MAX_TOTAL_TABLE_SIZE 0x80000000
+/* = 2^31, so that doubling the table never overflows an unsigned */
+
+#define BDD_MAX_INDEX 0xfffffffe
+/* = 0xfffffffe (since 0xffffffff = BDD_LEAF_INDEX denotes a leaf) */
+
+#else
+
 #define BDD_MAX_TOTAL_TABLE_SIZE 0x1000000 
 /* = 2^24 corresponding to three bytes */
 
 #define BDD_MAX_INDEX 0xfffe
 /* = 0xfffe (since 0xffff = BDD_LEAF_INDEX denotes a leaf) */
 
+#endif
+
 /*BDD DATA STRUCTURES AND ELEMENTARY OPERATIONS*/
 
 /* convention: "left" means "low" successor (corresponding to false)
@@ -61,10 +78,15 @@ typedef unsigned bdd_ptr; /* a BDD node is identified by an unsigned
 /* macros for getting at the packed fields are given at the end of this
    file */
 struct bdd_record_ {
+#ifdef BDD_WIDE_NODES
+  unsigned lri[3]; /*left, right, and index (name of variable), each
+		     a full word*/
+#else
   unsigned lri[2]; /*left and right, of type bdd_ptr, each consists of
  		    three bytes, and index (name of variable) is
 		    a two byte an integer */
-  bdd_ptr next;   /*only the next field of 0th record in a bucket is used*/
+  unsigned align;  /*to put four records in a cache line*/
+#endif
   unsigned mark;   /*this field is used in apply1 as a bdd_ptr;it is
 		     also used in other routines such as
 		     bdd_operate_on_nodes */
@@ -77,6 +99,27 @@ typedef unsigned bdd_handle; /* an offset into the bdd_roots array */
 /* BDD MANAGER */
 
 typedef struct bdd_manager_ bdd_manager;
+
+/* ENGINE CONTEXT */
+
+/* the scratch state of the operations below (activation stacks, the
+   leaf function of bdd_call_leafs, ...) lives in a context; each
+   thread works in its own current context, which is a private default
+   one unless another has been installed with bdd_use_context, so
+   threads may operate concurrently on disjoint managers */
+
+typedef struct bdd_context_ bdd_context;
+
+extern bdd_context *bdd_new_context(void);
+extern void bdd_kill_context(bdd_context *ctx);
+/* install ctx (NULL = the thread's default context) in the calling
+   thread and return the previously installed context */
+extern bdd_context *bdd_use_context(bdd_context *ctx);
+extern bdd_context *bdd_current_context(void);
+/* forget the operations abandoned in ctx (NULL = the thread's default
+   context) when the handler of mem_error did not return; their
+   memory is lost, but the context can be used again */
+extern void bdd_recover_context(bdd_context *ctx);
  
 /* MANAGER AND CACHE */
 
@@ -85,6 +128,29 @@ extern bdd_manager *bdd_new_manager(unsigned table_size,
 
 extern void bdd_kill_manager(bdd_manager *bddm); 
 
+/* a manager may have several owners, for instance a DFA and its
+   copies, which then share all nodes; each owner releases it with
+   bdd_kill_manager, and the last one frees it; a shared manager is
+   read-only (its marks are still used, so all owners must be in the
+   same thread) */
+extern bdd_manager *bdd_share_manager(bdd_manager *bddm);
+extern int bdd_manager_shared(bdd_manager *bddm);
+
+/* instead of rewriting the nodes (see bdd_replace_indices), a manager
+   may be renamed: the operations reading it then see the index i of a
+   node as the renamed index, and bdd_apply1 stores the renamed indices
+   in the result; bdd_rename_manager composes the renaming of bddm with
+   indices_map, which must be defined for the indices seen through
+   bddm, and returns a manager seeing the composed renaming, without
+   visiting the nodes; this is bddm itself unless bddm is shared, in
+   which case it is a new view of the same nodes that takes over the
+   reference of the caller; it returns 0 and leaves bddm alone if the
+   renaming does not preserve the order of the indices; a renamed
+   manager is read-only */
+extern bdd_manager *bdd_rename_manager(bdd_manager *bddm,
+				       unsigned indices_map[]);
+extern int bdd_manager_renamed(bdd_manager *bddm);
+
 extern void bdd_make_cache(bdd_manager *bddm, unsigned size, 
 			    unsigned overflow_increment);
 
@@ -164,7 +230,7 @@ extern void bdd_call_leafs(bdd_manager *bddm, bdd_ptr p,
 			   void (*leaf_function)(unsigned value));
 
 /* replace the index i of any internal node accessible from p by
-   indices_map[i] */
+   indices_map[i]; bddm_p must not be renamed */
 extern void bdd_replace_indices (bdd_manager *bddm_p,
 				 bdd_ptr p, unsigned indices_map []);
 
@@ -239,6 +305,7 @@ struct paths_ {
   unsigned to;
   trace_descr trace;
   struct paths_ *next;
+  struct arena_ *mem; /* in the first element: holds the whole list */
 };
  
 typedef struct paths_ *paths;
@@ -266,7 +333,53 @@ void print_one_path(bdd_ptr p, bdd_ptr q, bdd_manager *bddm, unsigned no_free_va
 #define BDD_UNDEF (unsigned) -1
 
 /*value of variable index in BDD node used to indicate that node is a leaf*/
-#define BDD_LEAF_INDEX  ((unsigned) 0xffff)
+#define BDD_LEAF_INDEX  ((unsigned) BDD_MAX_INDEX + 1)
+
+#ifdef BDD_WIDE_NODES
+
+/* the number of words of the lri field */
+#define BDD_LRI_WORDS 3
+
+#define LOAD_lri(node_ptr, l, r, i)\
+l = (node_ptr)->lri[0];\
+r = (node_ptr)->lri[1];\
+i = (node_ptr)->lri[2];\
+
+#define LOAD_lr(node_ptr, l, r)\
+l = (node_ptr)->lri[0];\
+r = (node_ptr)->lri[1];\
+
+#define LOAD_index(node_ptr, i)\
+i = (node_ptr)->lri[2];\
+
+#define LOAD_r(node_ptr)\
+((node_ptr)->lri[1])\
+
+#define STR_lri(node_ptr, l, r, i)\
+(node_ptr)->lri[0] = l;\
+(node_ptr)->lri[1] = r;\
+(node_ptr)->lri[2] = i;\
+
+/* store l, r, and i in the words key[0..BDD_LRI_WORDS-1] the way they
+   would be stored in the lri field */
+#define KEY_lri(key, l, r, i)\
+key[0] = l;\
+key[1] = r;\
+key[2] = i;\
+
+#define MATCH_KEY_lri(node_ptr, key)\
+((node_ptr)->lri[0] == key[0] && (node_ptr)->lri[1] == key[1] &&\
+ (node_ptr)->lri[2] == key[2])\
+
+#define STR_KEY_lri(node_ptr, key)\
+(node_ptr)->lri[0] = key[0];\
+(node_ptr)->lri[1] = key[1];\
+(node_ptr)->lri[2] = key[2];\
+
+#else
+
+/* the number of words of the lri field */
+#define BDD_LRI_WORDS 2
 
 /* look up the two lri fields in a bdd_record_ and extract the value of
    the left child, the right child, and the node index */
@@ -296,9 +409,18 @@ i = ((node_ptr)->lri[1] & 0xffff);\
 
 /* pack l, r, and i in two unsigned words (corresponding to the lri[0]
    and lri[1] fields */
-#define TWO_UNS_STR_lri(i0, i1, l, r, i)\
-i0 = (l << 8) | (r >> 16);\
-i1 = ((r & 0x0000ffff) << 16) | i;\
+#define KEY_lri(key, l, r, i)\
+key[0] = (l << 8) | (r >> 16);\
+key[1] = ((r & 0x0000ffff) << 16) | i;\
+
+#define MATCH_KEY_lri(node_ptr, key)\
+((node_ptr)->lri[0] == key[0] && (node_ptr)->lri[1] == key[1])\
+
+#define STR_KEY_lri(node_ptr, key)\
+(node_ptr)->lri[0] = key[0];\
+(node_ptr)->lri[1] = key[1];\
+
+#endif
 
 /* SEQUENTIAL LISTS */
 
@@ -355,47 +477,44 @@ struct bdd_manager_ {
   /* table */
 
   unsigned table_log_size; 
-  unsigned table_size; /* = 2^table_log_size*/
-  unsigned table_total_size; /* including overflow area */
-  unsigned table_mask; /*table_log_size  - the number of bits in table_mask
-			 is the logarithm of the number of bins per 
-			 hash address*/
-  unsigned table_overflow_increment; /*the number of new nodes added when
-				       overflow area is full; also  initial
-				       size of overflow area*/
+  unsigned table_size; /* = 2^table_log_size, the size of the hashed area,
+			  which starts at BDD_FIRST_NODE*/
+  unsigned table_total_size; /* the number of records allocated,
+				including the first line */
+  unsigned table_mask; /*the number of lines in the hashed area - 1*/
   unsigned table_elements; /*number of elements inserted in hashed mode*/
 
   bdd_ptr  table_next; /*next available position when nodes are inserted
 			 sequentially*/
-  bdd_ptr  table_overflow; /*next free node in overflow area
-			     when node_table used in hashed mode*/
-  unsigned table_double_trigger; /* when to trigger doubting of the table */
+  unsigned table_double_trigger; /* when to trigger doubling of the table */
   bdd_record *node_table; /*node_table is the beginning of array of BDD nodes*/
   DECLARE_SEQUENTIAL_LIST(roots, unsigned) /*results of applys and projects*/
   /* cache */
 
   cache_record *cache; /*cache is the beginning of cache table*/
-  unsigned cache_total_size; /*size of hashed area + overflow area*/
-  unsigned cache_size; /*size of hashed area (which is initialized to
-			 unused)*/
-  unsigned cache_mask; /*table_log_size  - the number of bits in cache_mask
-			 is the logarithm of the number of bins per 
-			 hash address*/
-  unsigned cache_overflow_increment; /*initial size of overflow area and
-				       increment when full*/
-  unsigned cache_overflow; /*points to next available
-			     position in overflow area*/
+  unsigned cache_size; /*the number of records, a power of 2*/
+  unsigned cache_mask; /*cache_size - 1*/
   boolean cache_erase_on_doubling; /*if not set, cache is rehashed when table
 				     is doubled in hashed access mode; 
 				     default is true*/
+  unsigned refs; /*number of owners, see bdd_share_manager*/
+
+  /* renaming, see bdd_rename_manager */
+
+  bdd_manager *base; /*the manager owning node_table if this is a view,
+		       otherwise 0*/
+  unsigned *indices; /*the index seen for each index stored in the
+		       nodes, or 0 if they are seen as stored*/
+  unsigned *used_indices; /*the indices stored in node_table in
+			    increasing order, or 0 if not computed*/
+  unsigned used_length;
 
   /* statistics */
 
   unsigned number_double;
   unsigned number_cache_collissions;
-  unsigned number_cache_link_followed;
   unsigned number_node_collissions;
-  unsigned number_node_link_followed;
+  unsigned number_node_probes;
   unsigned number_lookup_cache;
   unsigned number_insert_cache;
   unsigned apply1_steps;
@@ -26,54 +26,27 @@
 
 /*CACHE DOUBLING stuff*/
 
-void copy_cache_record_and_overflow(bdd_manager *bddm, 
-				    cache_record *old_cache, 
-				    unsigned  i,
-				    unsigned (*result_fn)(unsigned r)) {
-  unsigned p, q, r, h;
-  if (CACHE_FULL_BIN0(old_cache[i])) {
-    CACHE_LOAD_BIN0(old_cache[i], p, q, r);
-    h = HASH2(p, q, bddm->cache_mask);
-    insert_cache(bddm, h, p, q, result_fn(r));
-    if (CACHE_FULL_BIN1(old_cache[i])) {
-      CACHE_LOAD_BIN1(old_cache[i], p, q, r);
-      h = HASH2(p, q, bddm->cache_mask);
-      insert_cache(bddm, h, p, q, result_fn(r));
-    }
-  }
-  if (old_cache[i].next != 0) {
-    copy_cache_record_and_overflow(bddm, old_cache,
-				   old_cache[i].next, result_fn);
-  }	
-}	
-
 void double_cache(bdd_manager *bddm,
 		  unsigned (*result_fn)(unsigned r)) {
   cache_record *old_cache = bddm->cache;
   unsigned i;
   unsigned old_size = bddm->cache_size;
-  bddm->cache_size *= 2;
-  bddm->cache_overflow_increment *= 2;
-  bddm->cache_total_size = bddm->cache_size + bddm->cache_overflow_increment;
-  bddm->cache_overflow = bddm->cache_size;
-  bddm->cache = (cache_record*)
-      mem_alloc((size_t) bddm->cache_total_size * (sizeof (cache_record)));
+  size_t old_bytes = bdd_cache_bytes(bddm);
 
-  /*initialize hashed area*/
-  mem_zero(bddm->cache, (size_t)(bddm->cache_size * (sizeof (cache_record))));
+  if (!bdd_cache_may_grow(bddm))
+    return; /* keep it, losing more records */
+  bdd_alloc_cache(bddm, 2 * old_size);
 
-  bddm->cache_mask = bddm->cache_size - 1;
+/*  printf("Doubling cache to: Cache %u\n", bddm->cache_size); */
 
-/*  printf("Doubling cache to: Cache %u Total %u\n", bddm->cache_size, bddm->cache_total_size); */
-
-  /*now rehash in an entirely sequential fashion (except for overflow)*/
-  for (i = 0; i < old_size ; i++) {
-    CACHE_INITIALIZE_RECORD(bddm->cache[i]);
-    CACHE_INITIALIZE_RECORD(bddm->cache[i + old_size]);
-    /*since the hash function is the same for the new cache except
-      that an extra bit in position (log old_size) is added*/
-    copy_cache_record_and_overflow(bddm, old_cache, i, result_fn);
-  }
+  /*now rehash; records that land on the same place are lost*/
+  for (i = 0; i < old_size ; i++)
+    if (CACHE_FULL_RECORD(old_cache[i])) {
+      unsigned p = old_cache[i].p, q = old_cache[i].q;
+      unsigned h = HASH2(p, q, bddm->cache_mask);
+      CACHE_STORE_RECORD(bddm->cache[h], p, q, result_fn(old_cache[i].res));
+    }
 
+  mem_discharge(old_bytes);
   mem_free(old_cache);
 }
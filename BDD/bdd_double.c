@@ -27,6 +27,11 @@
 /*DOUBLE_TABLE stuff*/
 
 void double_table_sequential(bdd_manager *bddm) {
+  if (bddm->table_total_size + bddm->table_size > BDD_MAX_TOTAL_TABLE_SIZE) {
+    printf("\nBDD too large (>%u nodes)\n", BDD_MAX_TOTAL_TABLE_SIZE);
+    abort();
+  }
+  mem_charge((size_t) bddm->table_size * (sizeof (bdd_record)));
   bddm->table_total_size += bddm->table_size;
   bddm->table_size += bddm->table_size;
   
@@ -47,13 +52,11 @@ unsigned double_leaf_fn(unsigned value) {
   return (value);
 }
 
-static bdd_manager *old_bddm;
-
 unsigned get_new_r(unsigned r) {
   if (r == 0 || r == BDD_UNDEF) {
     return (r);
   }
-  return (old_bddm->node_table[r].mark);
+  return (bdd_current_context()->old_bddm->node_table[r].mark);
 }
 
 void double_table_and_cache_hashed(bdd_manager *bddm,
@@ -62,39 +65,41 @@ void double_table_and_cache_hashed(bdd_manager *bddm,
 				   unsigned *p_of_find, unsigned *q_of_find,
 				   boolean rehash_p_and_q) {
   unsigned *p;  
-
-  old_bddm = mem_alloc((size_t) sizeof (bdd_manager));
+  bdd_context *ctx = bdd_current_context();
+  bdd_manager *old_bddm;
+
+  invariant(!bdd_manager_renamed(bddm));
+  /* the old table is discharged when it is killed below */
+  mem_charge((size_t) (BDD_FIRST_NODE + 2 * bddm->table_size) 
+	     * (sizeof (bdd_record)));
+  bdd_forget_used_indices(bddm); /* the table is changed */
+  old_bddm = ctx->old_bddm = mem_alloc((size_t) sizeof (bdd_manager));
   *old_bddm = *bddm;
+  old_bddm->refs = 1; /* the old table is only owned by this function */
+  invariant(bddm->refs == 1);
 
   /*make new bigger table, but only if a bigger one is possible */
-  if (bddm->table_total_size > BDD_MAX_TOTAL_TABLE_SIZE) {
-    printf("\nBDD too large (>%d nodes)\n", BDD_MAX_TOTAL_TABLE_SIZE);
+  if (BDD_FIRST_NODE + 2 * bddm->table_size > BDD_MAX_TOTAL_TABLE_SIZE) {
+    printf("\nBDD too large (>%u nodes)\n", BDD_MAX_TOTAL_TABLE_SIZE);
     abort();
   }
   bddm->table_log_size++;
   bddm->table_size *= 2;
-  bddm->table_overflow_increment *= 2;
-  {
-    unsigned desired_size = bddm->table_size + BDD_NUMBER_OF_BINS + 
-      bddm->table_overflow_increment;
-    bddm->table_total_size = (desired_size <= BDD_MAX_TOTAL_TABLE_SIZE)?
-      desired_size: BDD_MAX_TOTAL_TABLE_SIZE;
-  }
+  bddm->table_total_size = BDD_FIRST_NODE + bddm->table_size;
   bddm->node_table = (bdd_record*) 
-    mem_alloc( (size_t)
-	       bddm->table_total_size
-	       * (sizeof (bdd_record)));
-  bddm->table_mask =   bddm->table_size - BDD_NUMBER_OF_BINS; 
+    mem_alloc_aligned((size_t) PROCESSOR_CACHE_LINE_SIZE, (size_t)
+		      bddm->table_total_size
+		      * (sizeof (bdd_record)));
+  bddm->table_mask = (bddm->table_size >> BDD_LOG_NODES_PER_LINE) - 1; 
   
-  bddm->table_double_trigger *= 2;
-  bddm->table_overflow =  bddm->table_size + BDD_NUMBER_OF_BINS; 
+  bddm->table_double_trigger = BDD_DOUBLE_TRIGGER(bddm->table_size);
 #ifdef _BDD_STAT_
   bddm->number_double++;
 #endif
 
   /* initialize to unused */
   bddm->table_elements = 0;
-  mem_zero(&bddm->node_table[BDD_NUMBER_OF_BINS], (size_t)
+  mem_zero(&bddm->node_table[BDD_FIRST_NODE], (size_t)
 	   bddm->table_size * (sizeof (bdd_record)));
 
   /* initialize bddm roots to the empty list, this new list will
@@ -138,9 +143,12 @@ void double_table_and_cache_hashed(bdd_manager *bddm,
     new position of the node*/
   if (bddm->cache) {
     if (bddm->cache_erase_on_doubling) {
-        bdd_kill_cache(bddm);
-	bdd_make_cache(bddm, 2 * bddm->cache_size * CACHE_NUMBER_OF_BINS, 
-		      2 * bddm->cache_overflow_increment * CACHE_NUMBER_OF_BINS);
+        unsigned size = bddm->cache_size;
+	if (bdd_cache_may_grow(bddm)) {
+	  bdd_kill_cache(bddm);
+	  bdd_alloc_cache(bddm, 2 * size);
+	} else
+	  mem_zero(bddm->cache, bdd_cache_bytes(bddm));
       }
     else /*this is only a good idea when bddm is different from the  managers
 	   the current apply operation is performed over*/
@@ -151,4 +159,5 @@ void double_table_and_cache_hashed(bdd_manager *bddm,
 
   /*deallocated old table and old roots*/
   bdd_kill_manager(old_bddm);
+  ctx->old_bddm = (bdd_manager *) 0;
 }
@@ -73,10 +73,34 @@ void export(bdd_manager *bddm, unsigned p, Table *table)
   }
 }
 
+/* number the nodes reachable from p after their children, so that the
+   table can be read back in one pass (marks must be cleared) */
+void export_postorder(bdd_manager *bddm, unsigned p, Table *table)
+{
+  BddNode e;
+
+  if (bdd_mark(bddm,p))
+    return;
+  if (bdd_is_leaf(bddm,p)) {
+    e.idx = -1;
+    e.lo = bdd_leaf_value(bddm, p);
+    e.hi = 0;
+  }
+  else {
+    export_postorder(bddm, bdd_else(bddm,p), table);
+    export_postorder(bddm, bdd_then(bddm,p), table);
+    e.idx = bdd_ifindex(bddm,p);
+    e.lo = bdd_mark(bddm, bdd_else(bddm,p)) - 1;
+    e.hi = bdd_mark(bddm, bdd_then(bddm,p)) - 1;
+  }
+  tableInsert(table, &e);
+  bdd_set_mark(bddm,p,table->noelems); /* table index+1 put in mark */
+}
+
 /* IMPORT */
 
-BddNode *table;
-bdd_manager *import_bddm;
+GNUC_THREAD BddNode *table; /* import scratch, one per thread */
+GNUC_THREAD bdd_manager *import_bddm;
 
 unsigned make_node(int i)
 {
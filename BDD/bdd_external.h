@@ -40,6 +40,7 @@ void tableInsert(Table *t, BddNode *elm);
 void tableFree(Table *t);
 
 void export(bdd_manager *bddm, unsigned p, Table *table);
+void export_postorder(bdd_manager *bddm, unsigned p, Table *table);
 unsigned make_node(int i);
 
 #endif
@@ -24,119 +24,85 @@
 #include "../Mem/mem.h"
 
 /*ARCHITECTURE DEPENDENT CONSTANTS*/
-/*memory allocation should take place in chunks the size of, or divisible by,
-this constant*/
-#define PROCESSOR_CACHE_LINE_SIZE 32
+/*the node table and the cache are allocated aligned to this constant,
+and hashed access reads one such line at a time*/
+#define PROCESSOR_CACHE_LINE_SIZE 64
 
-/*the number of bins per bucket; hash function indicates the
-  address of the 0th bin*/
-#define BDD_LOG_NUMBER_OF_BINS 1
-#define BDD_NUMBER_OF_BINS 2
+/*the number of nodes per line; the hash function indicates the first
+  line to look in, and collisions are resolved by looking in the
+  following lines (open addressing)*/
+#define BDD_LOG_NODES_PER_LINE 2
+#define BDD_NODES_PER_LINE 4
 
-#define CACHE_LOG_NUMBER_OF_BINS 1
-#define CACHE_NUMBER_OF_BINS 2
+/*the first line of the node table is not used, since node 0 indicates
+  a miss in the cache*/
+#define BDD_FIRST_NODE BDD_NODES_PER_LINE
+
+/*the table is doubled when this fraction of the hashed area is used*/
+#define BDD_DOUBLE_TRIGGER(size) ((size) - (size) / 16 - 1)
 
 /*logarithm of the maximal number of BDD nodes*/
+#ifdef BDD_WIDE_NODES
+#define BDD_MAX_TABLE_INDEX  31
+#else
 #define BDD_MAX_TABLE_INDEX  24 
+#endif
 
 
+/*the node table is hashed with a multiplicative hash followed by a
+  full avalanche of the bits (the finalizer of MurmurHash3), so that
+  masking out the low bits is fine even for the regular node numbers
+  produced by the apply operations; the cache is hit far more often and
+  is lossy anyway, so there the avalanche is replaced by a single fold*/
+static GNUC_INLINE unsigned bdd_fold(unsigned h) {
+  return h ^ (h >> 16);
+}
+
+static GNUC_INLINE unsigned bdd_mix(unsigned h) {
+  h ^= h >> 16;
+  h *= 0x85ebca6bu;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35u;
+  h ^= h >> 16;
+  return h;
+}
+
 #define HASH2(p, q, mask) \
-((((((unsigned)p) * 46349) + (unsigned)q) *  67108859) & mask)
+(bdd_fold((((unsigned)(p)) * 0x9e3779b1u + (unsigned)(q)) * 0x85ebca6bu) \
+ & (mask))
 
 #define HASH3(p, q, r, mask) \
-((((((((unsigned)p)  *  46349) + (unsigned)q)  *  67108859)  + (unsigned)r) \
-  * 10007) & mask)
+(bdd_mix((((unsigned)(p)) * 0x9e3779b1u + (unsigned)(q)) * 0x85ebca77u \
+	 + (unsigned)(r)) & (mask))
+
+/*the index of a node of bddm as seen through the renaming of bddm,
+  see bdd_rename_manager*/
+#define LOAD_index_seen(bddm, node_ptr, i)\
+LOAD_index(node_ptr, i)\
+if ((bddm)->indices && i != BDD_LEAF_INDEX)\
+  i = (bddm)->indices[i];\
 
 /*CACHE DATA TYPES AND ELEMENTARY OPERATIONS*/
 
-/* a cache record contains two bins */
+/* the cache is direct mapped and lossy: a record holds the result of
+   one pair, and an insertion overwrites whatever the record held */
 
 struct cache_record_
-{unsigned p0, q0, res0, p1, q1, res1;
- unsigned next;
- unsigned align; /*to make record fill 32 bytes*/
+{unsigned p, q, res;
+ unsigned align; /*to put four records in a line*/
 };
 
-#define CACHE_UNUSED ((unsigned) 0)
-#define CACHE_USED ((unsigned) 1)
-
-#define CACHE_INITIALIZE_RECORD(cache_rec) \
-cache_rec.p0 = cache_rec.p1 = CACHE_UNUSED; \
-cache_rec.next = 0;
-	
-#define CACHE_LOOKUP_BIN0(cache_rec, p, q) \
-(((p == cache_rec.p0) && (q == cache_rec.q0))? cache_rec.res0 : 0)
-
-#define CACHE_LOOKUP_BIN1(cache_rec, p, q) \
-(((p == cache_rec.p1) && (q == cache_rec.q1))? cache_rec.res1 : 0)
-
-#define CACHE_LOOKUP_BINS(cache_rec, p, q, res) \
-((res = CACHE_LOOKUP_BIN0(cache_rec, p, q)) ? \
-    res : (res = CACHE_LOOKUP_BIN1(cache_rec, p, q))) \
- 
-
-#ifdef _BDD_STAT_  
- 
-#define CACHE_LOOKUP_RECORD(bddm, cache_rec, p, q, res, temp) \
-{if (!(CACHE_LOOKUP_BINS(cache_rec, p, q, res))) \
-    for	(temp = cache_rec.next; temp; temp = bddm->cache[temp].next) { \
-       bddm->number_cache_link_followed++; \
-       if (CACHE_LOOKUP_BINS(bddm->cache[temp], p, q, res))   \
-	    break;} \
-}\
-
-#else
-
-#define CACHE_LOOKUP_RECORD(bddm, cache_rec, p, q, res, temp) \
-{if (!(CACHE_LOOKUP_BINS(cache_rec, p, q, res))) \
-    for	(temp = cache_rec.next; temp; temp = bddm->cache[temp].next) { \
-       if (CACHE_LOOKUP_BINS(bddm->cache[temp], p, q, res))   \
-	    break;} \
-}\
-
-#endif
-
-#define CACHE_FULL_BIN0(cache_rec) \
-(cache_rec.p0 != CACHE_UNUSED)\
+/*since node 0 is never used, a cleared record never matches*/
+#define CACHE_LOOKUP_RECORD(cache_rec, p_, q_) \
+((((cache_rec).p == (p_)) && ((cache_rec).q == (q_)))? (cache_rec).res : 0)
 
-#define CACHE_FULL_BIN1(cache_rec) \
-(cache_rec.p1 != CACHE_UNUSED)\
-   
-#define CACHE_CLEAR_BIN0(cache_rec) \
-cache_rec.p0 = CACHE_UNUSED; \
-
-#define CACHE_CLEAR_BIN1(cache_rec) \
-cache_rec.p1 = CACHE_UNUSED; \
-
-#define CACHE_STORE_BIN0(cache_rec, p, q, res) \
-cache_rec.p0 = p; \
-cache_rec.q0 = q; \
-cache_rec.res0 = res; \
-
-#define CACHE_STORE_BIN1(cache_rec, p, q, res) \
-cache_rec.p1 = p; \
-cache_rec.q1 = q; \
-cache_rec.res1 = res; \
-
-#define CACHE_LOAD_BIN0(cache_rec, p, q, res) \
-p = cache_rec.p0; \
-q = cache_rec.q0; \
-res = cache_rec.res0; \
-
-#define CACHE_LOAD_BIN1(cache_rec, p, q, res) \
-p = cache_rec.p1; \
-q = cache_rec.q1; \
-res = cache_rec.res1; \
-
-#define CACHE_NEW_RECORD(bddm, temp) \
-if (bddm->cache_overflow == bddm->cache_total_size) \
-    bddm->cache = mem_resize(bddm->cache,  \
-				   (size_t) (sizeof (cache_record))\
-				   * (bddm->cache_total_size \
-				      += bddm->cache_overflow_increment)); \
-temp=bddm->cache_overflow++; \
-CACHE_INITIALIZE_RECORD(bddm->cache[temp]);\
+#define CACHE_FULL_RECORD(cache_rec) \
+((cache_rec).p != 0)
 
+#define CACHE_STORE_RECORD(cache_rec, p_, q_, res_) \
+(cache_rec).p = p_; \
+(cache_rec).q = q_; \
+(cache_rec).res = res_;
 
 /* STATISTICS */
 
@@ -144,9 +110,8 @@ struct stat_item {
   unsigned number_bddms;
   unsigned number_double;
   unsigned number_node_collissions;
-  unsigned number_node_link_followed;
+  unsigned number_node_probes;
   unsigned number_cache_collissions;
-  unsigned number_cache_link_followed;
   unsigned number_lookup_cache;
   unsigned number_insert_cache;
   unsigned apply1_steps;
@@ -160,7 +125,35 @@ struct stat_record_ {
 };
 
 extern struct stat_record_ stat_record[];
-extern boolean table_has_been_doubled;
+
+/* ENGINE CONTEXT */
+
+/* activation stacks of bdd_apply1, bdd_apply2_hashed and
+   bdd_project; the frame types are declared in bdd.c */
+struct local_activation_record_apply1;
+struct local_activation_record_apply2_hashed;
+struct local_activation_record_project;
+
+struct bdd_context_ {
+  /* a distinguished stack per routine, reused while only one
+     invocation is active, and the frame of the innermost invocation */
+  struct local_activation_record_apply1 
+    *local_activation_record_apply1_primary, *apply1_ptr;
+  unsigned local_activation_record_apply1_in_use;
+  struct local_activation_record_apply2_hashed 
+    *local_activation_record_apply2_hashed_primary, *apply2_ptr;
+  unsigned local_activation_record_apply2_hashed_in_use;
+  struct local_activation_record_project 
+    *local_activation_record_project_primary, *apply_project_ptr;
+  unsigned local_activation_record_project_in_use;
+
+  void (*leaf_function)(unsigned value); /* bdd_call_leafs */
+  unsigned *indices_map;                 /* bdd_replace_indices */
+  bdd_manager *old_bddm;                 /* double_table_and_cache_hashed */
+  boolean table_has_been_doubled;
+};
+
+void bdd_free_activation_stacks(bdd_context *ctx);
 
 void insert_cache(bdd_manager *bddm, unsigned h, 
 		  unsigned p, unsigned q, unsigned res);
@@ -168,6 +161,12 @@ void insert_cache(bdd_manager *bddm, unsigned h,
 void double_cache( bdd_manager *bddm,
 		  unsigned (*result_fn)(unsigned r));
 
+/* bdd_manager.c, the bytes charged to the memory budget */
+size_t bdd_table_bytes(bdd_manager *bddm);
+size_t bdd_cache_bytes(bdd_manager *bddm);
+void bdd_alloc_cache(bdd_manager *bddm, unsigned size);
+boolean bdd_cache_may_grow(bdd_manager *bddm);
+
 void double_table_sequential(bdd_manager *bddm);
 
 void double_table_and_cache_hashed(bdd_manager *bddm,
@@ -177,6 +176,10 @@ void double_table_and_cache_hashed(bdd_manager *bddm,
 				   unsigned *p_of_find, unsigned *q_of_find,
 				   boolean rehash_p_and_q);
 
+/* drop the indices known to be stored in the node table of bddm,
+   before the table is changed */
+void bdd_forget_used_indices(bdd_manager *bddm);
+
 unsigned bdd_apply1_dont_add_roots(bdd_manager *bddm_p, 
 				   unsigned p, 
 				   bdd_manager *bddm_r,
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <pthread.h>
 #include "bdd.h"
 #include "bdd_internal.h"
 
@@ -41,6 +42,57 @@ return(j);
 }	
 
 
+/* ENGINE CONTEXT */
+
+static GNUC_THREAD bdd_context *current_context;
+static GNUC_THREAD bdd_context *default_context;
+
+/* the default context of a thread is released when the thread exits */
+static pthread_key_t default_context_key;
+static pthread_once_t default_context_once = PTHREAD_ONCE_INIT;
+
+static void kill_default_context(void *ctx) {
+  bdd_kill_context((bdd_context *) ctx);
+}
+
+static void make_default_context_key(void) {
+  pthread_key_create(&default_context_key, kill_default_context);
+}
+
+bdd_context *bdd_new_context(void) {
+  bdd_context *ctx = (bdd_context *) mem_alloc((size_t) sizeof (bdd_context));
+  mem_zero(ctx, (size_t) sizeof (bdd_context));
+  return ctx;
+}
+
+void bdd_kill_context(bdd_context *ctx) {
+  invariant(ctx != current_context || ctx == default_context);
+  bdd_free_activation_stacks(ctx);
+  if (ctx == default_context) {
+    default_context = current_context = (bdd_context *) 0;
+    pthread_setspecific(default_context_key, (void *) 0);
+  }
+  mem_free(ctx);
+}
+
+bdd_context *bdd_use_context(bdd_context *ctx) {
+  bdd_context *old = bdd_current_context();
+  current_context = ctx ? ctx : default_context;
+  return old;
+}
+
+bdd_context *bdd_current_context(void) {
+  if (!current_context) {
+    if (!default_context) {
+      pthread_once(&default_context_once, make_default_context_key);
+      default_context = bdd_new_context();
+      pthread_setspecific(default_context_key, default_context);
+    }
+    current_context = default_context;
+  }
+  return current_context;
+}
+
 /* set out statistics data structures */
 void bdd_init(void) {
   struct stat_item *r;
@@ -54,7 +106,7 @@ void bdd_init(void) {
       r->number_double = 0;
       r->number_cache_collissions = 0;
       r->number_node_collissions = 0;
-      r->number_node_link_followed = 0;
+      r->number_node_probes = 0;
       r->number_insert_cache = 0;
       r->number_lookup_cache = 0;
       r->apply1_steps = 0;
@@ -63,48 +115,70 @@ void bdd_init(void) {
   }
 }
 
+/* the node table and the cache are aligned to cache lines, and
+   charged to the memory budget */
+static void *alloc_lines(size_t s) {
+  mem_charge(s);
+  return mem_alloc_aligned((size_t) PROCESSOR_CACHE_LINE_SIZE, s);
+}
+
+size_t bdd_table_bytes(bdd_manager *bddm) {
+  return (size_t) bddm->table_total_size * (sizeof (bdd_record));
+}
+
+size_t bdd_cache_bytes(bdd_manager *bddm) {
+  return bddm->cache ? 
+    (size_t) bddm->cache_size * (sizeof (cache_record)) : 0;
+}
+
+/* the overflow increment is not used, since collisions are resolved
+   within the hashed area */
 bdd_manager *bdd_new_manager(unsigned table_size, 
 			     unsigned table_overflow_increment){
   bdd_manager *new_bddm = 
       (bdd_manager*) mem_alloc((size_t)(sizeof (bdd_manager)));
 
-  /*make table of BDD nodes*/
+  /*make table of BDD nodes, big enough to hold table_size nodes
+    before doubling*/
   new_bddm->table_log_size = unsigned_log_ceiling(table_size);
+  if (new_bddm->table_log_size < BDD_LOG_NODES_PER_LINE + 1)
+      new_bddm->table_log_size = BDD_LOG_NODES_PER_LINE + 1;
+  if (BDD_DOUBLE_TRIGGER(unsigned_exponential(new_bddm->table_log_size))
+      < table_size)
+      new_bddm->table_log_size++;
 
-  new_bddm->table_next = BDD_NUMBER_OF_BINS; /*used for sequential operations*/
+  new_bddm->table_next = BDD_FIRST_NODE; /*used for sequential operations*/
   /*we use 0 for indicating a miss in the result cache, so
     skip that position, but keep CPU cache alignment*/
 
   new_bddm->table_size  = unsigned_exponential(new_bddm->table_log_size);
-  if (new_bddm->table_size < BDD_NUMBER_OF_BINS)
-      new_bddm->table_size= BDD_NUMBER_OF_BINS;
-  new_bddm->table_overflow_increment = 
-      (table_overflow_increment < BDD_NUMBER_OF_BINS) ?
-	  BDD_NUMBER_OF_BINS : table_overflow_increment;
-  new_bddm->table_total_size = new_bddm->table_size 
-      + BDD_NUMBER_OF_BINS + new_bddm->table_overflow_increment;
+  new_bddm->table_total_size = BDD_FIRST_NODE + new_bddm->table_size;
 
   if (new_bddm->table_total_size > BDD_MAX_TOTAL_TABLE_SIZE) {
-    printf("\nBDD too large (>%d nodes)\n", BDD_MAX_TOTAL_TABLE_SIZE);
+    printf("\nBDD too large (>%u nodes)\n", BDD_MAX_TOTAL_TABLE_SIZE);
     abort();
   }
 
   new_bddm->node_table = (bdd_record*) 
-    mem_alloc((size_t)
-	      new_bddm->table_total_size
-	      * (sizeof (bdd_record)));
-  new_bddm->table_mask = new_bddm->table_size 
-      - BDD_NUMBER_OF_BINS; /*to zero out the last log BDD_NUMBER_OF_BINS*/
+    alloc_lines((size_t)
+		new_bddm->table_total_size
+		* (sizeof (bdd_record)));
+  new_bddm->table_mask = 
+      (new_bddm->table_size >> BDD_LOG_NODES_PER_LINE) - 1;
 
   new_bddm->table_elements = 0;
 
   /*prepare hashed access*/
-  new_bddm->table_overflow = new_bddm->table_size + BDD_NUMBER_OF_BINS;
-  new_bddm->table_double_trigger = (4 * new_bddm->table_size) / 4;
-  mem_zero(&new_bddm->node_table[BDD_NUMBER_OF_BINS], (size_t)
+  new_bddm->table_double_trigger = BDD_DOUBLE_TRIGGER(new_bddm->table_size);
+  mem_zero(&new_bddm->node_table[BDD_FIRST_NODE], (size_t)
 	   new_bddm->table_size * (sizeof (bdd_record)));
   new_bddm->cache_erase_on_doubling = TRUE;
-  
+  new_bddm->refs = 1;
+  new_bddm->base = (bdd_manager *) 0;
+  new_bddm->indices = (unsigned *) 0;
+  new_bddm->used_indices = (unsigned *) 0;
+  new_bddm->used_length = 0;
+
 
   MAKE_SEQUENTIAL_LIST(new_bddm->roots, unsigned, 1024);
 
@@ -115,9 +189,8 @@ bdd_manager *bdd_new_manager(unsigned table_size,
   /*prepare statistics*/
   new_bddm->number_double = 0;
   new_bddm->number_node_collissions = 0;
-  new_bddm->number_node_link_followed = 0;
+  new_bddm->number_node_probes = 0;
   new_bddm->number_cache_collissions = 0;
-  new_bddm->number_cache_link_followed = 0;
   new_bddm->number_insert_cache = 0;
   new_bddm->number_lookup_cache = 0;
   new_bddm->apply1_steps = 0;
@@ -126,30 +199,50 @@ bdd_manager *bdd_new_manager(unsigned table_size,
   return(new_bddm);
 }
 
+/* the cache has no overflow area, so the overflow increment is not
+   used; under memory pressure the cache is made smaller, as it only
+   saves work */
 void bdd_make_cache(bdd_manager *bddm, unsigned size, unsigned overflow_increment) {
-  unsigned overflow  = overflow_increment / CACHE_NUMBER_OF_BINS;
-  bddm->cache_size = unsigned_exponential(unsigned_log_ceiling(size) -
-					  CACHE_LOG_NUMBER_OF_BINS);
-  bddm->cache_total_size = bddm->cache_size + overflow;
-  bddm->cache_overflow_increment = overflow;
-  bddm->cache_overflow = bddm->cache_size; 
+  if (mem_pressure())
+    size /= 4;
+  bdd_alloc_cache(bddm, size);
+}
+
+/* a cache of exactly the given size, rounded up to a power of two */
+void bdd_alloc_cache(bdd_manager *bddm, unsigned size) {
+  unsigned log_size = unsigned_log_ceiling(size);
+  if (log_size < BDD_LOG_NODES_PER_LINE)
+      log_size = BDD_LOG_NODES_PER_LINE;
+  bddm->cache_size = unsigned_exponential(log_size);
   bddm->cache_mask = bddm->cache_size - 1;
   bddm->cache = (cache_record*)
-      mem_alloc((size_t)(bddm->cache_total_size * (sizeof (cache_record))));
-  {/*initialize hashed area*/
+      alloc_lines((size_t)(bddm->cache_size * (sizeof (cache_record))));
   mem_zero(bddm->cache, (size_t)(bddm->cache_size * (sizeof (cache_record))));
-  }  
 }
 
 void bdd_kill_cache(bdd_manager *bddm) { 
   if (bddm->cache) {
+    mem_discharge(bdd_cache_bytes(bddm));
     mem_free(bddm->cache);
   }
   bddm->cache = (cache_record*) 0;
 } 
 
+/* a cache that is full may double, unless memory is short; it
+   cannot shrink, since the hash values of pending insertions must
+   stay inside it */
+boolean bdd_cache_may_grow(bdd_manager *bddm) {
+  size_t more = bdd_cache_bytes(bddm);
+  return !mem_pressure() && 
+    (!mem_budget() || mem_charged() + more <= mem_budget());
+}
+
+/* the statistics groups are shared by all threads */
+static pthread_mutex_t stat_lock = PTHREAD_MUTEX_INITIALIZER;
+
 void bdd_update_statistics(bdd_manager *bddm, unsigned stat_index) {
   struct stat_item *r;
+  pthread_mutex_lock(&stat_lock);
   stat_record[stat_index].number_insertions++;
   if (stat_record[stat_index].max_index < bddm->table_log_size) {
     stat_record[stat_index].max_index = bddm->table_log_size;
@@ -158,29 +251,171 @@ void bdd_update_statistics(bdd_manager *bddm, unsigned stat_index) {
   r->number_bddms++;
   r->number_double += bddm->number_double;
   r->number_cache_collissions += bddm->number_cache_collissions;
-  r->number_cache_link_followed += bddm->number_cache_link_followed;
   r->number_node_collissions += bddm->number_node_collissions;
-  r->number_node_link_followed += bddm->number_node_link_followed;
+  r->number_node_probes += bddm->number_node_probes;
   r->number_lookup_cache += bddm->number_lookup_cache;
   r->number_insert_cache += bddm->number_insert_cache;
   r->apply1_steps += bddm->apply1_steps;
   r->apply2_steps += bddm->apply2_steps;
+  pthread_mutex_unlock(&stat_lock);
+}
+
+bdd_manager *bdd_share_manager(bdd_manager *bddm) {
+  __sync_add_and_fetch(&bddm->refs, 1);
+  return bddm;
+}
+
+int bdd_manager_shared(bdd_manager *bddm) {
+  return __atomic_load_n(&bddm->refs, __ATOMIC_RELAXED) > 1;
 }
 
 void bdd_kill_manager(bdd_manager *bddm) { 
-  mem_free(bddm->node_table);
+  if (__sync_sub_and_fetch(&bddm->refs, 1) > 0)
+    return;
+  if (bddm->base) {
+    bdd_kill_manager(bddm->base); /* a view releases the owner of the nodes */
+  } else {
+    mem_discharge(bdd_table_bytes(bddm));
+    mem_free(bddm->node_table);
+  }
   FREE_SEQUENTIAL_LIST(bddm->roots);
-  if (bddm->cache) {
-    mem_free(bddm->cache);
+  bdd_kill_cache(bddm);
+  if (bddm->indices) {
+    mem_free(bddm->indices);
   }
+  bdd_forget_used_indices(bddm);
   mem_free(bddm);
 } 
 
+/* RENAMING */
+
+/* find the indices stored in the node table of bddm, which is used
+   either sequentially, up to table_next, or hashed, where unused
+   records have a zero r-field */
+static void find_used_indices(bdd_manager *bddm) {
+  bdd_ptr p, end;
+  unsigned i, max = 0, any = FALSE;
+  char *used;
+
+  if (bddm->used_indices) {
+    return;
+  }
+  end = bddm->table_next > BDD_FIRST_NODE ? 
+    bddm->table_next : bddm->table_total_size;
+
+  for (p = BDD_FIRST_NODE; p < end; p++) {
+    if (LOAD_r(&bddm->node_table[p]) != BDD_UNUSED) {
+      LOAD_index(&bddm->node_table[p], i);
+      if (i != BDD_LEAF_INDEX && (!any || i > max)) {
+	max = i;
+	any = TRUE;
+      }
+    }
+  }
+  bddm->used_length = 0;
+  bddm->used_indices = (unsigned *) mem_alloc((size_t) 
+					      (sizeof (unsigned)) * (max + 1));
+  if (!any) {
+    return;
+  }
+
+  used = (char *) mem_alloc((size_t) max + 1);
+  mem_zero(used, (size_t) max + 1);
+  for (p = BDD_FIRST_NODE; p < end; p++) {
+    if (LOAD_r(&bddm->node_table[p]) != BDD_UNUSED) {
+      LOAD_index(&bddm->node_table[p], i);
+      if (i != BDD_LEAF_INDEX) {
+	used[i] = 1;
+      }
+    }
+  }
+  for (i = 0; i <= max; i++) {
+    if (used[i]) {
+      bddm->used_indices[bddm->used_length++] = i;
+    }
+  }
+  mem_free(used);
+}
+
+void bdd_forget_used_indices(bdd_manager *bddm) {
+  if (bddm->used_indices) {
+    mem_free(bddm->used_indices);
+  }
+  bddm->used_indices = (unsigned *) 0;
+  bddm->used_length = 0;
+}
+
+bdd_manager *bdd_rename_manager(bdd_manager *bddm, 
+				unsigned indices_map[]) {
+  bdd_manager *table = bddm->base ? bddm->base : bddm;
+  bdd_manager *view;
+  unsigned *indices = (unsigned *) 0;
+  unsigned k, i, j, prev = 0;
+  boolean identity = TRUE;
+
+  /* compose the renamings for the indices of the nodes, in increasing
+     order, so that the order is checked on the way */
+  find_used_indices(table);
+  if (table->used_length > 0) {
+    indices = (unsigned *) 
+      mem_alloc((size_t) (sizeof (unsigned)) * 
+		(table->used_indices[table->used_length - 1] + 1));
+    for (k = 0; k < table->used_length; k++) {
+      i = table->used_indices[k];
+      j = indices_map[bddm->indices ? bddm->indices[i] : i];
+      if (j > BDD_MAX_INDEX || (k > 0 && j <= prev)) {
+	mem_free(indices);
+	return (bdd_manager *) 0;
+      }
+      indices[i] = prev = j;
+      identity &= (i == j);
+    }
+  }
+  if (identity) {
+    if (indices) {
+      mem_free(indices);
+    }
+    indices = (unsigned *) 0;
+    if (!bddm->indices) {
+      return bddm;
+    }
+  }
+
+  if (!bdd_manager_shared(bddm)) {
+    if (bddm->indices) {
+      mem_free(bddm->indices);
+    }
+    bddm->indices = indices;
+    return bddm;
+  }
+
+  /* the other owners keep seeing the old renaming, so make a view
+     with its own renaming and roots, but no cache */
+  view = (bdd_manager *) mem_alloc((size_t) sizeof (bdd_manager));
+  *view = *bddm;
+  view->refs = 1;
+  view->base = bdd_share_manager(table);
+  view->indices = indices;
+  view->used_indices = (unsigned *) 0;
+  view->used_length = 0;
+  view->cache = (cache_record *) 0;
+  MAKE_SEQUENTIAL_LIST(view->roots, unsigned, bddm->roots_length);
+  mem_copy(view->roots_array, bddm->roots_array, (size_t)
+	   (sizeof (unsigned)) * (bddm->roots_index + 1));
+  view->roots_index = bddm->roots_index;
+  bdd_kill_manager(bddm);
+  return view;
+}
+
+int bdd_manager_renamed(bdd_manager *bddm) {
+  return bddm->base || bddm->indices;
+}
+
 
 void bdd_print_statistics(unsigned stat_index, char info[]) {
-  const char title[]         = "%4s %6s %6s %8s %8s %8s %8s %8s %8s %8s %8s\n";
-  const char form[]          = "%4i %6i %6i %8i %8i %8i %8i %8i %8i %8i %8i\n";
-  const char total_form[]    = "%4s %6i %6i %8i %8i %8i %8i %8i %8i %8i %8i\n";
+  const char title[]         = "%4s %6s %6s %8s %8s %8s %8s %8s %8s %8s\n";
+  const char form[]          = "%4i %6i %6i %8i %8i %8i %8i %8i %8i %8i\n";
+  const char total_form[]    = "%4s %6i %6i %8i %8i %8i %8i %8i %8i %8i\n";
 
   unsigned i;
   struct stat_item *r;
@@ -189,26 +424,24 @@ void bdd_print_statistics(unsigned stat_index, char info[]) {
   printf("Statistics: %s.  Collected: %i\n", 
 	 info, stat_record[stat_index].number_insertions);
   printf(title, "size", "bddms", "double", "app1", "app2", 
-	 "node coll", "node link", "cach look", "cach ins", "cach coll", "cach link");
+	 "node coll", "node prob", "cach look", "cach ins", "cach coll");
   for (i = 0; i <= stat_record[stat_index].max_index; i++) {  
     r = &stat_record[stat_index].statistics[i];
     printf(form, 
 	   i, r->number_bddms, r->number_double,
            r->apply1_steps, r->apply2_steps, 
 	   r->number_node_collissions, 
-	   r->number_node_link_followed, 
+	   r->number_node_probes, 
 	   r->number_lookup_cache,
 	   r->number_insert_cache,
-	   r->number_cache_collissions,
-	   r->number_cache_link_followed);
+	   r->number_cache_collissions);
     total.number_bddms += r->number_bddms;
     total.number_double += r->number_double;
     total.number_node_collissions += r->number_node_collissions;
-    total.number_node_link_followed += r->number_node_link_followed;
+    total.number_node_probes += r->number_node_probes;
     total.number_lookup_cache += r->number_lookup_cache;
     total.number_insert_cache += r->number_insert_cache;
     total.number_cache_collissions += r->number_cache_collissions;
-    total.number_cache_link_followed += r->number_cache_link_followed;
     total.apply1_steps += r->apply1_steps;
     total.apply2_steps += r->apply2_steps;
  }   
@@ -216,11 +449,10 @@ void bdd_print_statistics(unsigned stat_index, char info[]) {
 	   "tot", total.number_bddms, total.number_double,
 	   total.apply1_steps, total.apply2_steps, 
 	   total.number_node_collissions, 
-	   total.number_node_link_followed, 
+	   total.number_node_probes, 
 	   total.number_lookup_cache,
 	   total.number_insert_cache,
-	   total.number_cache_collissions,
-	   total.number_cache_link_followed);
+	   total.number_cache_collissions);
 }
 
 unsigned bdd_size(bdd_manager *bddm) {
@@ -23,8 +23,9 @@
 #include <string.h>
 #include "bdd.h"
 #include "bdd_internal.h"
+#include "../Mem/arena.h"
 
-trace_descr copy_reversed_trace(trace_descr current_trace)
+static trace_descr copy_reversed_trace(arena mem, trace_descr current_trace)
 {
   trace_descr reversed_trace;
   trace_descr this_trace;
@@ -32,7 +33,7 @@ trace_descr copy_reversed_trace(trace_descr current_trace)
   reversed_trace = NULL;
   
   while (current_trace) {
-    this_trace = (trace_descr) mem_alloc(sizeof(struct trace_descr_));
+    this_trace = (trace_descr) arena_alloc(mem, sizeof(struct trace_descr_));
     this_trace->index = current_trace->index;
     this_trace->value = current_trace->value;
     this_trace->next = reversed_trace;
@@ -44,86 +45,74 @@ trace_descr copy_reversed_trace(trace_descr current_trace)
   return reversed_trace;
 }
 
-paths join_paths(paths *plist1, paths plist2)
-{
-  if (*plist1) {
-    paths pp;
-    
-    for (pp = *plist1; pp->next; pp = pp->next);
-      
-    pp->next = plist2;
-  }
-  else
-    *plist1 = plist2;
-
-  return (*plist1);
-}
-
-paths mk_paths(bdd_manager *bddm, unsigned p, trace_descr current_trace)
+/* append the paths of p to *tail and return the new tail; the trace
+   under construction lives on the stack, only the results go into the
+   arena */
+static paths *mk_paths(arena mem, bdd_manager *bddm, unsigned p, 
+		       trace_descr current_trace, paths *tail)
 {
   unsigned l, r, index;
 
-  LOAD_lri(&bddm->node_table[p], l, r, index);
+  LOAD_lr(&bddm->node_table[p], l, r);
+  LOAD_index_seen(bddm, &bddm->node_table[p], index);
 
   if (index == BDD_LEAF_INDEX) {
     paths this_path;
 
-    this_path = (paths) mem_alloc(sizeof(struct paths_));
+    this_path = (paths) arena_alloc(mem, sizeof(struct paths_));
     this_path->to = l;
-    this_path->trace = copy_reversed_trace (current_trace);
+    this_path->trace = copy_reversed_trace (mem, current_trace);
     this_path->next = NULL;
+    this_path->mem = NULL;
 
-    return this_path;
+    *tail = this_path;
+    return &this_path->next;
   }
   else {
-    trace_descr this_trace;
-    paths right_paths, left_paths;
+    struct trace_descr_ this_trace;
 
-    this_trace = (trace_descr) mem_alloc(sizeof(struct trace_descr_));
-    this_trace->index = index;
-    this_trace->value = TRUE;
-    this_trace->next = current_trace;
+    this_trace.index = index;
+    this_trace.next = current_trace;
 
-    right_paths = mk_paths(bddm, r, this_trace);
+    this_trace.value = FALSE;
+    tail = mk_paths(mem, bddm, l, &this_trace, tail);
 
-    this_trace->value = FALSE;
-
-    left_paths = mk_paths(bddm, l, this_trace);
-
-    mem_free (this_trace);
-
-    return (join_paths(&left_paths, right_paths));
+    this_trace.value = TRUE;
+    return mk_paths(mem, bddm, r, &this_trace, tail);
   }
-    
 }
 
 paths make_paths(bdd_manager *bddm, unsigned p)
 { 
-  return (mk_paths(bddm, p, NULL));
+  paths head;
+  arena mem = new_arena(0);
+
+  mk_paths(mem, bddm, p, NULL, &head);
+  head->mem = mem;
+  return head;
 }
 
 void kill_trace(trace_descr t)
 {
-  if (t) {
-    kill_trace (t->next);
+  while (t) {
+    trace_descr n = t->next;
     mem_free(t);
+    t = n;
   }
 }
 
 void kill_paths(paths p)
 {
-  if (p) {
-    kill_trace (p->trace);
-    kill_paths (p->next);
-    mem_free(p);
-  }
+  if (p)
+    free_arena(p->mem);
 }
 
 trace_descr find_one_path(bdd_manager *bddm, unsigned p, unsigned q)
 {
   unsigned l, r, index;
 
-  LOAD_lri(&bddm->node_table[p], l, r, index);
+  LOAD_lr(&bddm->node_table[p], l, r);
+  LOAD_index_seen(bddm, &bddm->node_table[p], index);
   
   if (index == BDD_LEAF_INDEX) {
     if (l == q) {
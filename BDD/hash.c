@@ -222,3 +222,98 @@ free_hash_tab(hash_tab h)
   mem_free((void *)h->table);
   mem_free(h);
 }
+
+/* Flat tables.  The hash of a key is mixed by a multiplication with
+   the golden ratio and the top bits give the slot, so the weak hash2
+   spreads well over a power-of-2 table. */
+
+#define PAIR_SLOT(m, hash) \
+  ((long) (((hash) * 0x9E3779B97F4A7C15ULL) >> (m)->shift))
+
+static void alloc_pair_map(pair_map m, long size)
+{
+  int log;
+
+  for (log = 0; (1L << log) < size; log++);
+  m->size = 1L << log;
+  m->shift = 64 - log;
+  m->table = (pair_rc) mem_alloc((size_t) (m->size * sizeof(*m->table)));
+  mem_zero(m->table, (size_t) (m->size * sizeof(*m->table)));
+}
+
+/* reserve_pair_map(m, entries) makes room for entries entries without 
+   growing, at a load of at most 1/2. */
+
+void reserve_pair_map(pair_map m, long entries)
+{
+  pair_rc old = m->table;
+  long oldsize = m->size, i, j;
+
+  if (2 * entries <= m->size)
+    return;
+  alloc_pair_map(m, 2 * entries);
+  for (i = 0; i < oldsize; i++)
+    if (old[i].data) {
+      for (j = PAIR_SLOT(m, old[i].hash); m->table[j].data;
+	   j = (j + 1) & (m->size - 1));
+      m->table[j] = old[i];
+    }
+  mem_free(old);
+}
+
+/* new_pair_map(hash_fn, eq_fn, estimate) creates a flat table with 
+   room for estimate entries. */
+
+pair_map new_pair_map(long (*hash_fn)(long, long), 
+		      char (*eq_fn)(long, long, long, long),
+		      long estimate)
+{
+  pair_map m = (pair_map) mem_alloc(sizeof(struct pair_map_));
+
+  alloc_pair_map(m, estimate < 32 ? 64 : 2 * estimate);
+  m->entries = 0;
+  m->hash_fn = hash_fn;
+  m->eq_fn = eq_fn;
+  return m;
+}
+
+void insert_in_pair_map(pair_map m, long f, long g, void *data)
+{
+  unsigned long hash;
+  long i;
+
+  if (2 * (m->entries + 1) > m->size)
+    reserve_pair_map(m, 2 * m->entries + 1);
+  hash = (unsigned long) m->hash_fn(f, g);
+  for (i = PAIR_SLOT(m, hash); m->table[i].data; i = (i + 1) & (m->size - 1));
+  m->table[i].key1 = f;
+  m->table[i].key2 = g;
+  m->table[i].data = data;
+  m->table[i].hash = hash;
+  m->entries++;
+}
+
+void *lookup_in_pair_map(pair_map m, long f, long g)
+{
+  unsigned long hash = (unsigned long) m->hash_fn(f, g);
+  pair_rc p;
+  long i;
+
+  for (i = PAIR_SLOT(m, hash); (p = &m->table[i])->data; 
+       i = (i + 1) & (m->size - 1))
+    if (p->hash == hash && m->eq_fn(p->key1, p->key2, f, g))
+      return p->data;
+  return NULL;
+}
+
+void clear_pair_map(pair_map m)
+{
+  mem_zero(m->table, (size_t) (m->size * sizeof(*m->table)));
+  m->entries = 0;
+}
+
+void free_pair_map(pair_map m)
+{
+  mem_free(m->table);
+  mem_free(m);
+}
@@ -60,4 +60,41 @@ extern long hashlong(long, long);
 extern char eqlong(long, long, long, long);
 extern void free_hash_tab_with_destructor(hash_tab, void (*destruct)(long,long,void *));
 
+
+/* Flat tables: the entries are kept in one array with open addressing
+   and linear probing, so an insertion allocates nothing unless the
+   table grows.  As for hash_tab, a key is inserted at most once and
+   NULL data means not found. */
+
+struct pair_rc_
+{
+  long key1;
+  long key2;
+  void * data;            /* NULL if the slot is free */
+  unsigned long hash;
+};
+
+typedef struct pair_rc_ *pair_rc;
+
+struct pair_map_
+{
+  pair_rc table;
+  long size;              /* a power of 2 */
+  long entries;
+  int shift;              /* 64 - log2(size) */
+  long (*hash_fn)(long, long);
+  char (*eq_fn)(long, long, long, long);
+};
+
+typedef struct pair_map_ *pair_map;
+
+extern pair_map new_pair_map(long (*hash_fn)(long, long), 
+                             char (*eq_fn)(long, long, long, long),
+                             long estimate);
+extern void reserve_pair_map(pair_map, long entries);
+extern void insert_in_pair_map(pair_map, long, long, void *);
+extern void *lookup_in_pair_map(pair_map, long, long);
+extern void clear_pair_map(pair_map);   /* keeps the table */
+extern void free_pair_map(pair_map);
+
 #endif
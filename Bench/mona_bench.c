@@ -0,0 +1,551 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+/* mona_bench - timing of the automaton kernels and of the front end
+ *
+ * Every case is a family and a size.  Kernel families build their
+ * automata directly with the DFA package and time each operation;
+ * formula families run the mona executable on an example or on a
+ * generated formula and read its statistics (-s -t).  Each case runs
+ * in a child process, so the resident set size is its own.
+ *
+ * The output has one JSON object per line:
+ *   {"family":..,"n":..,"run":..,"op":..,"count":..,"seconds":..}
+ * for each operation, and a line with "op":"total" that also has the
+ * number of states and BDD nodes of the largest automaton, the peak
+ * resident set size in kilobytes and whether the case succeeded.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "dfa.h"
+#include "../BDD/hash.h"
+#include "mem.h"
+
+typedef enum {
+  opProduct, opProject, opMinimize, opAnalyze, opChained, opFlat, NUM_OPS
+} Op;
+
+static const char *opNames[NUM_OPS] = {
+  "product", "project", "minimize", "analyze", "chained", "flat"
+};
+
+typedef struct {
+  const char *family;
+  int n, run;
+  unsigned count[NUM_OPS];
+  double seconds[NUM_OPS];
+  unsigned states, bddNodes;   /* of the largest automaton */
+} Stats;
+
+static char *mona = "mona";
+static char *examples = "Examples";
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void printOps(Stats *s)
+{
+  int i;
+  for (i = 0; i < NUM_OPS; i++)
+    if (s->count[i])
+      printf("{\"family\":\"%s\",\"n\":%d,\"run\":%d,\"op\":\"%s\","
+	     "\"count\":%u,\"seconds\":%.6f}\n",
+	     s->family, s->n, s->run, opNames[i], s->count[i], s->seconds[i]);
+}
+
+static void printTotal(Stats *s, double seconds, long rss, int ok)
+{
+  printf("{\"family\":\"%s\",\"n\":%d,\"run\":%d,\"op\":\"total\","
+	 "\"seconds\":%.6f,\"states\":%u,\"bdd_nodes\":%u,\"rss_kb\":%ld,"
+	 "\"ok\":%s}\n",
+	 s->family, s->n, s->run, seconds, s->states, s->bddNodes, rss,
+	 ok ? "true" : "false");
+}
+
+/* KERNEL FAMILIES */
+
+static double opStart;
+
+static void begin(void)
+{
+  opStart = now();
+}
+
+/* account for an operation and free its argument if asked */
+static DFA *end(Stats *s, Op op, DFA *result, DFA *arg)
+{
+  s->count[op]++;
+  s->seconds[op] += now() - opStart;
+  if ((unsigned) result->ns > s->states)
+    s->states = result->ns;
+  if (bdd_size(result->bddm) > s->bddNodes)
+    s->bddNodes = bdd_size(result->bddm);
+  if (arg)
+    dfaFree(arg);
+  return result;
+}
+
+static DFA *product(Stats *s, DFA *a, DFA *b)
+{
+  DFA *p, *m;
+
+  begin();
+  p = end(s, opProduct, dfaProduct(a, b, dfaAND), 0);
+  dfaFree(a);
+  dfaFree(b);
+  begin();
+  m = end(s, opMinimize, dfaMinimize(p), p);
+  return m;
+}
+
+static DFA *project(Stats *s, DFA *a, int index)
+{
+  DFA *p;
+
+  begin();
+  p = end(s, opProject, dfaProject(a, index), a);
+  begin();
+  return end(s, opMinimize, dfaMinimize(p), p);
+}
+
+static void analyze(Stats *s, DFA *a, int num, unsigned indices[])
+{
+  char *example;
+
+  begin();
+  example = dfaMakeExample(a, 1, num, indices);
+  s->count[opAnalyze]++;
+  s->seconds[opAnalyze] += now() - opStart;
+  if (example)
+    mem_free(example);
+}
+
+/* p_n = p_0 + n as a chain of p_i+1 = p_i + 1, with the intermediate
+   positions projected away as soon as they are no longer needed */
+static int plus1(Stats *s)
+{
+  unsigned indices[2];
+  DFA *a = dfaPlus1(1, 0, 1);
+  int i;
+
+  for (i = 1; i < s->n; i++) {
+    a = product(s, a, dfaPlus1(i+1, i, 1));
+    a = project(s, a, i);
+  }
+  indices[0] = 0;
+  indices[1] = s->n;
+  analyze(s, a, 2, indices);
+  i = a->ns == s->n + 4; /* the distance n and the dead states */
+  dfaFree(a);
+  return i;
+}
+
+/* n Presburger constants on separate variables, conjoined and then
+   projected to the first one */
+static int presbconst(Stats *s)
+{
+  unsigned indices[1];
+  DFA *a = dfaPresbConst(0, 1);
+  int i, ok;
+
+  for (i = 1; i < s->n; i++)
+    a = product(s, a, dfaPresbConst(i, (i * 40503) & 0xffff));
+  for (i = s->n - 1; i > 0; i--)
+    a = project(s, a, i);
+  indices[0] = 0;
+  analyze(s, a, 1, indices);
+  /* 1 followed by the 16 bits that the other constants need */
+  ok = s->n < 2 || a->ns == 19;
+  dfaFree(a);
+  return ok;
+}
+
+/* the pair tables of BDD/hash.c as used by minimization: rounds of n
+   state pairs inserted once and looked up twice, half of them misses,
+   in a chained table made for each round and in a flat one that is
+   cleared between rounds */
+#define PAIR_ROUNDS 8
+
+static long pairKey(long i)
+{
+  return (i * 40503) & 0xfffff;
+}
+
+static int pairtable(Stats *s)
+{
+  hash_tab h;
+  pair_map m;
+  long i, found;
+  int r;
+
+  found = 0;
+  begin();
+  for (r = 0; r < PAIR_ROUNDS; r++) {
+    h = new_hash_tab(&hash2, &eq2);
+    for (i = 0; i < s->n; i++)
+      insert_in_hash_tab(h, pairKey(i), i, (void *)(i + 1));
+    for (i = 0; i < 2 * s->n; i++)
+      found += lookup_in_hash_tab(h, pairKey(i), i) != NULL;
+    free_hash_tab(h);
+  }
+  s->count[opChained] += PAIR_ROUNDS;
+  s->seconds[opChained] += now() - opStart;
+
+  begin();
+  m = new_pair_map(&hash2, &eq2, s->n);
+  for (r = 0; r < PAIR_ROUNDS; r++) {
+    clear_pair_map(m);
+    for (i = 0; i < s->n; i++)
+      insert_in_pair_map(m, pairKey(i), i, (void *)(i + 1));
+    for (i = 0; i < 2 * s->n; i++)
+      found -= lookup_in_pair_map(m, pairKey(i), i) != NULL;
+  }
+  free_pair_map(m);
+  s->count[opFlat] += PAIR_ROUNDS;
+  s->seconds[opFlat] += now() - opStart;
+  return found == 0;
+}
+
+/* FORMULA FAMILIES */
+
+/* read 'name: hh:mm:ss.cc' or 'name: count' from mona's statistics */
+static void scanTime(const char *out, const char *name, double *seconds)
+{
+  const char *p = strstr(out, name);
+  int h, m;
+  double sec;
+
+  if (p && sscanf(p + strlen(name), " %d:%d:%lf", &h, &m, &sec) == 3)
+    *seconds = h * 3600 + m * 60 + sec;
+}
+
+static void scanCount(const char *out, const char *name, unsigned *count)
+{
+  const char *p = strstr(out, name);
+
+  if (p)
+    sscanf(p + strlen(name), " %u", count);
+}
+
+static void scanMona(Stats *s, const char *out)
+{
+  const char *p = strstr(out, "Largest number of states");
+
+  scanCount(out, "Products:", &s->count[opProduct]);
+  scanCount(out, "Projections:", &s->count[opProject]);
+  scanCount(out, "Minimizations:", &s->count[opMinimize]);
+  scanTime(out, "\nProduct:", &s->seconds[opProduct]);
+  scanTime(out, "\nProject:", &s->seconds[opProject]);
+  scanTime(out, "\nMinimize:", &s->seconds[opMinimize]);
+  if (p)
+    sscanf(p, "Largest number of states in a minimized automaton: %u, "
+	   "BDD nodes: %u", &s->states, &s->bddNodes);
+}
+
+/* run mona on a file and collect its statistics */
+static int runMona(Stats *s, const char *file)
+{
+  int fds[2], status;
+  size_t size = 0, cap = 1 << 16;
+  char *out = (char *) mem_alloc(cap);
+  ssize_t r;
+  pid_t pid;
+
+  if (pipe(fds))
+    return 0;
+  if ((pid = fork()) == 0) {
+    dup2(fds[1], 1);
+    dup2(fds[1], 2);
+    close(fds[0]);
+    close(fds[1]);
+    execl(mona, mona, "-q", "-s", "-t", file, (char *) 0);
+    _exit(127);
+  }
+  close(fds[1]);
+  while ((r = read(fds[0], out + size, cap - size - 1)) > 0)
+    if ((size += r) == cap - 1)
+      out = (char *) mem_resize(out, cap *= 2);
+  out[size] = 0;
+  close(fds[0]);
+  waitpid(pid, &status, 0);
+
+  scanMona(s, out);
+  mem_free(out);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static int example(Stats *s, const char *name)
+{
+  char file[1024];
+
+  snprintf(file, sizeof file, "%s/%s.mona", examples, name);
+  return runMona(s, file);
+}
+
+/* a temporary file for a generated formula */
+static FILE *tempFormula(char *file)
+{
+  int fd = mkstemps(file, 5);
+  FILE *f;
+
+  if (fd < 0)
+    return NULL;
+  if (!(f = fdopen(fd, "w"))) {
+    close(fd);
+    unlink(file);
+  }
+  return f;
+}
+
+/* the example itself, or the equivalence of the n-bit adder circuit
+   and the specification of addition for vectors of n+1 bits */
+static int nadder(Stats *s)
+{
+  char file[] = "/tmp/mona_benchXXXXXX.mona", line[1024], name[1024];
+  FILE *in, *out;
+  int ok;
+
+  if (s->n == 0)
+    return example(s, "nadder");
+
+  snprintf(name, sizeof name, "%s/nadder.mona", examples);
+  if (!(in = fopen(name, "r")))
+    return 0;
+  if (!(out = tempFormula(file))) {
+    fclose(in);
+    return 0;
+  }
+  /* the predicates come before the theorems */
+  while (fgets(line, sizeof line, in) && strncmp(line, "# theorems", 10))
+    fputs(line, out);
+  fprintf(out,
+	  "var2 X, Y, Z;\n"
+	  "var0 Cin, Cout;\n"
+	  "$ = %d => (add(X,Y,Z,Cin,Cout) <=> n_bit_adder(X,Y,Z,Cin,Cout));\n",
+	  s->n);
+  fclose(in);
+  fclose(out);
+  ok = runMona(s, file);
+  unlink(file);
+  return ok;
+}
+
+static int lossyqueue(Stats *s)
+{
+  return example(s, "lossy_queue");
+}
+
+static int html(Stats *s)
+{
+  return example(s, "html");
+}
+
+/* P_i+1 = 2 * P_i for i < n, starting with P_0 = 1, so that the
+   automata track n+1 Presburger numbers of growing length */
+static int presburger(Stats *s)
+{
+  char file[] = "/tmp/mona_benchXXXXXX.mona";
+  FILE *f;
+  int i, ok;
+
+  if (!(f = tempFormula(file)))
+    return 0;
+  fprintf(f,
+	  "pred xor(var0 x,y) = x&~y | ~x&y;\n"
+	  "pred at_least_two(var0 x,y,z) = x&y | x&z | y&z;\n"
+	  "pred plus(var2 p,q,r) =\n"
+	  " ex2 c: 0 notin c & all1 t:\n"
+	  "   (t+1 in c <=> at_least_two(t in p, t in q, t in c))\n"
+	  " & (t in r <=> xor(xor(t in p, t in q), t in c));\n"
+	  "var2 P0");
+  for (i = 1; i <= s->n; i++)
+    fprintf(f, ",P%d", i);
+  fprintf(f, ";\nP0 = pconst(1)");
+  for (i = 0; i < s->n; i++)
+    fprintf(f, " & plus(P%d,P%d,P%d)", i, i, i+1);
+  fprintf(f, ";\n");
+  fclose(f);
+  ok = runMona(s, file);
+  unlink(file);
+  return ok;
+}
+
+/* the same chain in tree mode, with the carry going to both successors;
+   the state spaces grow by a factor of about four per step, which makes
+   it a test of gtaMinimize */
+static int treeplus(Stats *s)
+{
+  char file[] = "/tmp/mona_benchXXXXXX.mona";
+  FILE *f;
+  int i, ok;
+
+  if (!(f = tempFormula(file)))
+    return 0;
+  fprintf(f,
+	  "ws2s;\n"
+	  "pred xor(var0 x,y) = x&~y | ~x&y;\n"
+	  "pred at_least_two(var0 x,y,z) = x&y | x&z | y&z;\n"
+	  "pred plus(var2 p,q,r) =\n"
+	  " ex2 c: root notin c & all1 t:\n"
+	  "   (t.0 in c <=> at_least_two(t in p, t in q, t in c))\n"
+	  " & (t.1 in c <=> at_least_two(t in p, t in q, t in c))\n"
+	  " & (t in r <=> xor(xor(t in p, t in q), t in c));\n"
+	  "var2 P0");
+  for (i = 1; i <= s->n; i++)
+    fprintf(f, ",P%d", i);
+  fprintf(f, ";\nroot in P0");
+  for (i = 0; i < s->n; i++)
+    fprintf(f, " & plus(P%d,P%d,P%d)", i, i, i+1);
+  fprintf(f, ";\n");
+  fclose(f);
+  ok = runMona(s, file);
+  unlink(file);
+  return ok;
+}
+
+/* CASES */
+
+#define MAX_SIZES 64
+
+typedef struct {
+  const char *name;
+  int (*run)(Stats *);
+  int numSizes;
+  int sizes[3]; /* default sizes, the example itself is size 0 */
+} Family;
+
+static Family families[] = {
+  {"plus1", plus1, 3, {64, 256, 1024}},
+  {"presbconst", presbconst, 3, {8, 32, 128}},
+  {"pairtable", pairtable, 3, {4096, 65536, 1048576}},
+  {"presburger", presburger, 3, {16, 64, 256}},
+  {"nadder", nadder, 3, {0, 1024, 16384}},
+  {"lossy_queue", lossyqueue, 1, {0}},
+  {"html", html, 1, {0}},
+  {"treeplus", treeplus, 3, {6, 8, 10}},
+  {0, 0, 0, {0}}
+};
+
+/* run one case in a child process and report it */
+static int runCase(Family *f, int n, int run)
+{
+  Stats *s = (Stats *) mmap(0, sizeof(Stats), PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  struct rusage usage;
+  double start;
+  int status, ok;
+  pid_t pid;
+
+  if (s == MAP_FAILED)
+    return 0;
+  memset(s, 0, sizeof(Stats));
+  s->family = f->name;
+  s->n = n;
+  s->run = run;
+
+  fflush(stdout);
+  start = now();
+  if ((pid = fork()) == 0)
+    _exit(f->run(s) ? 0 : 1);
+  ok = pid > 0 && wait4(pid, &status, 0, &usage) == pid &&
+    WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+  /* the resident set size includes mona when it was run */
+  printOps(s);
+  printTotal(s, now() - start, ok ? usage.ru_maxrss : 0, ok);
+  munmap(s, sizeof(Stats));
+  return ok;
+}
+
+/* the sizes given by an argument "", "=n,n,..." after the family name,
+   or none if the argument names another family */
+static int sizesOf(Family *f, char *arg, int sizes[], int max)
+{
+  int num = 0;
+
+  if (*arg == 0)
+    for (; num < f->numSizes && num < max; num++)
+      sizes[num] = f->sizes[num];
+  else if (*arg == '=')
+    do
+      sizes[num++] = (int) strtol(arg + 1, &arg, 10);
+    while (*arg == ',' && num < max);
+  return num;
+}
+
+static void usage(void)
+{
+  Family *f;
+
+  printf("usage: mona_bench [options] [family[=n,n,...]] ...\n"
+	 "  -m <mona>  the mona executable (default 'mona')\n"
+	 "  -e <dir>   the Examples directory (default 'Examples')\n"
+	 "  -r <runs>  number of runs of each case (default 1)\n"
+	 "families:");
+  for (f = families; f->name; f++)
+    printf(" %s", f->name);
+  printf("\n");
+  exit(-1);
+}
+
+int main(int argc, char *argv[])
+{
+  int runs = 1, failed = 0, i, j, r, all;
+  Family *f;
+
+  while ((i = getopt(argc, argv, "m:e:r:")) != -1)
+    switch (i) {
+    case 'm': mona = optarg; break;
+    case 'e': examples = optarg; break;
+    case 'r': runs = atoi(optarg); break;
+    default: usage();
+    }
+
+  all = optind == argc;
+  for (f = families; f->name; f++) {
+    int sizes[MAX_SIZES], num = 0;
+
+    if (all)
+      num = sizesOf(f, "", sizes, MAX_SIZES);
+    for (i = optind; i < argc; i++)
+      if (!strncmp(argv[i], f->name, strlen(f->name)))
+	num += sizesOf(f, argv[i] + strlen(f->name), sizes + num, 
+		       MAX_SIZES - num);
+
+    for (j = 0; j < num; j++)
+      for (r = 0; r < runs; r++)
+	if (!runCase(f, sizes[j], r))
+	  failed++;
+  }
+  return failed != 0;
+}
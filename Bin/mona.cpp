@@ -40,7 +40,9 @@
 #include "st_dfa.h"
 #include "st_gta.h"
 #include "timer.h"
+#include "scheduler.h"
 #include "lib.h"
+#include "autcache.h"
 #include "printline.h"
 #include "config.h"
 
@@ -99,6 +101,11 @@ ParseArguments(int argc, char *argv[])
 	  if (sscanf(argv[i]+2, "%u", &options.optimize) != 1)
 	    return false;
 	  break;
+	case 'j':
+	  if (sscanf(argv[i]+2, "%u", &options.threads) != 1 || 
+	      options.threads == 0)
+	    return false;
+	  break;
 	case 'x':
 	  if (argv[i][2] == 'w') {
 	    options.printProgress = false;
@@ -159,6 +166,13 @@ ParseArguments(int argc, char *argv[])
 	  case 'e':
 	    options.separateCompilation = true;
 	    break;
+	  case 'k':
+	    options.automatonCache = true;
+	    break;
+	  case 'l':
+	    options.lazyAnalysis = true;
+	    options.analysis = true;
+	    break;
 	  case 'i':
 	    options.intermediate = true;
 	    options.statistics = true;
@@ -210,7 +224,10 @@ Usage()
     << " -d   Dump AST, symboltable, and code DAG\n"
     << " -q   Quiet, don't print progress\n\n"
     << " -e   Enable separate compilation\n"
+    << " -k   Keep automata of subformulas in a cache across runs\n"
+    << " -l   Lazy analysis, stop the construction at the first examples\n"
     << " -oN  Code optimization level N (0=none, 1=safe, 2=heuristic) (default 1)\n"
+    << " -jN  Translate independent subformulas in N threads (default 1)\n"
 //  << " -r   Disable BDD index reordering\n"
     << " -f   Force normal tree-mode output style\n"
     << " -m   Alternative M2L-Str emulation (v1.3 style)\n"
@@ -223,7 +240,8 @@ Usage()
     << " -xw  Output whole automaton in external format (implies -n -q)\n\n"
     << "Example: mona -w -t -e foo.mona\n\n"
     << "The environment variable MONALIB defines the\n"
-    << "directory used for separate-compilation automata.\n\n"
+    << "directory used for separate-compilation automata,\n"
+    << "and MONACACHE the directory of the -k cache (default mona.cache).\n\n"
     << "Full documentation is available at http://www.brics.dk/mona\n";
 }
 
@@ -589,15 +607,47 @@ main(int argc, char *argv[])
   
   DFA *dfa = 0;
   Deque<DFA *> dfalist;
+  dfaLazy *lazy = 0;
+  Deque<dfaLazy *> lazylist;
   GTA *gta = 0;
   Deque<GTA *> gtalist;
   
   // Initialize
   bdd_init();
   codeTable->init_print_progress();
-
-  if (options.mode != TREE) { 
-    // Generate DFAs
+  if (options.automatonCache)
+    autCache.open();
+
+  if (options.mode != TREE && options.lazyAnalysis &&
+      !options.whole && !options.unrestrict) {
+    // Generate lazy DFAs, the outermost operations are left to the
+    // analysis
+    if (options.threads > 1 && !options.statistics && !options.time)
+      scheduler.start(options.threads);
+    lazy = formulaCode.DFATranslateLazy();
+    if (lastPosVar != -1)
+      lazy = st_dfa_lazy_lastpos(lazy, lastPosVar);
+    if (allPosVar != -1)
+      lazy = st_dfa_lazy_allpos(lazy, allPosVar);
+    for (Deque<VarCode>::iterator i = verifyCode.begin(); 
+	 i != verifyCode.end(); i++) {
+      dfaLazy *z = (*i).DFATranslateLazy();
+      if (lastPosVar != -1)
+	z = st_dfa_lazy_lastpos(z, lastPosVar);
+      if (allPosVar != -1)
+	z = st_dfa_lazy_allpos(z, allPosVar);
+      lazylist.push_back(z);
+    }
+    if (scheduler.active())
+      scheduler.stop();
+  }
+  else if (options.mode != TREE) { 
+    // Generate DFAs, concurrently unless per-operation statistics or
+    // timings are requested
+    if (options.threads > 1 && !options.statistics && !options.time)
+      scheduler.start(options.threads);
+    if (options.statistics)
+      predicted_dfa_in_mem = predictPeak(formulaCode, verifyCode);
     dfa = formulaCode.DFATranslate();
     if (lastPosVar != -1)
       dfa = st_dfa_lastpos(dfa, lastPosVar);
@@ -612,6 +662,8 @@ main(int argc, char *argv[])
 	d = st_dfa_allpos(d, allPosVar);
       dfalist.push_back(d);
     }
+    if (scheduler.active())
+      scheduler.stop();
   }
   else { 
     // Generate GTAs
@@ -690,7 +742,7 @@ main(int argc, char *argv[])
 	if (!dfalist.empty())
 	  cout << "Main formula:\n";
 	DFA *t = dfaCopy(dfa2);
-	st_dfa_replace_indices(t, &sign, &freeVars, false, true);
+	t = st_dfa_replace_indices(t, &sign, &freeVars, false, true);
 	dfaExport(t, 0, numVars, vnames, types);
 	dfaFree(t);
 	Deque<DFA *>::iterator i;
@@ -699,7 +751,7 @@ main(int argc, char *argv[])
 	     i != dfalist2->end(); i++, j++) {
 	  cout << "\nFormula " << *j << ":\n";
 	  t = dfaCopy(*i);
-	  st_dfa_replace_indices(t, &sign, &freeVars, false, true);
+	  t = st_dfa_replace_indices(t, &sign, &freeVars, false, true);
 	  dfaExport(t, 0, numVars, vnames, types);
 	  dfaFree(t);
 	}
@@ -727,7 +779,7 @@ main(int argc, char *argv[])
 	if (!gtalist.empty())
 	  cout << "Main formula:\n";
 	GTA *t = gtaCopy(gta2);
-	st_gta_replace_indices(t, &sign, &freeVars, false, true);
+	t = st_gta_replace_indices(t, &sign, &freeVars, false, true);
 	gtaExport(t, 0, numVars, vnames, types, statespaces, 
 		  options.inheritedAcceptance);
 	gtaFree(t);
@@ -737,7 +789,7 @@ main(int argc, char *argv[])
 	     i != gtalist2->end(); i++, j++) {
 	  cout << "\nFormula " << *j << ":\n";
 	  t = gtaCopy(*i);
-	  st_gta_replace_indices(t, &sign, &freeVars, false, true);
+	  t = st_gta_replace_indices(t, &sign, &freeVars, false, true);
 	  gtaExport(t, 0, numVars, vnames, types, statespaces, 
 		    options.inheritedAcceptance);
 	  gtaFree(t);
@@ -758,7 +810,7 @@ main(int argc, char *argv[])
 	}
       }
     }
-  else if (options.analysis &&
+  else if (options.analysis && !lazy &&
 	   !options.graphvizSatisfyingEx &&
 	   !options.graphvizCounterEx &&
 	   options.printProgress) {
@@ -807,7 +859,25 @@ main(int argc, char *argv[])
     if (options.printProgress)
       cout << "\nANALYSIS\n";
     
-    if (options.mode != TREE) {
+    if (lazy) {
+      if (!lazylist.empty())
+	cout << "Main formula:\n";
+      int n = dfaLazyAnalyze(lazy, numVars, vnames, offs, types, 
+			     options.treemodeOutput);
+      if (options.statistics)
+	cout << "States explored: " << n << "\n";
+      Deque<dfaLazy *>::iterator i;
+      Deque<char *>::iterator j;
+      for (i = lazylist.begin(), j = verifytitlelist->begin(); 
+	   i != lazylist.end(); i++, j++) {
+	cout << "\nFormula " << *j << ":\n";
+	n = dfaLazyAnalyze(*i, numVars, vnames, offs, types, 
+			   options.treemodeOutput);
+	if (options.statistics)
+	  cout << "States explored: " << n << "\n";
+      }
+    }
+    else if (options.mode != TREE) {
       if (!dfalist.empty())
 	cout << "Main formula:\n";
       dfaAnalyze(dfa, numVars, vnames, offs, types, 
@@ -858,7 +928,13 @@ main(int argc, char *argv[])
 
   ///////// CLEAN UP ///////////////////////////////////////////////////////
 
-  if (options.mode != TREE) {
+  if (lazy) {
+    dfaLazyFree(lazy);
+    for (Deque<dfaLazy *>::iterator i = lazylist.begin(); 
+	 i != lazylist.end(); i++)
+      dfaLazyFree(*i);
+  }
+  else if (options.mode != TREE) {
     dfaFree(dfa);
     for (Deque<DFA *>::iterator i = dfalist.begin(); i != dfalist.end(); i++)
       dfaFree(*i);
@@ -887,8 +963,10 @@ main(int argc, char *argv[])
   delete[] trees;
   freeTreetypes();
     
-  if (options.statistics)
+  if (options.statistics) {
     print_statistics();
+    autCache.print_statistics();
+  }
 
   if (options.time) {
     timer_total.stop();
@@ -21,39 +21,55 @@
 #include <stdlib.h>
 #include <string.h>
 #include "dfa.h"
+#include "dfa_internal.h"
 #include "../Mem/mem.h"
 
-static int *bfs_queue;
-static int *bfs_dist;
-static int *bfs_prev;
-static int bfs_current_distance; 
-static unsigned bfs_current_state; 
-static unsigned head, tail;
-
-static void automaton_bfs_explore_leaf(unsigned leaf_value)
-{ /* each leaf (except perhaps initial state) is visited exactly once */
-  bfs_dist[leaf_value] = bfs_current_distance + 1;
-  bfs_prev[leaf_value] = bfs_current_state;
-  bfs_queue[head++] = leaf_value;
-}
+/* Kept in the context because used in lazy_bfs_explore_leaf.  */
+struct bfs_state {
+  int *queue;
+  int *dist;
+  int *prev;
+  int current_distance; 
+  unsigned current_state; 
+  unsigned head, tail;
+  /* dfaLazyAnalyze */
+  dfaLazy *lazy;
+  int size;             /* length of queue, dist and prev */
+  int start_seen;       /* the start state has been reached again */
+  int found[3];         /* first state of status -1 and 1 at distance >= 1 */
+};
 
+/* the distances from the start state and the previous states on
+   shortest paths, along the graph of a; dist is -1 for a state that is
+   not reached, and 0 for the start state unless it is reached again */
 static void automaton_bfs(DFA *a, int *dist, int *prev)
 { 
-  head = 1, tail = 0;
-  bfs_dist = dist, bfs_prev = prev;
-  bfs_queue = (int *) mem_alloc((a->ns+1)*sizeof(int));
-  bfs_current_state = a->s;
-  bfs_queue[0] = bfs_current_state;
-  bfs_dist[bfs_current_state] = 0;  
-  bfs_prev[bfs_current_state] = -1;
-  bdd_prepare_apply1(a->bddm);
+  dfaGraph *g = dfaSuccessorGraph(a);
+  int *queue = (int *) mem_alloc((a->ns+1)*sizeof(int));
+  char *seen = (char *) mem_alloc(a->ns);
+  unsigned head = 1, tail = 0;
+  int i, j;
+
+  for (i = 0; i < a->ns; i++) {
+    dist[i] = -1;
+    seen[i] = 0; /* the start state may be queued once more */
+  }
+  queue[0] = a->s;
+  dist[a->s] = 0;  
+  prev[a->s] = -1;
 
   while (tail < head) {
-    bfs_current_state = bfs_queue[tail++];
-    bfs_current_distance = bfs_dist[bfs_current_state];
-    bdd_call_leafs(a->bddm, a->q[bfs_current_state], &automaton_bfs_explore_leaf);
+    i = queue[tail++];
+    for (j = g->succ_at[i]; j < g->succ_at[i+1]; j++)
+      if (!seen[g->succ[j]]) {
+	seen[g->succ[j]] = 1;
+	dist[g->succ[j]] = dist[i] + 1;
+	prev[g->succ[j]] = i;
+	queue[head++] = g->succ[j];
+      }
   }
-  mem_free(bfs_queue);
+  mem_free(seen);
+  mem_free(queue);
 }
 
 typedef struct intlist {
@@ -61,7 +77,48 @@ typedef struct intlist {
   struct intlist *next;
 } intlist;
 
+/* an example of the given length, with a column for each letter */
+static char *new_example(int no_free_vars, int length)
+{
+  char *example;
+  int i;
+
+  example = (char *) mem_alloc((no_free_vars+1) * length * sizeof(char) + 1);
+  for (i = 0; i < (no_free_vars+1) * length * sizeof(char); i++)
+    example[i] = 1;
+  example[(no_free_vars+1) * length] = 0;
+  return example;
+}
+
+/* store the letter of trace as column j of example */
+static void store_letter(char *example, int length, int j, trace_descr trace,
+			 int no_free_vars, unsigned *offsets)
+{
+  trace_descr tp;
+  int i;
+
+  for (i = 0; i < no_free_vars; i++) {
+    tp = trace;
+    while (tp && (tp->index != offsets[i])) 
+      tp = tp->next;
+      
+    if (!tp)
+      example[i*length+j] = 'X';
+    else if (tp->value)
+      example[i*length+j] = '1';
+    else
+      example[i*length+j] = '0';
+  }
+}
+
 char *dfaMakeExample(DFA *a, int polarity, int no_free_vars, unsigned *offsets)
+{
+  return dfaMakeExampleCtx(dfaCurrentContext(), a, polarity, no_free_vars,
+			   offsets);
+}
+
+char *dfaMakeExampleCtx(dfaContext *ctx, DFA *a, int polarity, 
+			int no_free_vars, unsigned *offsets)
 {
   int i, j, min_dist = -1, minv, length;
   intlist *state_list, *ip;
@@ -99,30 +156,14 @@ char *dfaMakeExample(DFA *a, int polarity, int no_free_vars, unsigned *offsets)
     state_list = ip;      
   }
   
-  example = (char *) mem_alloc((no_free_vars+1) * length * sizeof(char) + 1);
-  for (i = 0; i < (no_free_vars+1) * length * sizeof(char); i++)
-    example[i] = 1;
-  example[(no_free_vars+1) * length] = 0;
+  example = new_example(no_free_vars, length);
   
   ip = state_list;
   j = 0;
   while (ip && ip->next) {
-    trace_descr trace, tp;
+    trace_descr trace;
     trace = find_one_path(a->bddm, a->q[ip->item], ip->next->item);
-    
-    for (i = 0; i < no_free_vars; i++) {
-      tp = trace;
-      while (tp && (tp->index != offsets[i])) 
-	tp = tp->next;
-      
-      if (!tp)
-	example[i*length+j] = 'X';
-      else if (tp->value)
-	example[i*length+j] = '1';
-      else
-	example[i*length+j] = '0';
-    }
-    
+    store_letter(example, length, j, trace, no_free_vars, offsets);
     kill_trace(trace);
     ip = ip->next;
     j++;
@@ -218,15 +259,10 @@ static void print_example(char *example, char *name,
   mem_free(example);
 }
 
-void dfaAnalyze(DFA *dfa, int no_free_vars, 
-		char **free_variables, unsigned *offsets, char *types,
-		int treestyle)
+static void print_analysis(char *counterexample, char *satisfyingexample,
+			   int no_free_vars, char **free_variables, 
+			   unsigned *offsets, char *types, int treestyle)
 {
-  char *counterexample, *satisfyingexample;
-
-  counterexample = dfaMakeExample(dfa, -1, no_free_vars, offsets);
-  satisfyingexample = dfaMakeExample(dfa, 1, no_free_vars, offsets);
-
   if (!counterexample && satisfyingexample)
     printf("Formula is valid\n");
   else if (!satisfyingexample)
@@ -246,7 +282,25 @@ void dfaAnalyze(DFA *dfa, int no_free_vars,
   }
 }
 
+void dfaAnalyze(DFA *dfa, int no_free_vars, 
+		char **free_variables, unsigned *offsets, char *types,
+		int treestyle)
+{
+  char *counterexample, *satisfyingexample;
+
+  counterexample = dfaMakeExample(dfa, -1, no_free_vars, offsets);
+  satisfyingexample = dfaMakeExample(dfa, 1, no_free_vars, offsets);
+
+  print_analysis(counterexample, satisfyingexample,
+		 no_free_vars, free_variables, offsets, types, treestyle);
+}
+
 int dfaStatus(DFA *a)
+{
+  return dfaStatusCtx(dfaCurrentContext(), a);
+}
+
+int dfaStatusCtx(dfaContext *ctx, DFA *a)
 {
   int i, min_dist = -1, min_dist_ctr = -1, minv, minv_ctr;
   int *dist, *prev;
@@ -281,3 +335,379 @@ int dfaStatus(DFA *a)
   return 0;       /* Formula is invalid */
 }
 
+
+static void lazy_bfs_grow(struct bfs_state *st, int n)
+{
+  int size = st->size ? st->size : 64, i;
+
+  while (size < n)
+    size *= 2;
+  if (size == st->size)
+    return;
+  st->queue = mem_resize(st->queue, size * sizeof(int));
+  st->dist = mem_resize(st->dist, size * sizeof(int));
+  st->prev = mem_resize(st->prev, size * sizeof(int));
+  for (i = st->size; i < size; i++)
+    st->dist[i] = -1;
+  st->size = size;
+}
+
+static void lazy_bfs_explore_leaf(unsigned leaf_value)
+{ /* a leaf may be visited again when the table has been doubled */
+  struct bfs_state *st = dfaCurrentContext()->bfs;
+  int f;
+
+  lazy_bfs_grow(st, dfaLazyStates(st->lazy));
+  if (leaf_value == st->queue[0]) { /* the start state is not queued again */
+    if (st->start_seen)
+      return;
+    st->start_seen = 1;
+  }
+  else if (st->dist[leaf_value] >= 0)
+    return;
+  else
+    st->queue[st->head++] = leaf_value;
+  st->dist[leaf_value] = st->current_distance + 1;
+  st->prev[leaf_value] = st->current_state;
+  f = dfa_lazy_status(st->lazy, leaf_value);
+  if (f != 0 && st->found[f+1] < 0)
+    st->found[f+1] = leaf_value;
+}
+
+/* the example spelled by the path found to v, NULL if v is -1 */
+static char *lazy_example(struct bfs_state *st, int v,
+			  int no_free_vars, unsigned *offsets)
+{
+  int j, length, *path;
+  char *example;
+
+  if (v < 0)
+    return NULL;
+  length = st->dist[v];
+  path = (int *) mem_alloc((length+1) * sizeof(int));
+  path[length] = v;
+  for (j = length; j > 0; j--)
+    path[j-1] = st->prev[path[j]];
+
+  example = new_example(no_free_vars, length);
+  for (j = 0; j < length; j++) {
+    bdd_ptr p;
+    bdd_manager *bddm = dfa_lazy_expand(st->lazy, path[j], &p);
+    trace_descr trace = find_one_path(bddm, p, path[j+1]);
+    store_letter(example, length, j, trace, no_free_vars, offsets);
+    kill_trace(trace);
+  }
+  mem_free(path);
+  return example;
+}
+
+int dfaLazyAnalyze(dfaLazy *z, int no_free_vars, 
+		   char **free_variables, unsigned *offsets, char *types,
+		   int treestyle)
+{
+  dfaContext *ctx = dfaCurrentContext();
+  struct bfs_state st, *outer = ctx->bfs;
+  char *counterexample, *satisfyingexample;
+  bdd_manager *bddm;
+  bdd_ptr p;
+
+  ctx->bfs = &st;
+  st.lazy = z;
+  st.queue = st.dist = st.prev = NULL;
+  st.size = 0;
+  lazy_bfs_grow(&st, dfaLazyStates(z));
+  st.start_seen = 0;
+  st.found[0] = st.found[2] = -1;
+  st.head = 1, st.tail = 0;
+  st.queue[0] = dfa_lazy_initial(z);
+  st.dist[st.queue[0]] = 0;
+  st.prev[st.queue[0]] = -1;
+  /* the marks of nodes made later are clear */
+  bdd_prepare_apply1(dfa_lazy_expand(z, st.queue[0], &p));
+
+  /* stop when examples of both kinds have been found */
+  while (st.tail < st.head && (st.found[0] < 0 || st.found[2] < 0)) {
+    st.current_state = st.queue[st.tail++];
+    st.current_distance = st.dist[st.current_state];
+    bddm = dfa_lazy_expand(z, st.current_state, &p);
+    bdd_call_leafs(bddm, p, &lazy_bfs_explore_leaf);
+  }
+  ctx->bfs = outer;
+
+  counterexample = lazy_example(&st, st.found[0], no_free_vars, offsets);
+  satisfyingexample = lazy_example(&st, st.found[2], no_free_vars, offsets);
+  print_analysis(counterexample, satisfyingexample,
+		 no_free_vars, free_variables, offsets, types, treestyle);
+
+  mem_free(st.queue);
+  mem_free(st.dist);
+  mem_free(st.prev);
+  return st.tail;
+}
+
+struct dfaEnumerator_ {
+  DFA *a;
+  int num;              /* number of variables */
+  unsigned *indices;
+  int nread[2];         /* variables read in the first letter and later */
+  int *read[2];         /* by increasing index */
+  int **succ;           /* successors by letters after the first, ending
+			   with -1 */
+  char **can;           /* can[k][s]: an example may end k letters after s */
+  int ncan;             /* can[1..ncan-1] have been made */
+  int period;           /* if not 0, can[ncan] is can[period] */
+  int length;           /* of the examples being made, -1 when done */
+  int fresh;            /* no example of this length has been made */
+  int found;            /* length of the latest example */
+  int size;             /* room for states and letters */
+  int *states;          /* states[c] is reached before letter c */
+  char *letters;        /* the value of variable i in letter c is
+			   letters[c*num+i] */
+  int leaf;             /* found by next_letter */
+};
+
+/* p with the variables not read before index as 0 */
+static bdd_ptr skip_to(bdd_manager *bddm, bdd_ptr p, unsigned index)
+{
+  while (!bdd_is_leaf(bddm, p) && bdd_ifindex(bddm, p) < index)
+    p = bdd_else(bddm, p);
+  return p;
+}
+
+static unsigned read_index(dfaEnumerator *e, int kind, int i)
+{
+  return i < e->nread[kind] ? 
+    e->indices[e->read[kind][i]] : (unsigned) -1;
+}
+
+/* the successors of state s, can[1][s] is set if one of them is
+   accepting and reached by a letter that is not all 0s */
+static void collect_successors(dfaEnumerator *e, bdd_ptr p, int i, int one,
+			       int s, int *list, int *n, int *seen)
+{
+  bdd_manager *bddm = e->a->bddm;
+  unsigned leaf;
+
+  p = skip_to(bddm, p, read_index(e, 1, i));
+  if (i == e->nread[1]) {
+    leaf = bdd_leaf_value(bddm, p);
+    if (seen[leaf] != s) {
+      seen[leaf] = s;
+      list[(*n)++] = leaf;
+    }
+    if (one && e->a->f[leaf] == 1)
+      e->can[1][s] = 1;
+  }
+  else if (!bdd_is_leaf(bddm, p) && 
+	   bdd_ifindex(bddm, p) == read_index(e, 1, i)) {
+    collect_successors(e, bdd_else(bddm, p), i+1, one, s, list, n, seen);
+    collect_successors(e, bdd_then(bddm, p), i+1, 1, s, list, n, seen);
+  }
+  else /* either value, so also 1 */
+    collect_successors(e, p, i+1, 1, s, list, n, seen);
+}
+
+static char *can_end(dfaEnumerator *e, int k)
+{
+  if (e->period && k >= e->ncan)
+    k = e->period + (k - e->period) % (e->ncan - e->period);
+  return e->can[k];
+}
+
+/* make can[k], false if no example is longer than those found */
+static int make_can(dfaEnumerator *e, int k)
+{
+  int ns = e->a->ns, s, j, *t;
+  char *c;
+
+  if (e->period || k < e->ncan)
+    return 1;
+  c = (char *) mem_alloc(ns);
+  for (s = 0; s < ns; s++)
+    for (c[s] = 0, t = e->succ[s]; *t >= 0 && !c[s]; t++)
+      c[s] = e->can[k-1][*t];
+
+  /* from here on the sets repeat, and so do the lengths of examples */
+  for (j = 1; j < k; j++)
+    if (memcmp(c, e->can[j], ns) == 0) {
+      mem_free(c);
+      e->period = j;
+      return e->found - 1 >= j;
+    }
+  e->can = (char **) mem_resize(e->can, (k+1) * sizeof(char *));
+  e->can[k] = c;
+  e->ncan = k+1;
+  return 1;
+}
+
+dfaEnumerator *dfaNewEnumerator(DFA *a, int no_free_vars, unsigned *offsets,
+				char *types)
+{
+  dfaEnumerator *e = (dfaEnumerator *) mem_alloc(sizeof(dfaEnumerator));
+  int i, j, k, n, s, *list, *seen;
+  DFA *b, *p;
+
+  /* a first-order variable is the position of its first 1, the rest of
+     its track is ignored, so it is made a singleton for each model to
+     have a single example */
+  a = dfaRef(a);
+  for (i = 0; i < no_free_vars; i++)
+    if (types[i] == 1) {
+      b = dfaSingleton(offsets[i]);
+      p = dfaProduct(a, b, dfaAND);
+      dfaFree(a);
+      dfaFree(b);
+      a = dfaMinimize(p);
+      dfaFree(p);
+    }
+  e->a = a;
+  e->num = no_free_vars;
+  e->indices = (unsigned *) mem_alloc(no_free_vars * sizeof(unsigned));
+  memcpy(e->indices, offsets, no_free_vars * sizeof(unsigned));
+  for (k = 0; k < 2; k++) {
+    e->read[k] = (int *) mem_alloc(no_free_vars * sizeof(int));
+    e->nread[k] = 0;
+  }
+  for (i = 0; i < no_free_vars; i++) { /* insertion by index */
+    k = types[i] != 0;
+    for (j = e->nread[k]++; 
+	 j > 0 && offsets[e->read[k][j-1]] > offsets[i]; j--)
+      e->read[k][j] = e->read[k][j-1];
+    e->read[k][j] = i;
+  }
+
+  e->can = (char **) mem_alloc(2 * sizeof(char *));
+  e->can[0] = NULL;
+  e->can[1] = (char *) mem_alloc(a->ns);
+  memset(e->can[1], 0, a->ns);
+  e->ncan = 2;
+  e->period = 0;
+  e->succ = (int **) mem_alloc(a->ns * sizeof(int *));
+  list = (int *) mem_alloc(a->ns * sizeof(int));
+  seen = (int *) mem_alloc(a->ns * sizeof(int));
+  for (s = 0; s < a->ns; s++)
+    seen[s] = -1;
+  for (s = 0; s < a->ns; s++) {
+    n = 0;
+    collect_successors(e, a->q[s], 0, 0, s, list, &n, seen);
+    e->succ[s] = (int *) mem_alloc((n+1) * sizeof(int));
+    memcpy(e->succ[s], list, n * sizeof(int));
+    e->succ[s][n] = -1;
+  }
+  mem_free(list);
+  mem_free(seen);
+
+  e->length = 0;
+  e->found = 0;
+  e->size = 0;
+  e->states = NULL;
+  e->letters = NULL;
+  return e;
+}
+
+/* the next letter at column c, the least one after the current one if
+   tight, from which an example may be finished */
+static int next_letter(dfaEnumerator *e, bdd_ptr p, int c, int i, int tight)
+{
+  bdd_manager *bddm = e->a->bddm;
+  int kind = c > 0, r = e->length - 1 - c, v, old;
+  int *t = e->read[kind];
+  char *letter = e->letters + c * e->num;
+
+  p = skip_to(bddm, p, read_index(e, kind, i));
+  if (i == e->nread[kind]) {
+    if (tight)
+      return 0;
+    e->leaf = bdd_leaf_value(bddm, p);
+    if (r > 0)
+      return can_end(e, r)[e->leaf];
+    if (e->a->f[e->leaf] != 1)
+      return 0;
+    for (v = 0; v < e->nread[kind]; v++)
+      if (letter[t[v]])
+	return 1;
+    return kind == 0; /* only the first letter may be all 0s */
+  }
+  old = letter[t[i]];
+  for (v = tight ? old : 0; v <= 1; v++) {
+    bdd_ptr q = p;
+    if (!bdd_is_leaf(bddm, p) && bdd_ifindex(bddm, p) == e->indices[t[i]])
+      q = v ? bdd_then(bddm, p) : bdd_else(bddm, p);
+    letter[t[i]] = v;
+    if (next_letter(e, q, c, i+1, tight && v == old))
+      return 1;
+  }
+  return 0;
+}
+
+/* the next example of the current length in depth-first order */
+static int next_word(dfaEnumerator *e)
+{
+  int c = e->fresh ? 0 : e->length - 1, tight = !e->fresh;
+
+  e->fresh = 0;
+  while (c >= 0)
+    if (next_letter(e, e->a->q[e->states[c]], c, 0, tight)) {
+      e->states[++c] = e->leaf;
+      tight = 0;
+      if (c == e->length)
+	return 1;
+    }
+    else {
+      c--;
+      tight = 1;
+    }
+  return 0;
+}
+
+char *dfaNextExample(dfaEnumerator *e)
+{
+  char *example;
+  int c, i;
+
+  while (e->length >= 0) {
+    if (e->length > 0 && next_word(e)) {
+      e->found = e->length;
+      example = new_example(e->num, e->length);
+      for (c = 0; c < e->length; c++) {
+	for (i = 0; i < e->num; i++)
+	  example[i*e->length+c] = 'X';
+	for (i = 0; i < e->nread[c > 0]; i++) {
+	  int v = e->read[c > 0][i];
+	  example[v*e->length+c] = e->letters[c*e->num+v] ? '1' : '0';
+	}
+      }
+      return example;
+    }
+    e->length++;
+    e->fresh = 1;
+    if (e->length >= e->size) {
+      e->size = e->size ? 2 * e->size : 16;
+      e->states = (int *) mem_resize(e->states, (e->size+1) * sizeof(int));
+      e->letters = (char *) mem_resize(e->letters, e->size * e->num + 1);
+    }
+    e->states[0] = e->a->s;
+    if (e->length >= 2 && !make_can(e, e->length - 1))
+      e->length = -1;
+  }
+  return NULL;
+}
+
+void dfaFreeEnumerator(dfaEnumerator *e)
+{
+  int k, s;
+
+  for (k = 1; k < e->ncan; k++)
+    mem_free(e->can[k]);
+  mem_free(e->can);
+  for (s = 0; s < e->a->ns; s++)
+    mem_free(e->succ[s]);
+  mem_free(e->succ);
+  for (k = 0; k < 2; k++)
+    mem_free(e->read[k]);
+  mem_free(e->indices);
+  mem_free(e->states);
+  mem_free(e->letters);
+  dfaFree(e->a);
+  mem_free(e);
+}
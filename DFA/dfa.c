@@ -19,12 +19,87 @@
  */
 
 #include "dfa.h"
+#include "dfa_internal.h"
 #include "../BDD/hash.h"
 #include "../Mem/mem.h"
 
 int dfa_in_mem; /* number of automata currently in memory */
 int max_dfa_in_mem; /* maximum number of automata in memory */
 
+/* the counters are shared by all threads */
+static void count_dfa_in_mem(int delta)
+{
+  int n = __sync_add_and_fetch(&dfa_in_mem, delta), m;
+
+  while ((m = __atomic_load_n(&max_dfa_in_mem, __ATOMIC_RELAXED)) < n &&
+	 !__sync_bool_compare_and_swap(&max_dfa_in_mem, m, n));
+}
+
+/* the current context of a thread is its private default context
+   unless another one has been installed with dfaUseContext */
+static GNUC_THREAD dfaContext default_context;
+static GNUC_THREAD dfaContext *current_context;
+
+dfaContext *dfaNewContext(void)
+{
+  dfaContext *ctx = mem_alloc(sizeof *ctx);
+
+  mem_zero(ctx, sizeof *ctx);
+  ctx->bddc = bdd_new_context();
+  return ctx;
+}
+
+void dfaFreeContext(dfaContext *ctx)
+{
+  invariant(ctx != &default_context && ctx != current_context);
+  invariant(!ctx->product && !ctx->product_list && !ctx->project &&
+	    !ctx->minimize && !ctx->bfs && !ctx->lazy);
+  dfa_free_builder(ctx);
+  bdd_kill_context(ctx->bddc);
+  mem_free(ctx);
+}
+
+dfaContext *dfaUseContext(dfaContext *ctx)
+{
+  dfaContext *old = dfaCurrentContext();
+
+  current_context = ctx ? ctx : &default_context;
+  bdd_use_context(current_context->bddc);
+  return old;
+}
+
+dfaContext *dfaCurrentContext(void)
+{
+  return current_context ? current_context : &default_context;
+}
+
+void dfaRecoverContext(dfaContext *ctx)
+{
+  ctx->product = 0;
+  ctx->product_list = 0;
+  ctx->project = 0;
+  ctx->minimize = 0;
+  ctx->bfs = 0;
+  ctx->lazy = 0;
+  dfa_free_builder(ctx);
+  bdd_recover_context(ctx->bddc);
+}
+
+dfaSavedContext dfa_enter(dfaContext *ctx)
+{
+  dfaSavedContext saved;
+
+  saved.bdd = bdd_current_context();
+  saved.dfa = dfaUseContext(ctx);
+  return saved;
+}
+
+void dfa_leave(dfaSavedContext saved)
+{
+  current_context = saved.dfa;
+  bdd_use_context(saved.bdd);
+}
+
 DFA *dfaMake(int n)
 {
   DFA *a;
@@ -35,10 +110,10 @@ DFA *dfaMake(int n)
   a->ns = n;
   a->q = mem_alloc((sizeof *(a->q)) * n);
   a->f = mem_alloc((sizeof *(a->f)) * n); 
+  a->refs = 1;
+  a->graph = 0;
  
-  dfa_in_mem++;
-  if (dfa_in_mem>max_dfa_in_mem)
-    max_dfa_in_mem = dfa_in_mem;
+  count_dfa_in_mem(1);
   return a;
 }
 
@@ -50,25 +125,45 @@ DFA *dfaMakeNoBddm(int n)
   a->ns = n;
   a->q = mem_alloc((sizeof *(a->q)) * n);
   a->f = mem_alloc((sizeof *(a->f)) * n); 
+  a->refs = 1;
+  a->graph = 0;
 
-  dfa_in_mem++;
-  if (dfa_in_mem>max_dfa_in_mem)
-    max_dfa_in_mem = dfa_in_mem;
+  count_dfa_in_mem(1);
   return a;
 }
 
 void dfaFree(DFA *a) 
 { 
+  if (__sync_sub_and_fetch(&a->refs, 1) > 0)
+    return;
   bdd_kill_manager(a->bddm);
+  dfa_free_graph(a->graph);
   mem_free(a->q);
   mem_free(a->f);
   mem_free(a);
-  dfa_in_mem--;
+  count_dfa_in_mem(-1);
+}
+
+DFA *dfaRef(DFA *a)
+{
+  __sync_add_and_fetch(&a->refs, 1);
+  return a;
+}
+
+DFA *dfaWritable(DFA *a)
+{
+  if (__atomic_load_n(&a->refs, __ATOMIC_RELAXED) > 1) {
+    DFA *b = dfaShare(a);
+    dfaFree(a);
+    return b;
+  }
+  return a;
 }
 
 void dfaNegation(DFA *a) 
 {  
   int i;
+  invariant(a->refs == 1);
   for (i = 0; i < a->ns; i++) 
     a->f[i] = - a->f[i]; 
 }
@@ -77,6 +172,7 @@ void dfaNegation(DFA *a)
 void dfaRestrict(DFA *a) 
 {  
   int i;
+  invariant(a->refs == 1);
   for (i = 0; i < a->ns; i++)
     if (a->f[i] == -1)
       a->f[i] = 0;
@@ -85,6 +181,7 @@ void dfaRestrict(DFA *a)
 void dfaUnrestrict(DFA *a) 
 {  
   int i;
+  invariant(a->refs == 1);
   for (i = 0; i < a->ns; i++)
     if (a->f[i] == 0)
       a->f[i] = -1;
@@ -99,29 +196,71 @@ void dfaPrintStatistics()
 } 
 **/
 
-DFA *dfaCopy(DFA *a)
+/* copy the BDDs of a into bddm and set q to their roots */
+static void copy_bdds(DFA *a, bdd_manager *bddm, bdd_ptr *q)
 {
   unsigned i;
 
+  bdd_prepare_apply1(a->bddm);
+
+  for (i = 0; i < a->ns; i++)
+    (void) bdd_apply1(a->bddm, a->q[i], bddm, &fn_identity);
+  
+  mem_copy(q, bdd_roots(bddm), sizeof(bdd_ptr)*a->ns);
+}
+
+DFA *dfaCopy(DFA *a)
+{
   DFA * result = dfaMake(a->ns);
   result->ns = a->ns;
   result->s = a->s;
   mem_copy(result->f, a->f, sizeof(*a->f)*a->ns);
-  
-  bdd_prepare_apply1(a->bddm);
+  copy_bdds(a, result->bddm, result->q);
 
-  for (i = 0; i < a->ns; i++)
-    (void) bdd_apply1(a->bddm, a->q[i], result->bddm, &fn_identity);
-  
-  mem_copy(result->q, bdd_roots(result->bddm), sizeof(bdd_ptr)*a->ns);
+  return result;
+}
+
+DFA *dfaShare(DFA *a)
+{
+  DFA *result = dfaMakeNoBddm(a->ns);
+
+  result->bddm = bdd_share_manager(a->bddm);
+  result->s = a->s;
+  mem_copy(result->f, a->f, sizeof(*a->f)*a->ns);
+  mem_copy(result->q, a->q, sizeof(*a->q)*a->ns);
 
   return result;
 }
 
+/* give a a manager of its own before it is changed */
+static void unshare(DFA *a)
+{
+  if (bdd_manager_shared(a->bddm) || bdd_manager_renamed(a->bddm)) {
+    bdd_manager *bddm = 
+      bdd_new_manager(8 * a->ns, ((a->ns+3)/4)*4);
+
+    copy_bdds(a, bddm, a->q);
+    bdd_kill_manager(a->bddm);
+    a->bddm = bddm;
+  }
+}
+
 void dfaReplaceIndices(DFA *a, int *indices_map)
 {
   unsigned i;
+  bdd_manager *bddm;
+
+  invariant(a->refs == 1);
+
+  /* usually the manager is just renamed, see bdd.h, otherwise the
+     nodes are rewritten */
+  bddm = bdd_rename_manager(a->bddm, (unsigned *) indices_map);
+  if (bddm) {
+    a->bddm = bddm;
+    return;
+  }
 
+  unshare(a);
   bdd_prepare_apply1(a->bddm);
 
   for (i = 0; i < a->ns; i++)
@@ -34,47 +34,146 @@ typedef enum {
   dfaOR = 14
 } dfaProductType;
 
+typedef enum {
+  dfaREFINE,   /* partition refinement, the default */
+  dfaITERATE   /* rounds of relabelling all transitions */
+} dfaMinimizationType;
+
+/* the transitions of an automaton as a graph, in compressed rows: the
+   successors of state i are succ[succ_at[i]..succ_at[i+1]-1], each
+   once and in the order of the leaves of its BDD, and likewise for the
+   predecessors, in increasing order */
+typedef struct {
+  int ns;
+  int *succ_at, *succ;
+  int *pred_at, *pred;
+} dfaGraph;
+
 typedef struct { 
   bdd_manager *bddm; /* manager of BDD nodes */
   int ns;            /* number of states */
   bdd_ptr *q;        /* transition array */
   int s;             /* start state */
   int *f;            /* state statuses; -1:reject, 0:don't care, +1:accept */
+  int refs;          /* number of owners, see dfaRef */
+  dfaGraph *graph;   /* made by dfaSuccessorGraph, 0 until then */
 } DFA;
 
 extern int dfa_in_mem; /* number of automata currently in memory */
 extern int max_dfa_in_mem; /* maximum number of automata in memory */
 
+/* An engine context holds the working state of the operations below.
+   The *Ctx functions take it explicitly; the others run in the current
+   context of the calling thread, which is a private default context
+   unless dfaUseContext has installed another.  Threads working in
+   distinct contexts on distinct automata may run concurrently. */
+typedef struct dfaContext_ dfaContext;
+
 /* dfa.c */
+dfaContext *dfaNewContext(void);
+void dfaFreeContext(dfaContext *ctx);
+dfaContext *dfaUseContext(dfaContext *ctx); /* returns the previous one */
+dfaContext *dfaCurrentContext(void);
+/* forget the operations abandoned in ctx when the handler of
+   mem_error did not return (see mem.h), so it can be used again */
+void dfaRecoverContext(dfaContext *ctx);
 DFA *dfaMake(int n);
 DFA *dfaMakeNoBddm(int n);
 void dfaFree(DFA *a); 
+/* an automaton may have several owners, each releasing it with dfaFree;
+   only an automaton with one owner may be changed, dfaWritable makes a
+   copy if necessary */
+DFA *dfaRef(DFA *a);
+DFA *dfaWritable(DFA *a);
 void dfaNegation(DFA *a);  
 void dfaRestrict(DFA *a);  
 void dfaUnrestrict(DFA *a);  
 DFA *dfaCopy(DFA *a);
+DFA *dfaShare(DFA *a); /* copy sharing the BDD manager of a, see bdd.h */
 void dfaReplaceIndices(DFA *a, int map[]);
 
 /* product.c */
 DFA *dfaProduct(DFA *a1, DFA *a2, dfaProductType mode); 
+DFA *dfaProductCtx(dfaContext *ctx, DFA *a1, DFA *a2, dfaProductType mode);
+/* product of n >= 2 automata, mode is dfaAND or dfaOR */
+DFA *dfaProductList(DFA **a, unsigned n, dfaProductType mode);
+DFA *dfaProductListCtx(dfaContext *ctx, DFA **a, unsigned n, 
+		       dfaProductType mode);
 
 /* project.c */
 DFA *dfaProject(DFA *a, unsigned index); 
+DFA *dfaProjectCtx(dfaContext *ctx, DFA *a, unsigned index);
+/* all of n >= 1 variables projected away in one subset construction */
+DFA *dfaProjectList(DFA *a, unsigned n, unsigned indices[]);
+DFA *dfaProjectListCtx(dfaContext *ctx, DFA *a, unsigned n, 
+		       unsigned indices[]);
+/* the right quotient and projection of the product of a1 and a2, made
+   without minimizing or returning the product; product_size is set to
+   its number of states and BDD nodes unless it is NULL */
+DFA *dfaProductProject(DFA *a1, DFA *a2, dfaProductType mode, 
+		       unsigned n, unsigned indices[], int product_size[2]);
+DFA *dfaProductProjectCtx(dfaContext *ctx, DFA *a1, DFA *a2, 
+			  dfaProductType mode, unsigned n, unsigned indices[],
+			  int product_size[2]);
 
 /* minimize.c */
 DFA *dfaMinimize(DFA *a); 
+DFA *dfaMinimizeCtx(dfaContext *ctx, DFA *a);
+void dfaSetMinimization(dfaMinimizationType m);
+void dfaSetMinimizationCtx(dfaContext *ctx, dfaMinimizationType m);
 
 /* quotient.c */
 void dfaRightQuotient(DFA *a, unsigned index); 
+/* the right quotient by the letters that are 0 except on the n
+   variables; followed by dfaProjectList, it is the same as a quotient
+   and a projection for each variable in turn */
+void dfaRightQuotientList(DFA *a, unsigned n, unsigned indices[]);
 
 /* prefix.c */
 void dfaPrefixClose(DFA *a);
 
+/* graph.c: the graph of a, made once and kept with it (it is freed by
+   dfaFree and stays valid as long as a exists, as the operations that
+   change an automaton in place do not change its transitions) */
+dfaGraph *dfaSuccessorGraph(DFA *a);
+
 /* analyze.c */
 char *dfaMakeExample(DFA *a, int kind, int num, unsigned indices[]);
 void dfaAnalyze(DFA *a, int num, char *names[], 
 		unsigned indices[], char orders[], int treestyle);
 int dfaStatus(DFA *a);
+char *dfaMakeExampleCtx(dfaContext *ctx, DFA *a, int kind, int num, 
+			unsigned indices[]);
+int dfaStatusCtx(dfaContext *ctx, DFA *a);
+
+/* analyze.c: the satisfying examples of an automaton, shortest first,
+   in the format of dfaMakeExample; variables of order 0 are read in
+   the first letter only and the others in the letters after that,
+   letters are 0 for the variables not read and after the first 1 of
+   a variable of order 1, and an example whose last letter is all 0s
+   is left out as it means the same as a shorter one */
+typedef struct dfaEnumerator_ dfaEnumerator;
+dfaEnumerator *dfaNewEnumerator(DFA *a, int num, unsigned indices[],
+				char orders[]);
+char *dfaNextExample(dfaEnumerator *e); /* NULL when there are no more */
+void dfaFreeEnumerator(dfaEnumerator *e);
+
+/* lazy.c: an automaton whose states are only made when they are
+   reached, built from ordinary automata, which it takes over, by
+   products, projections, negations and restrictions; dfaLazyAnalyze
+   is dfaAnalyze with a breadth-first search that stops when both a
+   counter-example and a satisfying example have been found, it
+   returns the number of states explored */
+typedef struct dfaLazy_ dfaLazy;
+dfaLazy *dfaLazyAutomaton(DFA *a);
+dfaLazy *dfaLazyProduct(dfaLazy *l, dfaLazy *r, dfaProductType mode);
+dfaLazy *dfaLazyProject(dfaLazy *l, unsigned index);
+dfaLazy *dfaLazyNegation(dfaLazy *l);
+dfaLazy *dfaLazyRestrict(dfaLazy *l);
+void dfaLazyFree(dfaLazy *z);
+int dfaLazyStates(dfaLazy *z); /* number of states found so far */
+int dfaLazyAnalyze(dfaLazy *z, int num, char *names[], 
+		   unsigned indices[], char orders[], int treestyle);
 
 /* makebasic.c */
 void dfaSetup(int s, int len, int indices[]); 
@@ -92,6 +191,9 @@ void dfaPrintVerbose(DFA *a);
 /* external.c */
 int dfaExport(DFA *a, char *filename, int num, char *names[], char orders[]);
 DFA* dfaImport(char *filename, char ***names, int **orders);
+int dfaExportBinary(DFA *a, char *filename, int num, char *names[], 
+		    char orders[]);
+DFA* dfaImportBinary(char *filename, char ***names, int **orders);
 
 /* basic.c */
 DFA *dfaTrue();
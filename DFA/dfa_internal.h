@@ -0,0 +1,76 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#ifndef __DFA_INTERNAL_H
+#define __DFA_INTERNAL_H
+
+#include "dfa.h"
+
+/* working state of the kernels; the types are private to the source
+   files implementing them */
+struct product_state;
+struct product_list_state;
+struct project_state;
+struct minimize_state;
+struct bfs_state;
+struct builder_state;
+
+struct dfaContext_ {
+  bdd_context *bddc;               /* NULL: the thread's default one */
+  dfaMinimizationType minimization;
+  /* innermost active invocation of each kernel, reached from the BDD
+     leaf functions */
+  struct product_state *product;
+  struct product_list_state *product_list;
+  struct project_state *project;
+  struct minimize_state *minimize;
+  struct bfs_state *bfs;
+  struct builder_state *builder;   /* between dfaSetup and dfaBuild */
+  dfaLazy *lazy;                   /* the lazy automaton being expanded */
+};
+
+/* a kernel runs with its context, and the BDD context of that, 
+   installed in the calling thread */
+typedef struct {
+  dfaContext *dfa;
+  bdd_context *bdd;
+} dfaSavedContext;
+
+dfaSavedContext dfa_enter(dfaContext *ctx);
+void dfa_leave(dfaSavedContext saved);
+
+/* makebasic.c */
+void dfa_free_builder(dfaContext *ctx);
+
+/* graph.c, dfa_new_graph takes over succ_at and succ and adds the
+   predecessors; dfa_close_backward marks every state from which a
+   marked state is reachable */
+dfaGraph *dfa_new_graph(int ns, int *succ_at, int *succ);
+void dfa_free_graph(dfaGraph *g);
+void dfa_close_backward(dfaGraph *g, char *mark);
+
+/* lazy.c, the states of a lazy automaton are numbered as they are
+   found; expanding a state makes its transitions, which stay valid
+   until the next expansion */
+int dfa_lazy_initial(dfaLazy *z);
+int dfa_lazy_status(dfaLazy *z, int s);
+bdd_manager *dfa_lazy_expand(dfaLazy *z, int s, bdd_ptr *p);
+
+#endif
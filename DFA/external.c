@@ -20,6 +20,11 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "dfa.h"
 #include "../BDD/bdd_external.h"
 #include "../Mem/mem.h"
@@ -90,8 +95,8 @@ int dfaExport(DFA *a, char *filename, int num, char *vars[], char orders[])
 
 /* IMPORT */
 
-extern BddNode *table;
-extern bdd_manager *import_bddm;
+extern GNUC_THREAD BddNode *table;
+extern GNUC_THREAD bdd_manager *import_bddm;
 
 DFA *dfaImport(char* filename, char ***vars, int **orders)
 {
@@ -209,3 +214,223 @@ DFA *dfaImport(char* filename, char ***vars, int **orders)
   mem_free(table);
   return a;
 }
+
+/* BINARY FORMAT */
+
+/* a binary file consists of the header followed by
+     int      orders[num_vars]
+     int      final[states]
+     unsigned behaviour[states]     (node numbers)
+     unsigned nodes[3 * bdd_nodes]  (index, low, high)
+     char     names[names_size]     (null terminated, padded with nulls)
+   in the byte order of the writer; a leaf has index DFA_BINARY_LEAF
+   and its value as low, and every node comes after its children, so the
+   node array is read in a single pass straight from a mapping of the
+   file */
+
+#define DFA_BINARY_MAGIC "MONA DFA BINARY"
+#define DFA_BINARY_VERSION 1
+#define DFA_BINARY_ENDIAN 0x01020304u
+#define DFA_BINARY_LEAF 0xffffffffu
+
+typedef struct {
+  char magic[16];
+  unsigned version;
+  unsigned endian;
+  unsigned num_vars;
+  unsigned states;
+  unsigned initial;
+  unsigned bdd_nodes;
+  unsigned names_size;
+  unsigned reserved;
+} BinaryHeader;
+
+int dfaExportBinary(DFA *a, char *filename, int num, char *vars[], 
+		    char orders[])
+{
+  Table *table = tableInit(); 
+  BinaryHeader h;
+  FILE *file;
+  unsigned i, *u;
+  int ok, *o;
+  char *names;
+
+  if ((file = fopen(filename, "wb")) == 0)
+    return 0;
+
+  /* number the nodes, children first */
+  bdd_prepare_apply1(a->bddm); 
+  for (i = 0; i < (unsigned) a->ns; i++)  
+    export_postorder(a->bddm, a->q[i], table);
+
+  mem_zero(&h, sizeof h);
+  strcpy(h.magic, DFA_BINARY_MAGIC);
+  h.version = DFA_BINARY_VERSION;
+  h.endian = DFA_BINARY_ENDIAN;
+  h.num_vars = num;
+  h.states = a->ns;
+  h.initial = a->s;
+  h.bdd_nodes = table->noelems;
+  for (i = 0; i < (unsigned) num; i++)
+    h.names_size += strlen(vars[i]) + 1;
+  h.names_size = (h.names_size + 3) & ~3u;
+
+  o = (int *) mem_alloc(sizeof(int) * (num + 1));
+  for (i = 0; i < (unsigned) num; i++)
+    o[i] = orders[i];
+  u = (unsigned *) mem_alloc(sizeof(unsigned) * 
+			     (a->ns + 3 * table->noelems + 1));
+  for (i = 0; i < (unsigned) a->ns; i++)
+    u[i] = bdd_mark(a->bddm, a->q[i]) - 1;
+  for (i = 0; i < table->noelems; i++) {
+    u[a->ns + 3*i] = (unsigned) table->elms[i].idx;
+    u[a->ns + 3*i + 1] = table->elms[i].lo;
+    u[a->ns + 3*i + 2] = table->elms[i].hi;
+  }
+  names = (char *) mem_alloc(h.names_size + 1);
+  mem_zero(names, h.names_size + 1);
+  for (i = 0, ok = 0; i < (unsigned) num; i++) {
+    strcpy(names + ok, vars[i]);
+    ok += strlen(vars[i]) + 1;
+  }
+
+  ok = 
+    fwrite(&h, sizeof h, 1, file) == 1 &&
+    fwrite(o, sizeof(int), num, file) == (size_t) num &&
+    fwrite(a->f, sizeof(int), a->ns, file) == (size_t) a->ns &&
+    fwrite(u, sizeof(unsigned), a->ns + 3 * table->noelems, file) == 
+    (size_t) (a->ns + 3 * table->noelems) &&
+    fwrite(names, 1, h.names_size, file) == h.names_size;
+  ok = (fclose(file) == 0) && ok;
+
+  mem_free(names);
+  mem_free(u);
+  mem_free(o);
+  tableFree(table);
+  return ok;
+}
+
+/* map the file, or read it if it cannot be mapped */
+static void *map_file(char *filename, size_t *size, int *mapped)
+{
+  struct stat st;
+  void *p;
+  int fd;
+
+  if ((fd = open(filename, O_RDONLY)) < 0)
+    return 0;
+  if (fstat(fd, &st) || st.st_size == 0) {
+    close(fd);
+    return 0;
+  }
+  *size = (size_t) st.st_size;
+  p = mmap(0, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p != MAP_FAILED)
+    *mapped = 1;
+  else {
+    size_t n = 0;
+    ssize_t r;
+    *mapped = 0;
+    p = mem_alloc(*size);
+    while (n < *size && (r = read(fd, (char *) p + n, *size - n)) > 0)
+      n += r;
+    if (n < *size) {
+      mem_free(p);
+      p = 0;
+    }
+  }
+  close(fd);
+  return p;
+}
+
+static void unmap_file(void *p, size_t size, int mapped)
+{
+  if (mapped)
+    munmap(p, size);
+  else
+    mem_free(p);
+}
+
+DFA *dfaImportBinary(char *filename, char ***vars, int **orders)
+{
+  const BinaryHeader *h;
+  const int *o, *f;
+  const unsigned *q, *n;
+  const char *names;
+  size_t size, words;
+  int mapped;
+  unsigned i;
+  bdd_ptr first = 0, p;
+  DFA *a = 0;
+  void *m;
+
+  if ((m = map_file(filename, &size, &mapped)) == 0)
+    return 0;
+
+  /* check the header and that the arrays are within the file */
+  h = (const BinaryHeader *) m;
+  if (size < sizeof *h ||
+      strcmp(h->magic, DFA_BINARY_MAGIC) ||
+      h->version != DFA_BINARY_VERSION ||
+      h->endian != DFA_BINARY_ENDIAN ||
+      h->states == 0 || h->initial >= h->states ||
+      h->bdd_nodes > BDD_MAX_TOTAL_TABLE_SIZE)
+    goto done;
+  words = (size_t) h->num_vars + 2 * (size_t) h->states + 
+    3 * (size_t) h->bdd_nodes;
+  if (size != sizeof *h + sizeof(unsigned) * words + h->names_size)
+    goto done;
+  o = (const int *) (h + 1);
+  f = o + h->num_vars;
+  q = (const unsigned *) (f + h->states);
+  n = q + h->states;
+  names = (const char *) (n + 3 * h->bdd_nodes);
+  for (i = 0; i < h->states; i++)
+    if (q[i] >= h->bdd_nodes || f[i] < -1 || f[i] > 1)
+      goto done;
+  for (i = 0; i < h->bdd_nodes; i++)
+    if (n[3*i] == DFA_BINARY_LEAF ? 0 :
+	n[3*i] > BDD_MAX_INDEX || n[3*i+1] >= i || n[3*i+2] >= i ||
+	n[3*i+1] == n[3*i+2])
+      goto done;
+  if (h->names_size == 0 ? h->num_vars != 0 : 
+      names[h->names_size - 1] != 0)
+    goto done;
+
+  /* the nodes are created in file order, so node i becomes first+i */
+  a = dfaMakeNoBddm(h->states);
+  a->bddm = bdd_new_manager(h->bdd_nodes + 1, 0);
+  a->s = h->initial;
+  mem_copy(a->f, (void *) f, sizeof(int) * h->states);
+  for (i = 0; i < h->bdd_nodes; i++, n += 3) {
+    if (n[0] == DFA_BINARY_LEAF)
+      p = bdd_find_leaf_sequential(a->bddm, n[1]);
+    else
+      p = bdd_find_node_sequential(a->bddm, first + n[1], first + n[2], 
+				   n[0]);
+    if (i == 0)
+      first = p;
+    invariant(p == first + i);
+  }
+  for (i = 0; i < h->states; i++)
+    a->q[i] = first + q[i];
+
+  if (vars) {
+    *vars = (char **) mem_alloc(sizeof(char *) * (h->num_vars + 1));
+    (*vars)[h->num_vars] = 0;
+    for (i = 0; i < h->num_vars; i++) {
+      size_t len = strlen(names);
+      (*vars)[i] = (char *) mem_alloc(len + 1);
+      strcpy((*vars)[i], names);
+      names += len + 1;
+    }
+  }
+  if (orders) {
+    *orders = (int *) mem_alloc(sizeof(int) * (h->num_vars + 1));
+    mem_copy(*orders, (void *) o, sizeof(int) * h->num_vars);
+  }
+
+ done:
+  unmap_file(m, size, mapped);
+  return a;
+}
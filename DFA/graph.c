@@ -0,0 +1,196 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#include "dfa.h"
+#include "dfa_internal.h"
+#include "../Mem/mem.h"
+
+/* the BDD nodes reachable from the states, numbered in postorder with
+   the node marks (0: not visited); a leaf has lo = its state and
+   hi = -1 */
+struct extract {
+  int *lo, *hi;
+  int num_nodes, allocated;
+};
+
+static int number_nodes(struct extract *x, bdd_manager *bddm, bdd_ptr p)
+{
+  unsigned m = bdd_mark(bddm, p);
+  int lo, hi, n;
+
+  if (m)
+    return m - 1;
+  if (bdd_is_leaf(bddm, p)) {
+    lo = bdd_leaf_value(bddm, p);
+    hi = -1;
+  }
+  else {
+    lo = number_nodes(x, bddm, bdd_else(bddm, p));
+    hi = number_nodes(x, bddm, bdd_then(bddm, p));
+  }
+  if (x->num_nodes == x->allocated) {
+    x->allocated = x->allocated*2 + 64;
+    x->lo = mem_resize(x->lo, x->allocated * sizeof *x->lo);
+    x->hi = mem_resize(x->hi, x->allocated * sizeof *x->hi);
+  }
+  n = x->num_nodes++;
+  x->lo[n] = lo;
+  x->hi[n] = hi;
+  bdd_set_mark(bddm, p, n + 1);
+  return n;
+}
+
+dfaGraph *dfa_new_graph(int ns, int *succ_at, int *succ)
+{
+  dfaGraph *g = mem_alloc(sizeof *g);
+  int i, j, e = succ_at[ns];
+
+  g->ns = ns;
+  g->succ_at = succ_at;
+  g->succ = succ;
+  g->pred_at = mem_alloc((ns+1) * sizeof *g->pred_at);
+  g->pred = mem_alloc((e ? e : 1) * sizeof *g->pred);
+
+  /* counting sort by target, the sources stay in increasing order */
+  for (i = 0; i <= ns; i++)
+    g->pred_at[i] = 0;
+  for (j = 0; j < e; j++)
+    g->pred_at[succ[j] + 1]++;
+  for (i = 0; i < ns; i++)
+    g->pred_at[i+1] += g->pred_at[i];
+  for (i = 0; i < ns; i++)
+    for (j = succ_at[i]; j < succ_at[i+1]; j++)
+      g->pred[g->pred_at[succ[j]]++] = i;
+  for (i = ns; i > 0; i--)
+    g->pred_at[i] = g->pred_at[i-1];
+  g->pred_at[0] = 0;
+  return g;
+}
+
+void dfa_free_graph(dfaGraph *g)
+{
+  if (g) {
+    mem_free(g->succ_at);
+    mem_free(g->succ);
+    mem_free(g->pred_at);
+    mem_free(g->pred);
+    mem_free(g);
+  }
+}
+
+/* the successors of each state are the leaves below its root, in the
+   order bdd_call_leafs finds them; every node is visited once per
+   state, however often it is shared */
+static dfaGraph *extract_graph(DFA *a)
+{
+  struct extract x;
+  int *root = mem_alloc(a->ns * sizeof *root);
+  int *seen, *last, *stack, *succ_at, *succ;
+  int i, n, e = 0, allocated = 2 * a->ns + 8, top;
+
+  x.lo = x.hi = NULL;
+  x.num_nodes = x.allocated = 0;
+  bdd_prepare_apply1(a->bddm);
+  for (i = 0; i < a->ns; i++)
+    root[i] = number_nodes(&x, a->bddm, a->q[i]);
+
+  seen = mem_alloc((x.num_nodes ? x.num_nodes : 1) * sizeof *seen);
+  stack = mem_alloc((x.num_nodes ? x.num_nodes : 1) * sizeof *stack);
+  last = mem_alloc(a->ns * sizeof *last);
+  for (n = 0; n < x.num_nodes; n++)
+    seen[n] = -1;
+  for (i = 0; i < a->ns; i++)
+    last[i] = -1;
+  succ_at = mem_alloc((a->ns+1) * sizeof *succ_at);
+  succ = mem_alloc(allocated * sizeof *succ);
+
+  for (i = 0; i < a->ns; i++) {
+    succ_at[i] = e;
+    stack[0] = root[i];
+    seen[root[i]] = i;
+    top = 1;
+    while (top) {
+      n = stack[--top];
+      if (x.hi[n] < 0) {
+	if (last[x.lo[n]] != i) { /* a leaf of a state already found */
+	  last[x.lo[n]] = i;
+	  if (e == allocated) {
+	    allocated *= 2;
+	    succ = mem_resize(succ, allocated * sizeof *succ);
+	  }
+	  succ[e++] = x.lo[n];
+	}
+      }
+      else { /* the else-branch first */
+	if (seen[x.hi[n]] != i) {
+	  seen[x.hi[n]] = i;
+	  stack[top++] = x.hi[n];
+	}
+	if (seen[x.lo[n]] != i) {
+	  seen[x.lo[n]] = i;
+	  stack[top++] = x.lo[n];
+	}
+      }
+    }
+  }
+  succ_at[a->ns] = e;
+
+  mem_free(last);
+  mem_free(stack);
+  mem_free(seen);
+  mem_free(root);
+  mem_free(x.lo);
+  mem_free(x.hi);
+  return dfa_new_graph(a->ns, succ_at, succ);
+}
+
+dfaGraph *dfaSuccessorGraph(DFA *a)
+{
+  dfaGraph *g = __atomic_load_n(&a->graph, __ATOMIC_ACQUIRE);
+
+  if (!g) {
+    g = extract_graph(a);
+    /* another owner may have been faster */
+    if (!__sync_bool_compare_and_swap(&a->graph, (dfaGraph *) 0, g)) {
+      dfa_free_graph(g);
+      g = a->graph;
+    }
+  }
+  return g;
+}
+
+void dfa_close_backward(dfaGraph *g, char *mark)
+{
+  int *queue = mem_alloc((g->ns ? g->ns : 1) * sizeof *queue);
+  int i, j, head = 0, tail = 0;
+
+  for (i = 0; i < g->ns; i++)
+    if (mark[i])
+      queue[head++] = i;
+  while (tail < head) {
+    i = queue[tail++];
+    for (j = g->pred_at[i]; j < g->pred_at[i+1]; j++)
+      if (!mark[g->pred[j]]) {
+	mark[g->pred[j]] = 1;
+	queue[head++] = g->pred[j];
+      }
+  }
+  mem_free(queue);
+}
@@ -0,0 +1,456 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#include <stdint.h>
+#include "dfa.h"
+#include "dfa_internal.h"
+#include "../BDD/hash.h"
+#include "../Mem/mem.h"
+
+#define STATUS_TO_BOOL(s) \
+((s == -1)? 0: 1)
+
+#define BOOL_TO_STATUS(s) \
+((s == 0)? -1 : 1)
+
+/* the transitions of a state that has not been expanded yet */
+#define NOT_EXPANDED ((bdd_handle) -1)
+
+typedef enum {
+  lazyAUTOMATON,  /* an automaton made in advance */
+  lazySTATUS,     /* the states of l with other statuses */
+  lazyPRODUCT,    /* the states are pairs of states of l and r */
+  lazyPROJECT     /* the states are sets of states of l */
+} lazyKind;
+
+struct dfaLazy_ {
+  lazyKind kind;
+  DFA *a;             /* lazyAUTOMATON */
+  dfaLazy *l, *r;     /* operands */
+  int map[3];         /* lazySTATUS: status f of l becomes map[f+1] */
+  char binfun[4];     /* lazyPRODUCT: the binary function */
+  unsigned index;     /* lazyPROJECT: the variable projected away */
+
+  /* lazyPRODUCT and lazyPROJECT: a state is numbered when it first
+     appears as a leaf, and its transitions are made in bddm when they
+     are asked for */
+  int ns, size;
+  int *f;
+  int **elements;     /* the pair, or the sorted set ending with -1 */
+  bdd_handle *q;      /* NOT_EXPANDED or the transitions in bddm */
+  pair_map htbl;      /* elements -> state+1 */
+  bdd_manager *bddm;
+  unsigned seen[2];   /* table sizes of the operand managers whose nodes
+			 key the caches, see check_cache */
+
+  /* lazyPROJECT: the transitions of the states of l, projected, are
+     made in singles; the transitions of a set are the union of those
+     of its elements, made in bddm starting from the empty set */
+  bdd_manager *singles;
+  bdd_handle *single; /* NOT_EXPANDED or the transitions in singles */
+  int nsingle;
+  int empty;          /* the empty set, which is never reached */
+  bdd_handle none;    /* the leaf of the empty set in bddm */
+};
+
+static dfaLazy *new_lazy(lazyKind kind, dfaLazy *l, dfaLazy *r)
+{
+  dfaLazy *z = mem_alloc(sizeof *z);
+
+  mem_zero(z, sizeof *z);
+  z->kind = kind;
+  z->l = l;
+  z->r = r;
+  return z;
+}
+
+static bdd_manager *lazy_manager(dfaLazy *z)
+{
+  switch (z->kind) {
+  case lazyAUTOMATON:
+    return z->a->bddm;
+  case lazySTATUS:
+    return lazy_manager(z->l);
+  default:
+    return z->bddm;
+  }
+}
+
+static bdd_manager *new_manager(unsigned size)
+{
+  bdd_manager *bddm = bdd_new_manager(size, size/8 + 2);
+
+  bdd_make_cache(bddm, size, size/8 + 2);
+  bddm->cache_erase_on_doubling = TRUE;
+  return bddm;
+}
+
+/* the cache of bddm is keyed by nodes of operand, which move when the
+   table of operand grows, so it is cleared then */
+static void check_cache(bdd_manager *bddm, unsigned *seen, 
+			bdd_manager *operand)
+{
+  if (operand->table_size != *seen) {
+    unsigned size = bddm->cache_size;
+
+    bdd_kill_cache(bddm);
+    bdd_make_cache(bddm, size, 0);
+    *seen = operand->table_size;
+  }
+}
+
+static int new_state(dfaLazy *z, int *elements, int f)
+{
+  if (z->ns == z->size) {
+    z->size = z->size ? 2 * z->size : 64;
+    z->f = mem_resize(z->f, z->size * sizeof *z->f);
+    z->elements = mem_resize(z->elements, z->size * sizeof *z->elements);
+    z->q = mem_resize(z->q, z->size * sizeof *z->q);
+  }
+  z->f[z->ns] = f;
+  z->elements[z->ns] = elements;
+  z->q[z->ns] = NOT_EXPANDED;
+  return z->ns++;
+}
+
+int dfaLazyStates(dfaLazy *z)
+{
+  switch (z->kind) {
+  case lazyAUTOMATON:
+    return z->a->ns;
+  case lazySTATUS:
+    return dfaLazyStates(z->l);
+  default:
+    return z->ns;
+  }
+}
+
+int dfa_lazy_initial(dfaLazy *z)
+{
+  switch (z->kind) {
+  case lazyAUTOMATON:
+    return z->a->s;
+  case lazySTATUS:
+    return dfa_lazy_initial(z->l);
+  default:
+    return 0;
+  }
+}
+
+int dfa_lazy_status(dfaLazy *z, int s)
+{
+  switch (z->kind) {
+  case lazyAUTOMATON:
+    return z->a->f[s];
+  case lazySTATUS:
+    return z->map[dfa_lazy_status(z->l, s) + 1];
+  default:
+    return z->f[s];
+  }
+}
+
+dfaLazy *dfaLazyAutomaton(DFA *a)
+{
+  dfaLazy *z = new_lazy(lazyAUTOMATON, NULL, NULL);
+
+  z->a = a;
+  return z;
+}
+
+static dfaLazy *map_status(dfaLazy *l, int reject, int dontcare, int accept)
+{
+  int map[3] = {reject, dontcare, accept}, i;
+
+  if (l->kind != lazySTATUS) {
+    l = new_lazy(lazySTATUS, l, NULL);
+    for (i = 0; i < 3; i++)
+      l->map[i] = i - 1;
+  }
+  for (i = 0; i < 3; i++)
+    l->map[i] = map[l->map[i] + 1];
+  return l;
+}
+
+dfaLazy *dfaLazyNegation(dfaLazy *l)
+{
+  return map_status(l, 1, 0, -1);
+}
+
+dfaLazy *dfaLazyRestrict(dfaLazy *l)
+{
+  return map_status(l, 0, 0, 1);
+}
+
+/* the product state of i and j */
+static int product_state(dfaLazy *z, int i, int j)
+{
+  int s = (int)(uintptr_t) lookup_in_pair_map(z->htbl, i, j);
+  int *e, fi, fj;
+
+  if (s)
+    return s - 1;
+  e = mem_alloc(2 * sizeof *e);
+  e[0] = i;
+  e[1] = j;
+  fi = dfa_lazy_status(z->l, i);
+  fj = dfa_lazy_status(z->r, j);
+  s = new_state(z, e, (fi != 0 && fj != 0) ?
+		BOOL_TO_STATUS(z->binfun[STATUS_TO_BOOL(fi)*2 + 
+					 STATUS_TO_BOOL(fj)]) : 0);
+  insert_in_pair_map(z->htbl, i, j, (void *)(uintptr_t)(s+1));
+  return s;
+}
+
+static unsigned product_leaf(unsigned p, unsigned q)
+{
+  return product_state(dfaCurrentContext()->lazy, p, q);
+}
+
+dfaLazy *dfaLazyProduct(dfaLazy *l, dfaLazy *r, dfaProductType ff)
+{
+  dfaLazy *z = new_lazy(lazyPRODUCT, l, r);
+  unsigned size_l = bdd_size(lazy_manager(l));
+  unsigned size_r = bdd_size(lazy_manager(r));
+
+  z->binfun[0] = ff&1; z->binfun[1] = (ff&2)>>1;
+  z->binfun[2] = (ff&4)>>2; z->binfun[3] = (ff&8)>>3;
+  z->bddm = new_manager(4 + 4 * (size_l > size_r ? size_l : size_r));
+  z->htbl = new_pair_map(&hash2, &eq2, 
+			 dfaLazyStates(l) + dfaLazyStates(r));
+  (void) product_state(z, dfa_lazy_initial(l), dfa_lazy_initial(r));
+  return z;
+}
+
+/* true if state s of z is a don't-care state with a loop on all
+   letters, as in product.c such a state makes a don't-care loop */
+static int bottom_loop(dfaLazy *z, int s, bdd_manager *bddm, bdd_ptr p)
+{
+  return dfa_lazy_status(z, s) == 0 && 
+    bdd_is_leaf(bddm, p) && bdd_leaf_value(bddm, p) == (unsigned) s;
+}
+
+static void expand_product(dfaLazy *z, int s)
+{
+  dfaContext *ctx = dfaCurrentContext();
+  dfaLazy *outer = ctx->lazy;
+  int i = z->elements[s][0], j = z->elements[s][1];
+  bdd_manager *bddm_l, *bddm_r;
+  bdd_ptr p, q;
+
+  /* the operands have their own managers, so expanding r leaves the
+     nodes of l where they are */
+  bddm_l = dfa_lazy_expand(z->l, i, &p);
+  bddm_r = dfa_lazy_expand(z->r, j, &q);
+  if (bottom_loop(z->l, i, bddm_l, p) || bottom_loop(z->r, j, bddm_r, q))
+    z->q[s] = bdd_handle_find_leaf_hashed_add_root(z->bddm, s);
+  else {
+    check_cache(z->bddm, &z->seen[0], bddm_l);
+    check_cache(z->bddm, &z->seen[1], bddm_r);
+    ctx->lazy = z;
+    (void) bdd_apply2_hashed(bddm_l, p, bddm_r, q, z->bddm, &product_leaf);
+    ctx->lazy = outer;
+    z->q[s] = BDD_LAST_HANDLE(z->bddm);
+  }
+}
+
+/* the set state with the elements e, which it takes over */
+static int project_state(dfaLazy *z, int *e)
+{
+  int s = (int)(uintptr_t) lookup_in_pair_map(z->htbl, (long) e, 0);
+  int non_bottom_found = 0, plus_one_found = 0, *p;
+
+  if (s) {
+    mem_free(e);
+    return s - 1;
+  }
+  for (p = e; *p >= 0; p++) {
+    int f = dfa_lazy_status(z->l, *p);
+    non_bottom_found += (f != 0);
+    plus_one_found += (f == 1);
+  }
+  s = new_state(z, e, !non_bottom_found ? 0 : plus_one_found ? 1 : -1);
+  insert_in_pair_map(z->htbl, (long) e, 0, (void *)(uintptr_t)(s+1));
+  return s;
+}
+
+/* the set of two states of l, as proj_term1 in project.c */
+static unsigned project_leaf(unsigned state1, unsigned state2)
+{
+  dfaLazy *z = dfaCurrentContext()->lazy;
+  int *e = mem_alloc(3 * sizeof *e);
+
+  e[0] = state1 < state2 ? state1 : state2;
+  e[1] = state1 < state2 ? state2 : state1;
+  e[2] = -1;
+  if (state1 == state2)
+    e[1] = -1;
+  return project_state(z, e);
+}
+
+/* the union of two sets, as proj_term2 in project.c */
+static unsigned union_leaf(unsigned set1, unsigned set2)
+{
+  dfaLazy *z = dfaCurrentContext()->lazy;
+  int *e1, *e2, *e3, *e, n1, n2;
+
+  if ((int) set1 == z->empty)
+    return set2;
+  for (e1 = z->elements[set1]; *e1 >= 0; e1++);
+  n1 = e1 - z->elements[set1];
+  for (e2 = z->elements[set2]; *e2 >= 0; e2++);
+  n2 = e2 - z->elements[set2];
+  e = mem_alloc((n1 + n2 + 1) * sizeof *e);
+
+  for (e1 = z->elements[set1], e2 = z->elements[set2], e3 = e; 
+       *e1 >= 0 && *e2 >= 0;) {
+    if (*e1 < *e2)
+      *e3++ = *e1++;
+    else if (*e1 == *e2) {
+      *e3++ = *e1++; 
+      e2++;
+    }
+    else
+      *e3++ = *e2++;
+  }
+  while (*e1 >= 0)
+    *e3++ = *e1++;
+  while (*e2 >= 0)
+    *e3++ = *e2++;
+  *e3 = -1;
+  return project_state(z, e);
+}
+
+dfaLazy *dfaLazyProject(dfaLazy *l, unsigned var_index)
+{
+  dfaLazy *z = new_lazy(lazyPROJECT, l, NULL);
+  unsigned size = 2 * bdd_size(lazy_manager(l));
+  int *e;
+
+  z->index = var_index;
+  z->bddm = new_manager(size);
+  z->singles = new_manager(size);
+  z->htbl = new_pair_map(hashlong, eqlong, 2 * dfaLazyStates(l));
+  e = mem_alloc(2 * sizeof *e);
+  e[0] = dfa_lazy_initial(l);
+  e[1] = -1;
+  (void) project_state(z, e);
+  e = mem_alloc(sizeof *e);
+  e[0] = -1;
+  z->empty = project_state(z, e);
+  z->none = bdd_handle_find_leaf_hashed_add_root(z->bddm, z->empty);
+  return z;
+}
+
+/* the projected transitions of state i of l */
+static bdd_handle single(dfaLazy *z, int i)
+{
+  dfaContext *ctx = dfaCurrentContext();
+  dfaLazy *outer = ctx->lazy;
+  bdd_manager *bddm;
+  bdd_ptr p;
+
+  if (i >= z->nsingle) {
+    int n = z->nsingle ? z->nsingle : 64, k;
+
+    while (n <= i)
+      n *= 2;
+    z->single = mem_resize(z->single, n * sizeof *z->single);
+    for (k = z->nsingle; k < n; k++)
+      z->single[k] = NOT_EXPANDED;
+    z->nsingle = n;
+  }
+  if (z->single[i] == NOT_EXPANDED) {
+    bddm = dfa_lazy_expand(z->l, i, &p);
+    check_cache(z->singles, &z->seen[1], bddm);
+    ctx->lazy = z;
+    (void) bdd_project(bddm, p, z->index, z->singles, &project_leaf);
+    ctx->lazy = outer;
+    z->single[i] = BDD_LAST_HANDLE(z->singles);
+  }
+  return z->single[i];
+}
+
+static void expand_project(dfaLazy *z, int s)
+{
+  dfaContext *ctx = dfaCurrentContext();
+  dfaLazy *outer = ctx->lazy;
+  bdd_handle h = z->none;
+  int *e;
+
+  /* first all elements, which may make the nodes of singles move */
+  for (e = z->elements[s]; *e >= 0; e++)
+    (void) single(z, *e);
+  check_cache(z->bddm, &z->seen[0], z->singles);
+  ctx->lazy = z;
+  for (e = z->elements[s]; *e >= 0; e++) {
+    (void) bdd_apply2_hashed(z->bddm, BDD_ROOT(z->bddm, h),
+			     z->singles, BDD_ROOT(z->singles, z->single[*e]),
+			     z->bddm, &union_leaf);
+    h = BDD_LAST_HANDLE(z->bddm);
+  }
+  ctx->lazy = outer;
+  z->q[s] = h;
+}
+
+bdd_manager *dfa_lazy_expand(dfaLazy *z, int s, bdd_ptr *p)
+{
+  switch (z->kind) {
+  case lazyAUTOMATON:
+    *p = z->a->q[s];
+    return z->a->bddm;
+  case lazySTATUS:
+    return dfa_lazy_expand(z->l, s, p);
+  case lazyPRODUCT:
+    if (z->q[s] == NOT_EXPANDED)
+      expand_product(z, s);
+    break;
+  case lazyPROJECT:
+    if (z->q[s] == NOT_EXPANDED)
+      expand_project(z, s);
+    break;
+  }
+  *p = BDD_ROOT(z->bddm, z->q[s]);
+  return z->bddm;
+}
+
+void dfaLazyFree(dfaLazy *z)
+{
+  int i;
+
+  if (z->l)
+    dfaLazyFree(z->l);
+  if (z->r)
+    dfaLazyFree(z->r);
+  if (z->a)
+    dfaFree(z->a);
+  if (z->bddm)
+    bdd_kill_manager(z->bddm);
+  if (z->singles)
+    bdd_kill_manager(z->singles);
+  if (z->htbl)
+    free_pair_map(z->htbl);
+  for (i = 0; i < z->ns; i++)
+    mem_free(z->elements[i]);
+  mem_free(z->elements);
+  mem_free(z->f);
+  mem_free(z->q);
+  mem_free(z->single);
+  mem_free(z);
+}
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include "dfa.h"
+#include "dfa_internal.h"
 #include "../BDD/bdd_internal.h"
 
 #define MAX_EXCEPTION 50
@@ -33,32 +34,68 @@ struct path_descr {
   char path[MAX_VARIABLES+1];
 };
 
-int exception_index, no_exceptions;
-struct path_descr exceptions[MAX_EXCEPTION];
+/* the automaton under construction, kept in the context between
+   dfaSetup and dfaBuild */
+struct builder_state {
+  int exception_index, no_exceptions;
+  struct path_descr exceptions[MAX_EXCEPTION];
+
+  int no_states;
+  unsigned default_state;
+
+  int sorted_indices[MAX_VARIABLES];  /* holds indices, which order the offsets argument to dfaBuild */
+  int global_offsets[MAX_VARIABLES];  /* holds the offsets argument to dfaBuild */
+  int offsets_size;                   /* holds the offsets_size argument to dfaBuild */
+  char sorted_path[MAX_VARIABLES];    /* holds the current exception path, sorted according to the offsets */
+
+  DECLARE_SEQUENTIAL_LIST(sub_results, unsigned)
+
+  int exp_count;
+  bdd_ptr bddpaths[MAX_EXCEPTION];
+
+  DFA *aut;
+};
+
+static struct builder_state *builder(void)
+{
+  return dfaCurrentContext()->builder;
+}
+
+void dfa_free_builder(dfaContext *ctx)
+{
+  if (ctx->builder) {
+    FREE_SEQUENTIAL_LIST(ctx->builder->sub_results);
+    mem_free(ctx->builder);
+    ctx->builder = 0;
+  }
+}
 
 void dfaAllocExceptions(int n)
 {
+  struct builder_state *b = builder();
+
   invariant(n<=MAX_EXCEPTION);
 
-  no_exceptions = n;
-  exception_index = 0;
+  b->no_exceptions = n;
+  b->exception_index = 0;
 }
 
 void dfaStoreException(int value, char *path)
 {
-  invariant(exception_index<no_exceptions);
+  struct builder_state *b = builder();
+
+  invariant(b->exception_index<b->no_exceptions);
 
-  exceptions[exception_index].value = value;
-  strcpy(exceptions[exception_index].path, path);
+  b->exceptions[b->exception_index].value = value;
+  strcpy(b->exceptions[b->exception_index].path, path);
   
-  exception_index++;
+  b->exception_index++;
 }
 
-int no_states;
-unsigned default_state;
-
 unsigned unite_leaf_fn(unsigned p_value, unsigned q_value)
 {
+  unsigned default_state = builder()->default_state;
+
   if ((p_value == q_value) || (q_value == default_state))
     return p_value;
   else if (p_value == default_state)
@@ -95,52 +132,44 @@ bdd_ptr unite_roots(bdd_manager *bddm)
   return result;
 }
 
-int sorted_indices[MAX_VARIABLES];  /* holds indices, which order the offsets argument to dfaBuild */
-int global_offsets[MAX_VARIABLES];  /* holds the offsets argument to dfaBuild */
-int offsets_size;                   /* holds the offsets_size argument to dfaBuild */
-char sorted_path[MAX_VARIABLES];    /* holds the current exception path, sorted according to the offsets */
-
-DECLARE_SEQUENTIAL_LIST(sub_results, unsigned)
-
-bdd_ptr makepath(bdd_manager *bddm, int n, unsigned leaf_value, 
+bdd_ptr makepath(struct builder_state *b, bdd_manager *bddm, 
+		 int n, unsigned leaf_value, 
 		 void (*update_bddpaths) (unsigned (*new_place) (unsigned node)))
 {
   bdd_ptr res, sub_res, default_state_ptr;
   unsigned index;
 
-  while ((n < offsets_size) && (sorted_path[n] == 'X'))
+  while ((n < b->offsets_size) && (b->sorted_path[n] == 'X'))
     n++;
 
-  if (n >= offsets_size)
-    return (bdd_find_leaf_hashed(bddm, leaf_value, SEQUENTIAL_LIST(sub_results), update_bddpaths));
+  if (n >= b->offsets_size)
+    return (bdd_find_leaf_hashed(bddm, leaf_value, SEQUENTIAL_LIST(b->sub_results), update_bddpaths));
 
-  sub_res = makepath(bddm, n+1, leaf_value, update_bddpaths);
-  PUSH_SEQUENTIAL_LIST(sub_results, unsigned, sub_res);
-  default_state_ptr = bdd_find_leaf_hashed(bddm, default_state, SEQUENTIAL_LIST(sub_results), update_bddpaths);
-  POP_SEQUENTIAL_LIST(sub_results, unsigned, sub_res);
+  sub_res = makepath(b, bddm, n+1, leaf_value, update_bddpaths);
+  PUSH_SEQUENTIAL_LIST(b->sub_results, unsigned, sub_res);
+  default_state_ptr = bdd_find_leaf_hashed(bddm, b->default_state, SEQUENTIAL_LIST(b->sub_results), update_bddpaths);
+  POP_SEQUENTIAL_LIST(b->sub_results, unsigned, sub_res);
 
-  index = global_offsets[sorted_indices[n]];
+  index = b->global_offsets[b->sorted_indices[n]];
   
-  if (sorted_path[n] == '0')
-    res = bdd_find_node_hashed(bddm, sub_res, default_state_ptr, index, SEQUENTIAL_LIST(sub_results), update_bddpaths);
+  if (b->sorted_path[n] == '0')
+    res = bdd_find_node_hashed(bddm, sub_res, default_state_ptr, index, SEQUENTIAL_LIST(b->sub_results), update_bddpaths);
   else
-    res = bdd_find_node_hashed(bddm, default_state_ptr, sub_res, index, SEQUENTIAL_LIST(sub_results), update_bddpaths);
+    res = bdd_find_node_hashed(bddm, default_state_ptr, sub_res, index, SEQUENTIAL_LIST(b->sub_results), update_bddpaths);
 
   return res;
 }
 
-int exp_count;
-bdd_ptr bddpaths[MAX_EXCEPTION];
-
 void update_bddpaths(unsigned (*new_place) (unsigned node)) 
 {
+  struct builder_state *b = builder();
   int j;
   
-  for (j = 0; j < exp_count; j++) 
-    bddpaths[j] = new_place(bddpaths[j]);
+  for (j = 0; j < b->exp_count; j++) 
+    b->bddpaths[j] = new_place(b->bddpaths[j]);
 }
 
-void makebdd(bdd_manager *bddm)
+void makebdd(struct builder_state *b, bdd_manager *bddm)
 {
   bdd_manager *tmp_bddm;
   bdd_ptr united_bdds, default_ptr;
@@ -152,24 +181,24 @@ void makebdd(bdd_manager *bddm)
   ** insert a leaf with value 'default_state' in tmp_bddm,
   ** if not already present
   */
-  default_ptr = bdd_find_leaf_hashed(tmp_bddm, default_state, SEQUENTIAL_LIST(sub_results), &update_bddpaths); 
+  default_ptr = bdd_find_leaf_hashed(tmp_bddm, b->default_state, SEQUENTIAL_LIST(b->sub_results), &update_bddpaths); 
 
-  for (exp_count = 0; exp_count < no_exceptions; exp_count++) {
-    for (i = 0; i < offsets_size; i++)
-      sorted_path[i] = exceptions[exp_count].path[sorted_indices[i]];
+  for (b->exp_count = 0; b->exp_count < b->no_exceptions; b->exp_count++) {
+    for (i = 0; i < b->offsets_size; i++)
+      b->sorted_path[i] = b->exceptions[b->exp_count].path[b->sorted_indices[i]];
 
     /* clear the cache */
     bdd_kill_cache(tmp_bddm);
     bdd_make_cache(tmp_bddm, 8, 4);
     tmp_bddm->cache_erase_on_doubling = TRUE;
 
-    bddpaths[exp_count] = makepath(tmp_bddm, 0, exceptions[exp_count].value, &update_bddpaths);
-    PUSH_SEQUENTIAL_LIST(tmp_bddm->roots, unsigned, bddpaths[exp_count]);
+    b->bddpaths[b->exp_count] = makepath(b, tmp_bddm, 0, b->exceptions[b->exp_count].value, &update_bddpaths);
+    PUSH_SEQUENTIAL_LIST(tmp_bddm->roots, unsigned, b->bddpaths[b->exp_count]);
   }    
 
-  if (no_exceptions == 0)
+  if (b->no_exceptions == 0)
     united_bdds = default_ptr;
-  else if (no_exceptions == 1) 
+  else if (b->no_exceptions == 1) 
     united_bdds = TOP_SEQUENTIAL_LIST(tmp_bddm->roots);
   else
     united_bdds = unite_roots(tmp_bddm);
@@ -182,6 +211,7 @@ void makebdd(bdd_manager *bddm)
 
 int offsets_cmp(const void *index1, const void *index2) 
 {
+  int *global_offsets = builder()->global_offsets;
   int o1, o2;
   
   o1 = global_offsets[*((int *)index1)];
@@ -192,53 +222,61 @@ int offsets_cmp(const void *index1, const void *index2)
   else return 1;
 }
 
-DFA *aut;
-
 void dfaSetup(int ns, int os, int *offsets)
 {
+  dfaContext *ctx = dfaCurrentContext();
+  struct builder_state *b;
   int i;
 
   invariant(os<=MAX_VARIABLES);
 
-  MAKE_SEQUENTIAL_LIST(sub_results, unsigned, 64);
+  dfa_free_builder(ctx); /* left over from an unfinished automaton */
+  b = ctx->builder = mem_alloc(sizeof *b);
+
+  MAKE_SEQUENTIAL_LIST(b->sub_results, unsigned, 64);
   
-  no_states = ns;
+  b->no_states = ns;
+  b->no_exceptions = b->exception_index = 0;
 
-  offsets_size = os;
-  for (i = 0; i < offsets_size; i++) {
-    sorted_indices[i] = i;
-    global_offsets[i] = offsets[i];
+  b->offsets_size = os;
+  for (i = 0; i < b->offsets_size; i++) {
+    b->sorted_indices[i] = i;
+    b->global_offsets[i] = offsets[i];
   }
 
-  qsort(sorted_indices, offsets_size, sizeof(int), &offsets_cmp);
+  qsort(b->sorted_indices, b->offsets_size, sizeof(int), &offsets_cmp);
 
-  aut = dfaMake(no_states);
+  b->aut = dfaMake(b->no_states);
 
-  aut->ns = no_states;
-  aut->s = 0;
+  b->aut->ns = b->no_states;
+  b->aut->s = 0;
 }
 
 void dfaStoreState(int ds)
 {
-  default_state = ds;
+  struct builder_state *b = builder();
+
+  b->default_state = ds;
 
-  bdd_kill_cache(aut->bddm);
-  bdd_make_cache(aut->bddm, 8, 4);
+  bdd_kill_cache(b->aut->bddm);
+  bdd_make_cache(b->aut->bddm, 8, 4);
 
-  makebdd(aut->bddm);
+  makebdd(b, b->aut->bddm);
 }
 
 DFA *dfaBuild(char *finals)
 {
+  struct builder_state *b = builder();
+  DFA       *aut = b->aut;
   int        i;
   unsigned  *root_ptr;
 
-  for (i=0, root_ptr = bdd_roots(aut->bddm); i < no_states; root_ptr++, i++) {
+  for (i=0, root_ptr = bdd_roots(aut->bddm); i < b->no_states; root_ptr++, i++) {
     aut->q[i] = *root_ptr;
     aut->f[i] = (finals[i] == '-') ? -1 : (finals[i] == '+' ? 1 : 0);
   }
 
-  FREE_SEQUENTIAL_LIST(sub_results);
+  dfa_free_builder(dfaCurrentContext());
 
   return aut;
 }
@@ -20,47 +20,464 @@
 
 #include <stdint.h>
 #include "dfa.h"
+#include "dfa_internal.h"
 #include "../BDD/hash.h"
 #include "../Mem/mem.h"
 
 /* used by minimization_term_fn */
-static int *final;
-static unsigned *discrs;
-static unsigned length;
+struct minimize_state {
+  int *final;
+  unsigned *discrs;
+  unsigned length;
+  pair_map htbl;   /* used by rename_partition, cleared each round */
+};
 
 static bdd_ptr minimization_term_fn(bdd_ptr p)
 {
-  return (discrs[p]);
+  return (dfaCurrentContext()->minimize->discrs[p]);
 }
 
  
-static unsigned rename_partition(unsigned *roots)
+static unsigned rename_partition(struct minimize_state *st, unsigned *roots)
 /* calculate equivalence classes as given by the conjunction of bdd_roots 
 and final; put the result in discrs and return the number of classes*/
 {  
-  hash_tab htbl = new_hash_tab(&hash2, &eq2);
+  pair_map htbl = st->htbl;
   unsigned next = 0;
   unsigned i;
   
-  for (i = 0;  i < length; i++) {
-    unsigned k = (unsigned)(uintptr_t) lookup_in_hash_tab(htbl, (unsigned)roots[i], final[i]);
+  clear_pair_map(htbl);
+  for (i = 0;  i < st->length; i++) {
+    unsigned k = (unsigned)(uintptr_t) lookup_in_pair_map(htbl, (unsigned)roots[i], st->final[i]);
 
     if (k == 0) {
-      insert_in_hash_tab(htbl, 
-			 (unsigned)roots[i], final[i],
+      insert_in_pair_map(htbl, 
+			 (unsigned)roots[i], st->final[i],
 			 (void *)(uintptr_t) ++next);
-      discrs[i] = next - 1;
+      st->discrs[i] = next - 1;
     }
     else
-      discrs[i] = k - 1;
+      st->discrs[i] = k - 1;
   };
-  free_hash_tab(htbl);
 
   return(next);
 }
 
 
-DFA *dfaMinimize(DFA *a) 
+/* Partition refinement.  The signature of a state is its transition BDD
+   with each leaf relabelled by the block of the target state; the
+   relabelled nodes are hash-consed, so equal signatures get equal
+   numbers.  Splitting a block gives new block numbers to all parts but
+   the largest, and in the next round only the nodes above the leaves
+   of the states that moved are relabelled, so only the predecessors of
+   those states are re-examined. */
+
+#define RF_LEAF ((unsigned) -1)
+
+typedef struct {
+  unsigned index;  /* BDD index, RF_LEAF for leaves */
+  unsigned lo, hi; /* successor nodes, lo is the state for leaves */
+} rf_node;
+
+typedef struct {
+  unsigned index, lo, hi, id;
+} rf_entry;
+
+struct refine {
+  /* the BDD nodes reachable from the states, numbered in postorder so
+     successors come before predecessors */
+  rf_node *nodes;
+  unsigned num_nodes, allocated;
+  unsigned *root;                  /* node of each state */
+  unsigned *parents, *parents_at;  /* predecessor nodes of each node */
+  unsigned *leaves, *leaves_at;    /* leaf nodes of each state */
+  unsigned *roots, *roots_at;      /* states with each node as root */
+  /* relabelled nodes */
+  unsigned *sig;                   /* signature of each node */
+  rf_entry *table;                 /* hash-consing of signatures */
+  unsigned table_size, table_used, next_sig;
+  /* the partition; the states of block b are elems[first[b]..last[b]) */
+  unsigned *block, *elems, *first, *last;
+  unsigned num_blocks;
+};
+
+static unsigned rf_collect(struct refine *r, bdd_manager *bddm, bdd_ptr p)
+{
+  unsigned m = bdd_mark(bddm, p), n;
+  rf_node node;
+
+  if (m)
+    return m - 1;
+  if (bdd_is_leaf(bddm, p)) {
+    node.index = RF_LEAF;
+    node.lo = bdd_leaf_value(bddm, p);
+    node.hi = 0;
+  }
+  else {
+    node.index = bdd_ifindex(bddm, p);
+    node.lo = rf_collect(r, bddm, bdd_else(bddm, p));
+    node.hi = rf_collect(r, bddm, bdd_then(bddm, p));
+  }
+  if (r->num_nodes == r->allocated) {
+    r->allocated = r->allocated*2 + 64;
+    r->nodes = mem_resize(r->nodes, r->allocated * sizeof *r->nodes);
+  }
+  n = r->num_nodes++;
+  r->nodes[n] = node;
+  bdd_set_mark(bddm, p, n + 1);
+  return n;
+}
+
+/* make the lists elms[at[i]..at[i+1]) of the pairs (key, val) */
+static void rf_lists(unsigned n, unsigned m, unsigned *key, unsigned *val,
+		     unsigned **elms, unsigned **at)
+{
+  unsigned i;
+
+  *at = mem_alloc((n+1) * sizeof **at);
+  *elms = mem_alloc((m ? m : 1) * sizeof **elms);
+  mem_zero(*at, (n+1) * sizeof **at);
+  for (i = 0; i < m; i++)
+    (*at)[key[i]+1]++;
+  for (i = 0; i < n; i++)
+    (*at)[i+1] += (*at)[i];
+  for (i = 0; i < m; i++)
+    (*elms)[(*at)[key[i]]++] = val[i];
+  for (i = n; i > 0; i--)
+    (*at)[i] = (*at)[i-1];
+  (*at)[0] = 0;
+}
+
+static unsigned rf_hash(unsigned index, unsigned lo, unsigned hi)
+{
+  return (index * 46349u) ^ (lo * 2654435761u) ^ (hi * 40503u + hi);
+}
+
+/* the number of the signature (index, lo, hi) */
+static unsigned rf_cons(struct refine *r, unsigned index, unsigned lo, 
+			unsigned hi)
+{
+  unsigned h, mask = r->table_size - 1;
+  rf_entry *e;
+
+  if (2 * r->table_used >= r->table_size) {
+    rf_entry *old = r->table;
+    unsigned i, old_size = r->table_size;
+
+    r->table_size *= 2;
+    r->table = mem_alloc(r->table_size * sizeof *r->table);
+    for (i = 0; i < r->table_size; i++)
+      r->table[i].id = RF_LEAF;
+    mask = r->table_size - 1;
+    for (i = 0; i < old_size; i++)
+      if (old[i].id != RF_LEAF) {
+	for (h = rf_hash(old[i].index, old[i].lo, old[i].hi) & mask;
+	     r->table[h].id != RF_LEAF; h = (h+1) & mask);
+	r->table[h] = old[i];
+      }
+    mem_free(old);
+  }
+
+  for (h = rf_hash(index, lo, hi) & mask; ; h = (h+1) & mask) {
+    e = &r->table[h];
+    if (e->id == RF_LEAF) {
+      e->index = index;
+      e->lo = lo;
+      e->hi = hi;
+      e->id = r->next_sig++;
+      r->table_used++;
+      return e->id;
+    }
+    if (e->index == index && e->lo == lo && e->hi == hi)
+      return e->id;
+  }
+}
+
+static unsigned rf_signature(struct refine *r, unsigned n)
+{
+  rf_node *node = &r->nodes[n];
+
+  if (node->index == RF_LEAF)
+    return rf_cons(r, RF_LEAF, r->block[node->lo], 0);
+  if (r->sig[node->lo] == r->sig[node->hi])
+    return r->sig[node->lo];
+  return rf_cons(r, node->index, r->sig[node->lo], r->sig[node->hi]);
+}
+
+/* binary heap of node numbers, smallest first */
+typedef struct {
+  unsigned *elms, size;
+  char *in;
+} rf_heap;
+
+static void rf_push(rf_heap *h, unsigned n)
+{
+  unsigned i, t;
+
+  if (h->in[n])
+    return;
+  h->in[n] = 1;
+  for (i = h->size++, h->elms[i] = n; 
+       i > 0 && h->elms[(i-1)/2] > h->elms[i]; i = (i-1)/2) {
+    t = h->elms[i];
+    h->elms[i] = h->elms[(i-1)/2];
+    h->elms[(i-1)/2] = t;
+  }
+}
+
+static unsigned rf_pop(rf_heap *h)
+{
+  unsigned res = h->elms[0], i = 0, c, t;
+
+  h->elms[0] = h->elms[--h->size];
+  while ((c = 2*i + 1) < h->size) {
+    if (c+1 < h->size && h->elms[c+1] < h->elms[c])
+      c++;
+    if (h->elms[i] <= h->elms[c])
+      break;
+    t = h->elms[i];
+    h->elms[i] = h->elms[c];
+    h->elms[c] = t;
+    i = c;
+  }
+  h->in[res] = 0;
+  return res;
+}
+
+/* sort the states s[0..n) by key[root[s]] */
+static void rf_sort(struct refine *r, unsigned *s, unsigned n, unsigned *tmp)
+{
+  unsigned i, j, k, m = n/2;
+
+  if (n < 2)
+    return;
+  rf_sort(r, s, m, tmp);
+  rf_sort(r, s+m, n-m, tmp);
+  for (i = 0, j = m, k = 0; k < n; k++)
+    if (j == n || (i < m && r->sig[r->root[s[i]]] <= r->sig[r->root[s[j]]]))
+      tmp[k] = s[i++];
+    else
+      tmp[k] = s[j++];
+  mem_copy(s, tmp, n * sizeof *s);
+}
+
+/* the end of the part of block [first, last) starting at j, where the
+   states before stay are unaffected and the rest are sorted */
+static unsigned rf_part_end(struct refine *r, unsigned j, unsigned stay,
+			    unsigned last)
+{
+  unsigned k;
+
+  if (j < stay)
+    return stay;
+  for (k = j+1; k < last && r->sig[r->root[r->elems[k]]] ==
+	 r->sig[r->root[r->elems[j]]]; k++);
+  return k;
+}
+
+/* split the blocks of the affected states aff[0..num_aff) by
+   signature, put the states that get a new block in moved and return
+   their number; the unaffected states of a block all have the same
+   signature, which differs from those of the affected ones */
+static unsigned rf_split(struct refine *r, unsigned *aff, unsigned num_aff,
+			 char *affected, unsigned *moved, unsigned *tmp)
+{
+  unsigned i, j, k, b, first, last, stay, largest, num_moved = 0;
+
+  for (i = 0; i < num_aff; i++) {
+    if (!affected[aff[i]])
+      continue; /* its block is done */
+    b = r->block[aff[i]];
+    first = r->first[b];
+    last = r->last[b];
+
+    /* move the affected states to the end and sort them */
+    for (j = first, stay = last; j < stay; )
+      if (affected[r->elems[j]]) {
+	unsigned t = r->elems[--stay];
+	r->elems[stay] = r->elems[j];
+	r->elems[j] = t;
+      }
+      else
+	j++;
+    rf_sort(r, &r->elems[stay], last - stay, tmp);
+    for (j = first; j < last; j++)
+      affected[r->elems[j]] = 0;
+
+    /* the largest part keeps the block number */
+    for (j = largest = first; j < last; j = k) {
+      k = rf_part_end(r, j, stay, last);
+      if (k - j > rf_part_end(r, largest, stay, last) - largest)
+	largest = j;
+    }
+    for (j = first; j < last; j = k) {
+      k = rf_part_end(r, j, stay, last);
+      if (j == largest) {
+	r->first[b] = j;
+	r->last[b] = k;
+      }
+      else {
+	unsigned nb = r->num_blocks++, l;
+
+	r->first[nb] = j;
+	r->last[nb] = k;
+	for (l = j; l < k; l++) {
+	  r->block[r->elems[l]] = nb;
+	  moved[num_moved++] = r->elems[l];
+	}
+      }
+    }
+  }
+  return num_moved;
+}
+
+/* compute the coarsest partition of the states of a that respects the
+   statuses and the transitions; put the class of each state, numbered
+   by first occurrence, in discrs and return the number of classes */
+static unsigned refine_partition(DFA *a, unsigned *discrs)
+{
+  struct refine r;
+  unsigned ns = a->ns, i, n, m, num_aff, num_moved, count[3];
+  unsigned *key, *val, *aff, *moved, *tmp;
+  char *affected;
+  rf_heap heap;
+
+  mem_zero(&r, sizeof r);
+  r.root = mem_alloc(ns * sizeof *r.root);
+  bdd_prepare_apply1(a->bddm);
+  for (i = 0; i < ns; i++)
+    r.root[i] = rf_collect(&r, a->bddm, a->q[i]);
+  n = r.num_nodes;
+
+  /* predecessors, leaves and roots */
+  key = mem_alloc((2*n + ns) * sizeof *key);
+  val = mem_alloc((2*n + ns) * sizeof *val);
+  for (i = m = 0; i < n; i++)
+    if (r.nodes[i].index != RF_LEAF) {
+      key[m] = r.nodes[i].lo;
+      val[m++] = i;
+      if (r.nodes[i].hi != r.nodes[i].lo) {
+	key[m] = r.nodes[i].hi;
+	val[m++] = i;
+      }
+    }
+  rf_lists(n, m, key, val, &r.parents, &r.parents_at);
+  for (i = m = 0; i < n; i++)
+    if (r.nodes[i].index == RF_LEAF) {
+      key[m] = r.nodes[i].lo;
+      val[m++] = i;
+    }
+  rf_lists(ns, m, key, val, &r.leaves, &r.leaves_at);
+  for (i = 0; i < ns; i++) {
+    key[i] = r.root[i];
+    val[i] = i;
+  }
+  rf_lists(n, ns, key, val, &r.roots, &r.roots_at);
+  mem_free(key);
+  mem_free(val);
+
+  /* the initial partition by status */
+  r.block = mem_alloc(ns * sizeof *r.block);
+  r.elems = mem_alloc(ns * sizeof *r.elems);
+  r.first = mem_alloc((ns+1) * sizeof *r.first);
+  r.last = mem_alloc((ns+1) * sizeof *r.last);
+  count[0] = count[1] = count[2] = 0;
+  for (i = 0; i < ns; i++)
+    count[a->f[i] + 1]++;
+  for (i = 0, m = 0; i < 3; i++)
+    if (count[i]) {
+      r.first[r.num_blocks] = m;
+      r.last[r.num_blocks] = m;
+      m += count[i];
+      count[i] = r.num_blocks++;
+    }
+  for (i = 0; i < ns; i++) {
+    r.block[i] = count[a->f[i] + 1];
+    r.elems[r.last[r.block[i]]++] = i;
+  }
+
+  /* the signatures of all nodes */
+  r.table_size = 1024;
+  r.table = mem_alloc(r.table_size * sizeof *r.table);
+  for (i = 0; i < r.table_size; i++)
+    r.table[i].id = RF_LEAF;
+  r.sig = mem_alloc((n ? n : 1) * sizeof *r.sig);
+  for (i = 0; i < n; i++)
+    r.sig[i] = rf_signature(&r, i);
+
+  /* refine until stable, first with all states affected */
+  aff = mem_alloc(ns * sizeof *aff);
+  moved = mem_alloc(ns * sizeof *moved);
+  tmp = mem_alloc(ns * sizeof *tmp);
+  affected = mem_alloc(ns);
+  heap.elms = mem_alloc((n ? n : 1) * sizeof *heap.elms);
+  heap.in = mem_alloc(n ? n : 1);
+  heap.size = 0;
+  mem_zero(heap.in, n);
+  for (i = 0; i < ns; i++) {
+    aff[i] = i;
+    affected[i] = 1;
+  }
+  num_aff = ns;
+  while ((num_moved = rf_split(&r, aff, num_aff, affected, moved, tmp))) {
+    for (i = 0; i < num_moved; i++)
+      for (m = r.leaves_at[moved[i]]; m < r.leaves_at[moved[i]+1]; m++)
+	rf_push(&heap, r.leaves[m]);
+    num_aff = 0;
+    while (heap.size) {
+      unsigned p = rf_pop(&heap), sig = rf_signature(&r, p);
+
+      if (sig == r.sig[p])
+	continue;
+      r.sig[p] = sig;
+      for (m = r.parents_at[p]; m < r.parents_at[p+1]; m++)
+	rf_push(&heap, r.parents[m]);
+      for (m = r.roots_at[p]; m < r.roots_at[p+1]; m++)
+	if (!affected[r.roots[m]]) {
+	  affected[r.roots[m]] = 1;
+	  aff[num_aff++] = r.roots[m];
+	}
+    }
+  }
+
+  /* number the classes by first occurrence */
+  for (i = 0; i < r.num_blocks; i++)
+    r.first[i] = RF_LEAF;
+  for (i = 0, m = 0; i < ns; i++) {
+    if (r.first[r.block[i]] == RF_LEAF)
+      r.first[r.block[i]] = m++;
+    discrs[i] = r.first[r.block[i]];
+  }
+  invariant(m == r.num_blocks);
+
+  mem_free(heap.elms);
+  mem_free(heap.in);
+  mem_free(affected);
+  mem_free(tmp);
+  mem_free(moved);
+  mem_free(aff);
+  mem_free(r.sig);
+  mem_free(r.table);
+  mem_free(r.block);
+  mem_free(r.elems);
+  mem_free(r.first);
+  mem_free(r.last);
+  mem_free(r.roots);
+  mem_free(r.roots_at);
+  mem_free(r.leaves);
+  mem_free(r.leaves_at);
+  mem_free(r.parents);
+  mem_free(r.parents_at);
+  mem_free(r.root);
+  mem_free(r.nodes);
+  return m;
+}
+
+/* the old algorithm: refine by rounds of apply1 of all states until
+   the number of classes stops growing; return the manager of the last
+   round */
+static bdd_manager *minimize_iterate(struct minimize_state *st, DFA *a,
+				     unsigned *num_blocs)
 {
   unsigned num_old_blocs;
   unsigned num_new_blocs = 2;
@@ -69,15 +486,11 @@ DFA *dfaMinimize(DFA *a)
   bdd_manager *new_bddm = 0;
   unsigned not_first = 0;
 
-  length = a->ns;
-  final = a->f;
-  
-  discrs = mem_alloc((sizeof *discrs) * length);
-  
+  st->htbl = new_pair_map(&hash2, &eq2, st->length);
   {
-    unsigned *roots =  mem_alloc((size_t)(sizeof *roots) * length);
-    mem_zero(roots,(size_t)(sizeof *roots) * length);
-    rename_partition(roots);
+    unsigned *roots =  mem_alloc((size_t)(sizeof *roots) * st->length);
+    mem_zero(roots,(size_t)(sizeof *roots) * st->length);
+    rename_partition(st, roots);
     mem_free(roots);
   }
   
@@ -94,27 +507,85 @@ DFA *dfaMinimize(DFA *a)
 			       bddm->table_elements/8 + 4);
     bdd_prepare_apply1(bddm);
     
-    for (i = 0; i < length; i++)
+    for (i = 0; i < st->length; i++)
 	(void) bdd_apply1(bddm, a->q[i], new_bddm, &minimization_term_fn);
     
     num_old_blocs = num_new_blocs;
-    num_new_blocs = rename_partition(bdd_roots(new_bddm));
+    num_new_blocs = rename_partition(st, bdd_roots(new_bddm));
 
   } while (num_new_blocs > num_old_blocs);
+  free_pair_map(st->htbl);
+
+  *num_blocs = num_new_blocs;
+  return new_bddm;
+}
+
+/* partition refinement followed by a single apply1 round */
+static bdd_manager *minimize_refine(struct minimize_state *st, DFA *a,
+				    unsigned *num_blocs)
+{
+  unsigned i;
+  bdd_manager *bddm = a->bddm;
+  bdd_manager *new_bddm;
+
+  *num_blocs = refine_partition(a, st->discrs);
+  new_bddm = bdd_new_manager(bddm->table_elements, 
+			     bddm->table_elements/8 + 4);
+  bdd_prepare_apply1(bddm);
+  for (i = 0; i < st->length; i++)
+    (void) bdd_apply1(bddm, a->q[i], new_bddm, &minimization_term_fn);
+  return new_bddm;
+}
+
+void dfaSetMinimization(dfaMinimizationType m)
+{
+  dfaSetMinimizationCtx(dfaCurrentContext(), m);
+}
+
+void dfaSetMinimizationCtx(dfaContext *ctx, dfaMinimizationType m)
+{
+  ctx->minimization = m;
+}
+
+DFA *dfaMinimize(DFA *a) 
+{
+  return dfaMinimizeCtx(dfaCurrentContext(), a);
+}
+
+DFA *dfaMinimizeCtx(dfaContext *ctx, DFA *a) 
+{
+  unsigned num_blocs;
+  unsigned i;
+  bdd_manager *new_bddm;
+  struct minimize_state st, *outer = ctx->minimize;
+  dfaSavedContext saved = dfa_enter(ctx);
+
+  ctx->minimize = &st;
+  st.length = a->ns;
+  st.final = a->f;
+  
+  st.discrs = mem_alloc((sizeof *st.discrs) * st.length);
+
+  if (ctx->minimization == dfaITERATE)
+    new_bddm = minimize_iterate(&st, a, &num_blocs);
+  else
+    new_bddm = minimize_refine(&st, a, &num_blocs);
   
   {
-    DFA *b = dfaMakeNoBddm(num_new_blocs);
+    DFA *b = dfaMakeNoBddm(num_blocs);
     unsigned *roots = bdd_roots(new_bddm);
 
     b->bddm = new_bddm;
-    for (i = 0; i < length; i++) {
-      b->q[discrs[i]]  = roots[i];
-      b->f[discrs[i]]  = final[i];
+    for (i = 0; i < st.length; i++) {
+      b->q[st.discrs[i]]  = roots[i];
+      b->f[st.discrs[i]]  = st.final[i];
     }
-    b->s = discrs[a->s];
+    b->s = st.discrs[a->s];
     
     bdd_update_statistics(new_bddm, (unsigned)MINIMIZATION);
-    mem_free(discrs);
+    mem_free(st.discrs);
+    ctx->minimize = outer;
+    dfa_leave(saved);
     return (b);
   }
 }
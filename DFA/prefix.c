@@ -18,75 +18,24 @@
  * USA.
  */
 
-#include <stdlib.h>
 #include "dfa.h"
+#include "dfa_internal.h"
 #include "../Mem/mem.h"
 
-static int **preds; /* preds[i] is the set of predecessors of i */
-static int *predalloc, *predused; /* allocated/used size of preds[i] */
-
-static int current_state;
-
-void successors(bdd_manager *bddm, bdd_ptr p)
-{
-  if (bdd_is_leaf(bddm, p)) { 
-    int i;
-    int s = bdd_leaf_value(bddm, p); /* current_state is a predecessor of s */
-
-    for (i = 0; i < predused[s]; i++) /* already there? */
-      if (preds[s][i] == current_state)
-	return;
-
-    if (predalloc[s] == predused[s]) { /* need to reallocate? */
-      predalloc[s] = predalloc[s]*2+8;
-      preds[s] = (int *) mem_resize(preds[s], sizeof(int) * predalloc[s]);
-    }
-
-    preds[s][predused[s]++] = current_state;
-  }
-  else {
-    successors(bddm, bdd_else(bddm, p));
-    successors(bddm, bdd_then(bddm, p));
-  }
-  
-}
-
 void dfaPrefixClose(DFA *a)
 {
-  unsigned i;
-  int *queue = (int *) mem_alloc(sizeof(int) * a->ns);
-  int queueused = 0, next = 0;
+  int i;
+  char *mark = mem_alloc(a->ns);
 
-  predalloc = (int *) mem_alloc(sizeof(int) * a->ns);
-  predused = (int *) mem_alloc(sizeof(int) * a->ns);
-  preds = (int **) mem_alloc(sizeof(int *) * a->ns);
-  for (i = 0; i < a->ns; i++) {
-    predalloc[i] = predused[i] = 0;
-    preds[i] = 0;
-  }
+  invariant(a->refs == 1);
 
-  /* find predecessor sets and initialize queue with final states */
-  for (i = 0; i < a->ns; i++) {
-    current_state = i;
-    successors(a->bddm, a->q[i]);
-    if (a->f[i] == 1)
-      queue[queueused++] = i;
-  }
+  /* the states from which an accepting state is reachable accept */
+  for (i = 0; i < a->ns; i++)
+    mark[i] = (a->f[i] == 1);
+  dfa_close_backward(dfaSuccessorGraph(a), mark);
+  for (i = 0; i < a->ns; i++)
+    if (mark[i])
+      a->f[i] = 1;
 
-  /* color */
-  while (next < queueused) {
-    for (i = 0; i < predused[queue[next]]; i++)
-      if (a->f[preds[queue[next]][i]] != 1) {
-	a->f[preds[queue[next]][i]] = 1;
-	queue[queueused++] = preds[queue[next]][i];
-      }
-    next++;
-  }
-    
-  for (i = 0; i < a->ns; i++) 
-    mem_free(preds[i]);
-  mem_free(preds);
-  mem_free(predused);
-  mem_free(predalloc);
-  mem_free(queue);
+  mem_free(mark);
 }
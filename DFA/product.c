@@ -21,8 +21,10 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "dfa.h"
+#include "dfa_internal.h"
 #include "../BDD/hash.h"
 #include "../Mem/mem.h"
+#include "../Mem/arena.h"
 
 #define STATUS_TO_BOOL(s) \
 ((s == -1)? 0: 1)
@@ -38,9 +40,9 @@ struct list_ {
 
 typedef struct list_ *list;
 
-list new_list(unsigned i1, unsigned i2, list nxt)
+list new_list(arena mem, unsigned i1, unsigned i2, list nxt)
 {  
-  list l = mem_alloc(sizeof *l);
+  list l = arena_alloc(mem, sizeof *l);
 
   l->li1 = i1;
   l->li2 = i2;
@@ -49,23 +51,27 @@ list new_list(unsigned i1, unsigned i2, list nxt)
   return(l);
 }
 
-/* These global because used in prod_term_fn.  */
-static int last_state;
-static list qst, qh, qt;
-static hash_tab htbl;  
+/* Kept in the context because used in prod_term_fn.  */
+struct product_state {
+  int last_state;
+  list qst, qh, qt;
+  pair_map htbl;  
+  arena mem;      /* holds the list */
+};
 
 unsigned prod_term_fn(unsigned  p, unsigned q)
 {    
+  struct product_state *st = dfaCurrentContext()->product;
   int res;
 
-  if ( (res = (int)(uintptr_t) lookup_in_hash_tab(htbl, p, q)) )
+  if ( (res = (int)(uintptr_t) lookup_in_pair_map(st->htbl, p, q)) )
     /* res = 0 or id+1 */
     return (--res);
   else {
-    insert_in_hash_tab(htbl,  p, 
-		       q, (void *)(uintptr_t) (res = ++last_state));
-    qt->next = new_list(p, q, (list) 0);
-    qt = qt->next;
+    insert_in_pair_map(st->htbl,  p, 
+		       q, (void *)(uintptr_t) (res = ++st->last_state));
+    st->qt->next = new_list(st->mem, p, q, (list) 0);
+    st->qt = st->qt->next;
 
     return (--res);
   }
@@ -73,9 +79,10 @@ unsigned prod_term_fn(unsigned  p, unsigned q)
 
  
 /*insert a loop for the product state (p, q) */
-static GNUC_INLINE void make_loop (bdd_manager *bddm, unsigned p, unsigned q) {
+static GNUC_INLINE void make_loop (struct product_state *st, 
+				   bdd_manager *bddm, unsigned p, unsigned q) {
   int res;
-  res = (int)(uintptr_t) lookup_in_hash_tab(htbl, p, q);
+  res = (int)(uintptr_t) lookup_in_pair_map(st->htbl, p, q);
   invariant(res);
   /* res = 0 or id+1 */
   (--res);
@@ -122,12 +129,19 @@ static GNUC_INLINE int make_a_loop_status (int is_loop_p, int status_p,
 }
 
 DFA *dfaProduct(DFA* a1, DFA* a2, dfaProductType ff) 
+{
+  return dfaProductCtx(dfaCurrentContext(), a1, a2, ff);
+}
+
+DFA *dfaProductCtx(dfaContext *ctx, DFA* a1, DFA* a2, dfaProductType ff) 
 {
   DFA *b;
   int i;
   unsigned *root_ptr;
   char binfun[4];
   int make_a_loop;
+  struct product_state st, *outer = ctx->product;
+  dfaSavedContext saved = dfa_enter(ctx);
   
   unsigned size_estimate = 4 + 4 *
     (bdd_size(a1->bddm) > bdd_size(a2->bddm) ? 
@@ -153,58 +167,525 @@ DFA *dfaProduct(DFA* a1, DFA* a2, dfaProductType ff)
   binfun[0] = ff&1; binfun[1] = (ff&2)>>1;     /* The binary function */
   binfun[2] = (ff&4)>>2; binfun[3] = (ff&8)>>3;
   
-  qst = qh = qt = new_list(a1->s, a2->s, (list) 0);
-  htbl = new_hash_tab(&hash2, &eq2);
-  insert_in_hash_tab(htbl, a1->s, a2->s, (void *) 1);
-  last_state = 1;  /* Careful here! Bdd's start at 0, hashtbl at 1 */
+  ctx->product = &st;
+  st.mem = new_arena(0);
+  st.qst = st.qh = st.qt = new_list(st.mem, a1->s, a2->s, (list) 0);
+  st.htbl = new_pair_map(&hash2, &eq2, a1->ns + a2->ns);
+  insert_in_pair_map(st.htbl, a1->s, a2->s, (void *) 1);
+  st.last_state = 1;  /* Careful here! Bdd's start at 0, hashtbl at 1 */
   
-  while(qh) {      /* Our main loop, nice and tight */
-    make_a_loop = make_a_loop_status(is_loop(a1->bddm, qh->li1, 
-					     a1->q[qh->li1]),
-				     a1->f[qh->li1],
-				     is_loop(a2->bddm, qh->li2,
-					     a2->q[qh->li2]),
-				     a2->f[qh->li2],
+  while(st.qh) {      /* Our main loop, nice and tight */
+    make_a_loop = make_a_loop_status(is_loop(a1->bddm, st.qh->li1, 
+					     a1->q[st.qh->li1]),
+				     a1->f[st.qh->li1],
+				     is_loop(a2->bddm, st.qh->li2,
+					     a2->q[st.qh->li2]),
+				     a2->f[st.qh->li2],
 				     binfun);
     if  (make_a_loop != 2) 
-      make_loop(bddm, qh->li1, qh->li2);
+      make_loop(&st, bddm, st.qh->li1, st.qh->li2);
     else {
 #ifdef _AUTOMATON_HASHED_IN_PRODUCT_
-      (void) bdd_apply2_hashed (a1->bddm, a1->q[qh->li1], 
-				a2->bddm, a2->q[qh->li2],
+      (void) bdd_apply2_hashed (a1->bddm, a1->q[st.qh->li1], 
+				a2->bddm, a2->q[st.qh->li2],
 				bddm,
 				&prod_term_fn);
 #else       
-      (void) bdd_apply2_sequential (a1->bddm, a1->q[qh->li1], 
-				    a2->bddm, a2->q[qh->li2], 
+      (void) bdd_apply2_sequential (a1->bddm, a1->q[st.qh->li1], 
+				    a2->bddm, a2->q[st.qh->li2], 
 				    bddm,
 				    &prod_term_fn);
 #endif	     
     }
-    qh = qh->next;
+    st.qh = st.qh->next;
   }
-  b = dfaMakeNoBddm(last_state);   /* Return the result */
+  b = dfaMakeNoBddm(st.last_state);   /* Return the result */
   b->s = 0;             /* Always first on list */
   b->bddm = bddm;
   for (i=0, root_ptr = bdd_roots(bddm); 
-       i < last_state; root_ptr++, i++) {
-    list qnxt;
-    
+       i < st.last_state; root_ptr++, i++) {
     b->q[i] = *root_ptr;
-    b->f[i] = ((a1->f[qst->li1] != 0) && (a2->f[qst->li2] != 0)) ?
+    b->f[i] = ((a1->f[st.qst->li1] != 0) && (a2->f[st.qst->li2] != 0)) ?
       /* both states are non-bottom, use "binfun" */
-      BOOL_TO_STATUS(binfun[STATUS_TO_BOOL(a1->f[qst->li1])*2 
-			   + STATUS_TO_BOOL(a2->f[qst->li2])]) :
+      BOOL_TO_STATUS(binfun[STATUS_TO_BOOL(a1->f[st.qst->li1])*2 
+			   + STATUS_TO_BOOL(a2->f[st.qst->li2])]) :
       /* at least one is bottom */
       0;
-    qnxt = qst->next;
-    mem_free(qst);      /* Free the list */
-    qst = qnxt;
+    st.qst = st.qst->next;
   }
   
-  free_hash_tab(htbl);
+  free_arena(st.mem);    /* Free the list */
+  free_pair_map(st.htbl);
+  ctx->product = outer;
   bdd_update_statistics(bddm, (unsigned) PRODUCT);
   bdd_kill_cache(b->bddm);
+  dfa_leave(saved);
   return(b);
   
 }
+
+/* N-ary product of automata under an associative operation.  The
+   states are the reachable tuples (q_0,...,q_n-1) of operand states.
+   The successors of a tuple are found by combining the transition
+   BDDs of the operands one at a time, so the leaves of an intermediate
+   BDD denote prefixes (q_0,...,q_i); each operand level numbers its
+   prefixes, and the numbers at the last level are the product
+   states.  A tuple where some operand is stuck in a don't-care state,
+   or in the absorbing status of the operation while no operand can
+   reach a don't-care state any more, is replaced by a single sink. */
+
+#define PL_STUCK      1  /* some operand loops in the absorbing status */
+#define PL_BOTTOM     2  /* some operand can reach a don't-care state */
+#define PL_SINK_BOTTOM 4 /* the sink for tuples stuck in don't-care */
+#define PL_SINK_STUCK 8  /* the sink for tuples stuck in the absorbing 
+			    status */
+
+#define PL_NO_PARENT ((unsigned) -1)
+
+typedef struct {
+  unsigned parent; /* number of the prefix at the previous level */
+  unsigned q;      /* state of the operand at this level */
+  int flags;
+} pl_prefix;
+
+typedef struct {
+  pl_prefix *elms;
+  unsigned noelems, allocated;
+  pair_map htbl;   /* (parent, q) -> number+1 */
+  int sink[2];     /* numbers of the sinks, -1 if not made yet */
+} pl_level;
+
+/* Kept in the context because used in prod_list_term_fn.  */
+struct product_list_state {
+  unsigned n;
+  DFA **a;             /* operands, in the order they are combined */
+  char **to_bottom;    /* to_bottom[i][q]: a don't-care state can be
+			  reached from state q of operand i, NULL if 
+			  operand i has no don't-care states */
+  char *bottom_after;  /* bottom_after[i]: some operand after i has
+			  don't-care states */
+  int stuck;           /* the absorbing status of the operation */
+  unsigned level;      /* operand combined by the current apply */
+  pl_level *levels;
+};
+
+static unsigned pl_new(pl_level *l, unsigned parent, unsigned q, int flags)
+{
+  if (l->noelems == l->allocated) {
+    l->allocated = l->allocated*2 + 16;
+    l->elms = mem_resize(l->elms, l->allocated * sizeof *l->elms);
+  }
+  l->elms[l->noelems].parent = parent;
+  l->elms[l->noelems].q = q;
+  l->elms[l->noelems].flags = flags;
+  return l->noelems++;
+}
+
+static unsigned pl_sink(pl_level *l, int sink)
+{
+  int k = (sink == PL_SINK_STUCK);
+
+  if (l->sink[k] == -1)
+    l->sink[k] = pl_new(l, PL_NO_PARENT, 0, sink);
+  return l->sink[k];
+}
+
+/* number of the prefix obtained by extending prefix p of the previous
+   level with state q of the operand at the given level */
+static unsigned pl_extend(struct product_list_state *st, unsigned level,
+			  unsigned p, unsigned q)
+{
+  pl_level *l = &st->levels[level];
+  DFA *a = st->a[level];
+  int flags = 0, res;
+
+  if (level > 0) {
+    flags = st->levels[level-1].elms[p].flags;
+    if (flags & (PL_SINK_BOTTOM | PL_SINK_STUCK))
+      return pl_sink(l, flags);
+  }
+  if (is_loop(a->bddm, q, a->q[q])) {
+    if (a->f[q] == 0)
+      return pl_sink(l, PL_SINK_BOTTOM);
+    if (a->f[q] == st->stuck)
+      flags |= PL_STUCK;
+  }
+  if (st->to_bottom[level] && st->to_bottom[level][q])
+    flags |= PL_BOTTOM;
+  if ((flags & (PL_STUCK | PL_BOTTOM)) == PL_STUCK && 
+      !st->bottom_after[level])
+    return pl_sink(l, PL_SINK_STUCK);
+
+  if ((res = (int)(uintptr_t) lookup_in_pair_map(l->htbl, p, q)))
+    return res - 1;
+  res = pl_new(l, p, q, flags);
+  insert_in_pair_map(l->htbl, p, q, (void *)(uintptr_t) (res + 1));
+  return res;
+}
+
+static unsigned prod_list_term_fn(unsigned p, unsigned q)
+{
+  struct product_list_state *st = dfaCurrentContext()->product_list;
+
+  if (st->level == 1) /* p is a state of the first operand */
+    p = pl_extend(st, 0, PL_NO_PARENT, p);
+  return pl_extend(st, st->level, p, q);
+}
+
+/* mark the BDD nodes below p by whether a leaf with a state in 
+   'bottom' is reachable, using the node marks (0: not visited) */
+static int reaches_bottom(bdd_manager *bddm, bdd_ptr p, char *bottom)
+{
+  unsigned m = bdd_mark(bddm, p);
+  int res;
+
+  if (m)
+    return m - 1;
+  if (bdd_is_leaf(bddm, p))
+    res = bottom[bdd_leaf_value(bddm, p)];
+  else
+    res = reaches_bottom(bddm, bdd_then(bddm, p), bottom) ||
+      reaches_bottom(bddm, bdd_else(bddm, p), bottom);
+  bdd_set_mark(bddm, p, res + 1);
+  return res;
+}
+
+/* the states of a from which a don't-care state can be reached, NULL
+   if there are no don't-care states */
+static char *find_to_bottom(DFA *a)
+{
+  char *bottom;
+  int i, changed;
+
+  for (i = 0; i < a->ns && a->f[i] != 0; i++);
+  if (i == a->ns)
+    return NULL;
+
+  bottom = mem_alloc(a->ns);
+  for (i = 0; i < a->ns; i++)
+    bottom[i] = (a->f[i] == 0);
+  do {
+    changed = 0;
+    bdd_prepare_apply1(a->bddm);
+    for (i = 0; i < a->ns; i++)
+      if (!bottom[i] && reaches_bottom(a->bddm, a->q[i], bottom))
+	bottom[i] = changed = 1;
+  } while (changed);
+  return bottom;
+}
+
+/* the product of the tuples of a[0..n-1], n >= 3, combined in that
+   order */
+static DFA *product_tuples(DFA **a, unsigned n, dfaProductType ff)
+{
+  DFA *b;
+  unsigned i, s, p, *q, size_estimate = 4;
+  int status;
+  char binfun[4];
+  bdd_manager *bddm, **mgr;
+  unsigned *mgr_size;
+  bdd_ptr root;
+  pl_level *last;
+  dfaContext *ctx = dfaCurrentContext();
+  struct product_list_state st, *outer = ctx->product_list;
+
+  binfun[0] = ff&1; binfun[1] = (ff&2)>>1;     /* The binary function */
+  binfun[2] = (ff&4)>>2; binfun[3] = (ff&8)>>3;
+
+  ctx->product_list = &st;
+  st.n = n;
+  st.a = a;
+  st.stuck = (ff == dfaAND) ? -1 : 1;
+  st.level = 0;
+
+  st.to_bottom = mem_alloc(n * sizeof *st.to_bottom);
+  st.bottom_after = mem_alloc(n);
+  st.levels = mem_alloc(n * sizeof *st.levels);
+  for (i = 0; i < n; i++) {
+    st.to_bottom[i] = find_to_bottom(st.a[i]);
+    st.levels[i].elms = NULL;
+    st.levels[i].noelems = st.levels[i].allocated = 0;
+    st.levels[i].htbl = new_pair_map(&hash2, &eq2, 2 * st.a[i]->ns);
+    st.levels[i].sink[0] = st.levels[i].sink[1] = -1;
+    if (bdd_size(st.a[i]->bddm) > size_estimate)
+      size_estimate = bdd_size(st.a[i]->bddm);
+  }
+  for (i = n; i > 0; i--)
+    st.bottom_after[i-1] = (i < n) && 
+      (st.bottom_after[i] || st.to_bottom[i] != NULL);
+  size_estimate = 4 + 4 * size_estimate;
+
+  /* mgr[i] holds the BDDs with the prefixes of level i as leaves; the
+     intermediate levels are hashed, so that prefixes shared by
+     several tuples are combined only once */
+  mgr = mem_alloc(n * sizeof *mgr);
+  mgr_size = mem_alloc(n * sizeof *mgr_size);
+  mgr[0] = st.a[0]->bddm;
+  for (i = 1; i < n-1; i++) {
+    mgr[i] = bdd_new_manager(size_estimate, size_estimate/8 + 2);
+    bdd_make_cache(mgr[i], size_estimate, size_estimate/8 + 2);
+    mgr[i]->cache_erase_on_doubling = TRUE;
+  }
+  mgr[n-1] = bddm = bdd_new_manager(size_estimate, 0);
+  bdd_make_cache(bddm, size_estimate, size_estimate/8 + 2); 
+  for (i = 1; i < n; i++)
+    mgr_size[i] = mgr[i-1]->table_total_size;
+
+  /* the initial tuple becomes state 0 */
+  for (i = 0, p = PL_NO_PARENT; i < n; i++)
+    p = pl_extend(&st, i, p, st.a[i]->s);
+  invariant(p == 0);
+
+  q = mem_alloc(n * sizeof *q);
+  last = &st.levels[n-1];
+  for (s = 0; s < last->noelems; s++) {   /* the list grows as we go */
+    int loop = 1;
+
+    if (!(last->elms[s].flags & (PL_SINK_BOTTOM | PL_SINK_STUCK))) {
+      for (i = n-1, p = s; ; i--) {
+	q[i] = st.levels[i].elms[p].q;
+	p = st.levels[i].elms[p].parent;
+	loop = loop && is_loop(st.a[i]->bddm, q[i], st.a[i]->q[q[i]]);
+	if (i == 0)
+	  break;
+      }
+    }
+    if (loop) {
+      /* a sink, or all operands loop: the tuple loops */
+      invariant(bdd_roots_length(bddm) == s);
+      BDD_ADD_ROOT(bddm, bdd_find_leaf_sequential(bddm, s));
+      continue;
+    }
+
+    root = st.a[0]->q[q[0]];
+    for (i = 1; i < n; i++) {
+      st.level = i;
+      if (mgr[i-1]->table_total_size != mgr_size[i]) {
+	/* the nodes of level i-1 have been rehashed, so the cache of 
+	   level i refers to old positions */
+	mgr_size[i] = mgr[i-1]->table_total_size;
+	bdd_kill_cache(mgr[i]);
+	bdd_make_cache(mgr[i], size_estimate, size_estimate/8 + 2);
+      }
+      if (i < n-1)
+	root = bdd_apply2_hashed(mgr[i-1], root,
+				 st.a[i]->bddm, st.a[i]->q[q[i]],
+				 mgr[i], &prod_list_term_fn);
+      else
+	(void) bdd_apply2_sequential(mgr[i-1], root,
+				     st.a[i]->bddm, st.a[i]->q[q[i]],
+				     bddm, &prod_list_term_fn);
+    }
+  }
+
+  b = dfaMakeNoBddm(last->noelems);   /* Return the result */
+  b->s = 0;
+  b->bddm = bddm;
+  for (s = 0; s < last->noelems; s++) {
+    b->q[s] = bdd_roots(bddm)[s];
+    if (last->elms[s].flags & PL_SINK_BOTTOM)
+      b->f[s] = 0;
+    else if (last->elms[s].flags & PL_SINK_STUCK)
+      b->f[s] = st.stuck;
+    else {
+      for (i = n-1, p = s, status = 1; ; i--) {
+	int f = st.a[i]->f[st.levels[i].elms[p].q];
+	
+	if (f == 0)
+	  status = 0;
+	else if (status != 0)
+	  status = (i == n-1) ? f :
+	    BOOL_TO_STATUS(binfun[STATUS_TO_BOOL(f)*2 + 
+				  STATUS_TO_BOOL(status)]);
+	p = st.levels[i].elms[p].parent;
+	if (i == 0)
+	  break;
+      }
+      b->f[s] = status;
+    }
+  }
+
+  for (i = 0; i < n; i++) {
+    if (i > 0 && i < n-1)
+      bdd_kill_manager(mgr[i]);
+    if (st.to_bottom[i])
+      mem_free(st.to_bottom[i]);
+    free_pair_map(st.levels[i].htbl);
+    mem_free(st.levels[i].elms);
+  }
+  mem_free(q);
+  mem_free(mgr_size);
+  mem_free(mgr);
+  mem_free(st.levels);
+  mem_free(st.bottom_after);
+  mem_free(st.to_bottom);
+  ctx->product_list = outer;
+  bdd_update_statistics(bddm, (unsigned) PRODUCT);
+  bdd_kill_cache(b->bddm);
+  return b;
+}
+
+/* the variable indices some transition depends on */
+struct support {
+  char *in;        /* in[i] != 0 if index i is in the support */
+  unsigned size;   /* length of in */
+  unsigned count;  /* number of indices in the support */
+};
+
+static void add_index(struct support *s, unsigned i)
+{
+  if (i >= s->size) {
+    unsigned size = i*2 + 16;
+    s->in = mem_resize(s->in, size);
+    mem_zero(s->in + s->size, size - s->size);
+    s->size = size;
+  }
+  if (!s->in[i]) {
+    s->in[i] = 1;
+    s->count++;
+  }
+}
+
+static void collect_support(struct support *s, bdd_manager *bddm, bdd_ptr p)
+{
+  if (bdd_mark(bddm, p))
+    return;
+  bdd_set_mark(bddm, p, 1);
+  if (bdd_is_leaf(bddm, p))
+    return;
+  add_index(s, bdd_ifindex(bddm, p));
+  collect_support(s, bddm, bdd_else(bddm, p));
+  collect_support(s, bddm, bdd_then(bddm, p));
+}
+
+/* the number of indices of s that are not in t */
+static unsigned fresh_indices(struct support *s, struct support *t)
+{
+  unsigned i, n = 0;
+
+  for (i = 0; i < s->size; i++)
+    if (s->in[i] && (i >= t->size || !t->in[i]))
+      n++;
+  return n;
+}
+
+/* order the operands for the product: the smallest automaton first,
+   then each time the one expected to grow the product least; an
+   operand whose variables are all present already constrains the
+   product without adding to it, one on fresh variables multiplies its
+   number of states by its own, and the other ones are in between;
+   ties go to the smaller BDDs, as they are cheaper to combine */
+static void order_operands(DFA **a, unsigned n, DFA **sorted)
+{
+  struct support *s = mem_alloc(n * sizeof *s), joined;
+  char *done = mem_alloc(n);
+  unsigned i, k, best = 0, *bdds = mem_alloc(n * sizeof *bdds);
+  double growth, least = 0;
+  int j;
+
+  for (i = 0; i < n; i++) {
+    s[i].in = NULL;
+    s[i].size = s[i].count = 0;
+    bdd_prepare_apply1(a[i]->bddm);
+    for (j = 0; j < a[i]->ns; j++)
+      collect_support(&s[i], a[i]->bddm, a[i]->q[j]);
+    bdds[i] = bdd_size(a[i]->bddm);
+    done[i] = 0;
+  }
+  joined.in = NULL;
+  joined.size = joined.count = 0;
+
+  for (k = 0; k < n; k++) {
+    int found = 0;
+
+    for (i = 0; i < n; i++) {
+      if (done[i])
+	continue;
+      if (k == 0)
+	growth = a[i]->ns;
+      else if (s[i].count == 0)
+	growth = 1;
+      else
+	growth = 1 + (a[i]->ns - 1) * 
+	  (double) fresh_indices(&s[i], &joined) / s[i].count;
+      if (!found || growth < least || 
+	  (growth == least && bdds[i] < bdds[best])) {
+	found = 1;
+	best = i;
+	least = growth;
+      }
+    }
+    sorted[k] = a[best];
+    done[best] = 1;
+    for (i = 0; i < s[best].size; i++)
+      if (s[best].in[i])
+	add_index(&joined, i);
+  }
+
+  for (i = 0; i < n; i++)
+    mem_free(s[i].in);
+  mem_free(joined.in);
+  mem_free(bdds);
+  mem_free(done);
+  mem_free(s);
+}
+
+/* the operands of a group are explored together as long as the product
+   of their numbers of states stays below this bound */
+#define PRODUCT_LIST_GROUP 4096.0
+
+DFA *dfaProductList(DFA **a, unsigned n, dfaProductType ff)
+{
+  return dfaProductListCtx(dfaCurrentContext(), a, n, ff);
+}
+
+DFA *dfaProductListCtx(dfaContext *ctx, DFA **a, unsigned n, 
+		       dfaProductType ff)
+{
+  DFA **sorted, **group, *res = NULL, *b;
+  unsigned i, k;
+  double size;
+  dfaSavedContext saved;
+
+  invariant(n >= 2 && (ff == dfaAND || ff == dfaOR));
+  saved = dfa_enter(ctx);
+
+  sorted = mem_alloc(n * sizeof *sorted);
+  order_operands(a, n, sorted);
+
+  /* the operands are combined in groups of bounded size; the product
+     of a group is minimized and becomes the first operand of the next
+     group, so the tuple space never grows far beyond the minimal
+     automata */
+  group = mem_alloc(n * sizeof *group);
+  for (i = 0; i < n; ) {
+    k = 0;
+    size = 1;
+    if (res) {
+      group[k++] = res;
+      size = res->ns;
+    }
+    do {
+      size *= sorted[i]->ns;
+      group[k++] = sorted[i++];
+    } while (i < n && (k < 2 || size * sorted[i]->ns <= PRODUCT_LIST_GROUP));
+
+    if (k == 2)
+      b = dfaProductCtx(ctx, group[0], group[1], ff);
+    else
+      b = product_tuples(group, k, ff);
+    if (res)
+      dfaFree(res);
+    if (i < n) {
+      res = dfaMinimizeCtx(ctx, b);
+      dfaFree(b);
+    }
+    else
+      res = b;
+  }
+
+  mem_free(group);
+  mem_free(sorted);
+  dfa_leave(saved);
+  return res;
+}
@@ -20,10 +20,10 @@
 
 #include <stdint.h>
 #include "dfa.h"
+#include "dfa_internal.h"
 #include "../BDD/hash.h"
 #include "../Mem/mem.h"
-
-static bdd_manager *bddm_res;
+#include "../Mem/arena.h"
 
 #define SET_BDD_NOT_CALCULATED (unsigned)-1
 
@@ -37,38 +37,52 @@ struct set {
    int permanent;        /* state in final automata, -1 = none */
 }; 
    
-static int n_ssets;
-static struct set *ssets;
-static int next_sset;
-static hash_tab htbl_set;
+struct sslist_;
+
+/* Kept in the context because used in proj_term1-3.  */
+struct project_state {
+  bdd_manager *bddm_res;
+  int n_ssets;
+  struct set *ssets;
+  int next_sset;
+  pair_map htbl_set;
+  struct sslist_ *lst, *lh, *lt;
+  int next_state;
+  arena mem;     /* holds the element arrays and the list */
+};
 
-void init_ssets(int sz)
+void init_ssets(struct project_state *st, int sz)
 {
-   n_ssets = sz;
-   ssets = mem_alloc((sizeof *ssets) * sz);
-   next_sset = 0;
+   st->n_ssets = sz;
+   st->ssets = mem_alloc((sizeof *st->ssets) * sz);
+   st->next_sset = 0;
 }
 
-int make_sset(int sz, int *elem, unsigned sq, int d1, int d2)
+int make_sset(struct project_state *st, 
+	      int sz, int *elem, unsigned sq, int d1, int d2)
 {
-  if (next_sset == n_ssets) {
-    struct set *new_ssets = mem_alloc((sizeof *ssets) * n_ssets * 2);
+  struct set *ss;
+
+  if (st->next_sset == st->n_ssets) {
+    struct set *new_ssets = mem_alloc((sizeof *st->ssets) * st->n_ssets * 2);
     
-    mem_copy(new_ssets, ssets, (sizeof *new_ssets) * n_ssets);
-    mem_free(ssets);
-    ssets = new_ssets;
-    n_ssets *= 2;
+    mem_copy(new_ssets, st->ssets, (sizeof *new_ssets) * st->n_ssets);
+    mem_free(st->ssets);
+    st->ssets = new_ssets;
+    st->n_ssets *= 2;
   }
-  ssets[next_sset].size = sz;
-  ssets[next_sset].elements = elem;
-  ssets[next_sset].sq = sq;
-  ssets[next_sset].decomp1 = d1;
-  ssets[next_sset].decomp2 = d2;
-  ssets[next_sset].permanent = -1;
-  insert_in_hash_tab(htbl_set, (long)elem, 0, (void *)(uintptr_t)(next_sset+1));  
+  ss = &st->ssets[st->next_sset];
+  ss->size = sz;
+  ss->elements = elem;
+  ss->sq = sq;
+  ss->decomp1 = d1;
+  ss->decomp2 = d2;
+  ss->permanent = -1;
+  insert_in_pair_map(st->htbl_set, (long)elem, 0, 
+		     (void *)(uintptr_t)(st->next_sset+1));  
   /* htbl maps to ++id, since 0 = not_found */ 
 
-  return(next_sset++);
+  return(st->next_sset++);
 }       
 
 
@@ -79,9 +93,9 @@ struct sslist_ {
 
 typedef struct sslist_ *sslist;
 
-sslist new_sslist(int si, sslist nxt)
+sslist new_sslist(arena mem, int si, sslist nxt)
 {  
-  sslist sl = mem_alloc(sizeof *sl);
+  sslist sl = arena_alloc(mem, sizeof *sl);
   
   sl->sset_id = si;
   sl->next = nxt;
@@ -90,24 +104,22 @@ sslist new_sslist(int si, sslist nxt)
 }
 
 
-/* These global because used in proj_term.  */
-static sslist lst, lh, lt;
-
 /* Fn to create pairs */
 unsigned proj_term1(unsigned state1, unsigned  state2)
 {  
+  struct project_state *st = dfaCurrentContext()->project;
   int res;
   int *s;
   int size;
 
   if (state1 == state2) {
     size = 1;
-    s = mem_alloc((sizeof *s) * 2);
+    s = arena_alloc(st->mem, (sizeof *s) * 2);
     s[0] = state1; s[1] = -1;         
   } 
   else {
     size = 2;
-    s = mem_alloc((sizeof *s) * 3);
+    s = arena_alloc(st->mem, (sizeof *s) * 3);
     if(state1<state2) {
       s[0] = state1;
       s[1] = state2; 
@@ -121,12 +133,12 @@ unsigned proj_term1(unsigned state1, unsigned  state2)
   }
    
   /* res = 0 or id+1 */
-  if ( (res = (int)(uintptr_t) lookup_in_hash_tab(htbl_set, (long) s, 0)) ) {
-    mem_free(s); /* it was already there */  
+  if ( (res = (int)(uintptr_t) lookup_in_pair_map(st->htbl_set, (long) s, 0)) ) {
+    arena_unalloc(st->mem, s); /* it was already there */  
     return (--res);
   }
   else {
-    res = make_sset(size, s, SET_BDD_NOT_CALCULATED, state1, state2); /* optimize if equal? */
+    res = make_sset(st, size, s, SET_BDD_NOT_CALCULATED, state1, state2); /* optimize if equal? */
     return (res);
   }
 }
@@ -135,13 +147,14 @@ unsigned proj_term1(unsigned state1, unsigned  state2)
 /* Fn to union leaves */
 bdd_ptr proj_term2(unsigned set_index1,  unsigned set_index2)
 {  
+  struct project_state *st = dfaCurrentContext()->project;
   int res;
   int *s;
   struct set *ss1, *ss2;
   int *e1, *e2, *e3;
-  ss1 = &(ssets[set_index1]);
-  ss2 = &(ssets[set_index2]);
-  s = mem_alloc((ss1->size + ss2->size + 1) * (sizeof *s));
+  ss1 = &(st->ssets[set_index1]);
+  ss2 = &(st->ssets[set_index2]);
+  s = arena_alloc(st->mem, (ss1->size + ss2->size + 1) * (sizeof *s));
   
   /* Union the sets */      
   for (e1 = ss1->elements, e2 = ss2->elements, e3 = s; 
@@ -167,78 +180,135 @@ bdd_ptr proj_term2(unsigned set_index1,  unsigned set_index2)
   *e3 = -1;   /* Terminate the new set */
   
   /* res = 0 or id+1 */
-  if ( (res = (int)(uintptr_t) lookup_in_hash_tab(htbl_set, (long) s, 0)) ) {
-    mem_free(s); /* it was already there */
+  if ( (res = (int)(uintptr_t) lookup_in_pair_map(st->htbl_set, (long) s, 0)) ) {
+    arena_unalloc(st->mem, s); /* it was already there */
     return (--res);
   }
   else {
-    res = make_sset((e3-s), s, SET_BDD_NOT_CALCULATED, set_index1, set_index2);
+    res = make_sset(st, (e3-s), s, SET_BDD_NOT_CALCULATED, set_index1, set_index2);
     return (res);
   }
 }
 
-static int next_state;
+/* Fn to union leaves that are sets already, used when projecting the
+   second and further variables */
+unsigned proj_term_union(unsigned set_index1, unsigned set_index2)
+{
+  if (set_index1 == set_index2)
+    return set_index1;
+  return proj_term2(set_index1, set_index2);
+}
 
 /* Fn to insert leaves and return permanent "q" */
 bdd_ptr proj_term3(unsigned p)
 { 
-  if(ssets[p].permanent < 0) {
-    lt->next = new_sslist(p, 0);   /* Put in queue */
-    lt = lt->next;
-    ssets[p].permanent = next_state++;
+  struct project_state *st = dfaCurrentContext()->project;
+
+  if(st->ssets[p].permanent < 0) {
+    st->lt->next = new_sslist(st->mem, p, 0);   /* Put in queue */
+    st->lt = st->lt->next;
+    st->ssets[p].permanent = st->next_state++;
   }
 
-  return (ssets[p].permanent);
+  return (st->ssets[p].permanent);
 }
 
-unsigned eval_bdd(int ss)
+unsigned eval_bdd(struct project_state *st, int ss)
 {
   unsigned root1, root2;
+  bdd_manager *bddm_res = st->bddm_res;
   
-  if (ssets[ss].sq == SET_BDD_NOT_CALCULATED) {
-    root1 = eval_bdd(ssets[ss].decomp1);
-    root2 = eval_bdd(ssets[ss].decomp2);
+  if (st->ssets[ss].sq == SET_BDD_NOT_CALCULATED) {
+    root1 = eval_bdd(st, st->ssets[ss].decomp1);
+    root2 = eval_bdd(st, st->ssets[ss].decomp2);
     (void) bdd_apply2_hashed(bddm_res, bdd_roots(bddm_res)[root1],
 			     bddm_res, bdd_roots(bddm_res)[root2],
 			     bddm_res, &proj_term2);
-    ssets[ss].sq = bdd_roots_length(bddm_res) - 1;
+    st->ssets[ss].sq = bdd_roots_length(bddm_res) - 1;
   }
 
-  return(ssets[ss].sq);
+  return(st->ssets[ss].sq);
 } 
 
 DFA *dfaProject(DFA *a, unsigned var_index) 
+{
+  return dfaProjectListCtx(dfaCurrentContext(), a, 1, &var_index);
+}
+
+DFA *dfaProjectCtx(dfaContext *ctx, DFA *a, unsigned var_index) 
+{
+  return dfaProjectListCtx(ctx, a, 1, &var_index);
+}
+
+DFA *dfaProjectList(DFA *a, unsigned n, unsigned indices[]) 
+{
+  return dfaProjectListCtx(dfaCurrentContext(), a, n, indices);
+}
+
+DFA *dfaProjectListCtx(dfaContext *ctx, DFA *a, unsigned n, 
+		       unsigned indices[]) 
 {
   int i,*e; 
+  unsigned k;
   DFA *res;
-  sslist lnxt;  
   unsigned size_estimate = 2 * bdd_size(a->bddm);
+  bdd_manager *bddm_res;
+  struct project_state st, *outer = ctx->project;
+  dfaSavedContext saved = dfa_enter(ctx);
   
-  bddm_res = bdd_new_manager(size_estimate, size_estimate/8 + 2);
+  ctx->project = &st;
+  st.bddm_res = bddm_res = bdd_new_manager(size_estimate, size_estimate/8 + 2);
   bdd_make_cache(bddm_res, size_estimate, size_estimate/8 + 2);    
   bddm_res->cache_erase_on_doubling = TRUE;
   
-  init_ssets(a->ns * 2);
-  htbl_set = new_hash_tab(hashlong, eqlong);
-  next_state = 0; 
+  st.mem = new_arena(0);
+  init_ssets(&st, a->ns * 2);
+  st.htbl_set = new_pair_map(hashlong, eqlong, a->ns * 2);
+  st.next_state = 0; 
   
   for(i = 0; i < a->ns; i++) {  /* Allocate singletons, ssets[i] = {i} */
-    int *s = mem_alloc(2 * (sizeof *s));
+    int *s = arena_alloc(st.mem, 2 * (sizeof *s));
     
     s[0] = i; s[1] = -1;
-    make_sset(1, s, SET_BDD_NOT_CALCULATED, -1, -1);
+    make_sset(&st, 1, s, SET_BDD_NOT_CALCULATED, -1, -1);
   }
 
-  for (i = 0; i < a->ns; i++) {  /* Update bdd's */  
-    (void) bdd_project(a->bddm, a->q[i], var_index, bddm_res, &proj_term1);
-    ssets[i].sq = bdd_roots_length(bddm_res) - 1; /* bdd_roots_length(bddm_res) - 1 == i */
-    /* bdd_roots(bddm_res)[ssets[i].sq] now contains 
-       place where a node index is to be found*/
-  } 
+  /* Update bdd's, one variable at a time; the leaves are sets after
+     the first one, and each intermediate result has a manager of its
+     own, only the last one is made in bddm_res */
+  invariant(n > 0);
+  {
+    bdd_manager *from = a->bddm, *to;
+
+    for (k = 0; k < n; k++) {
+      if (k == n - 1)
+	to = bddm_res;
+      else {
+	to = bdd_new_manager(size_estimate, size_estimate/8 + 2);
+	bdd_make_cache(to, size_estimate, size_estimate/8 + 2);
+	to->cache_erase_on_doubling = TRUE;
+      }
+      for (i = 0; i < a->ns; i++) 
+	if (k == 0)
+	  (void) bdd_project(a->bddm, a->q[i], indices[k], to, &proj_term1);
+	else
+	  (void) bdd_project(from, bdd_roots(from)[i], indices[k], to, 
+			     &proj_term_union);
+      if (from != a->bddm) {
+	bdd_update_statistics(from, (unsigned)PROJECT);
+	bdd_kill_manager(from);
+      }
+      from = to;
+    }
+  }
+  for (i = 0; i < a->ns; i++) 
+    st.ssets[i].sq = i; 
+  /* bdd_roots(bddm_res)[ssets[i].sq] now contains 
+     place where a node index is to be found*/
   
   /* Create a list of reachable sets. */
-  lst = lh = lt = new_sslist(a->s, 0);   /* start singleton */
-  ssets[a->s].permanent = next_state++;  /* Should be 0 */
+  st.lst = st.lh = st.lt = new_sslist(st.mem, a->s, 0);   /* start singleton */
+  st.ssets[a->s].permanent = st.next_state++;  /* Should be 0 */
   {
     unsigned root_place;
     bdd_manager *bddm_res_ = bdd_new_manager(size_estimate,
@@ -249,26 +319,26 @@ DFA *dfaProject(DFA *a, unsigned var_index)
     bddm_res->cache_erase_on_doubling = TRUE;
     
     bdd_prepare_apply1(bddm_res);
-    while (lh) {
-      root_place = eval_bdd(lh->sset_id);
+    while (st.lh) {
+      root_place = eval_bdd(&st, st.lh->sset_id);
       /* Insert leaves */    
       (void) bdd_apply1(bddm_res, bdd_roots(bddm_res)[root_place], bddm_res_, &proj_term3);
       /*evaluate bdd_roots(bddm_res) at each iteration since bdd_apply1 is called*/
-      lh = lh -> next;
+      st.lh = st.lh -> next;
     }
    
     {
       unsigned *new_roots;
       
-      res = dfaMakeNoBddm(next_state);
+      res = dfaMakeNoBddm(st.next_state);
       res->bddm = bddm_res_;
       new_roots = bdd_roots(bddm_res_);
       
-      for (i = 0; i < next_state; i++) {   /* Walk through list */
+      for (i = 0; i < st.next_state; i++) {   /* Walk through list */
 	int non_bottom_found = 0;
 	int plus_one_found = 0;
 	res->q[i] = new_roots[i];
-	for (e = ssets[lst->sset_id].elements; *e >= 0; e++) {
+	for (e = st.ssets[st.lst->sset_id].elements; *e >= 0; e++) {
 	    non_bottom_found += (a->f[*e] != 0);
 	    plus_one_found += (a->f[*e] == 1);
 	}
@@ -279,22 +349,45 @@ DFA *dfaProject(DFA *a, unsigned var_index)
 	    res->f[i] = 1;
 	  else
 	    res->f[i] = -1;
-	res->s = ssets[a->s].permanent;  /* Move to out of loop */
+	res->s = st.ssets[a->s].permanent;  /* Move to out of loop */
 	
-	lnxt = lst -> next;
-	mem_free(lst);          /* Free the list */
-	lst = lnxt;
+	st.lst = st.lst -> next;
       }
     
-      for(i = 0; i < next_sset; i++) 
-	mem_free(ssets[i].elements);
-      
-      mem_free(ssets);
-      free_hash_tab(htbl_set);  
+      free_arena(st.mem);          /* Free the sets and the list */
+      mem_free(st.ssets);
+      free_pair_map(st.htbl_set);  
       bdd_update_statistics(bddm_res, (unsigned)PROJECT);
       bdd_update_statistics(bddm_res_, (unsigned)PROJECT);
       bdd_kill_manager(bddm_res);
+      ctx->project = outer;
+      dfa_leave(saved);
       return(res);
     }
   }
 }
+
+DFA *dfaProductProject(DFA *a1, DFA *a2, dfaProductType mode, 
+		       unsigned n, unsigned indices[], int product_size[2])
+{
+  return dfaProductProjectCtx(dfaCurrentContext(), a1, a2, mode, 
+			      n, indices, product_size);
+}
+
+DFA *dfaProductProjectCtx(dfaContext *ctx, DFA *a1, DFA *a2, 
+			  dfaProductType mode, unsigned n, unsigned indices[],
+			  int product_size[2])
+{
+  DFA *p = dfaProductCtx(ctx, a1, a2, mode), *res;
+
+  /* the product is private, its statuses are changed in place and its
+     transitions are read once by the subset construction */
+  if (product_size) {
+    product_size[0] = p->ns;
+    product_size[1] = bdd_size(p->bddm);
+  }
+  dfaRightQuotientList(p, n, indices);
+  res = dfaProjectListCtx(ctx, p, n, indices);
+  dfaFree(p);
+  return res;
+}
@@ -0,0 +1,563 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#include <iostream>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "autcache.h"
+#include "code.h"
+#include "signature.h"
+#include "symboltable.h"
+#include "env.h"
+
+extern "C" {
+#include "../Mem/mem.h"
+}
+
+using std::cout;
+
+extern Options options;
+extern SymbolTable symbolTable;
+
+AutCache autCache;
+
+// subtrees of at least this depth are worth a file in the cache
+#define CACHE_MIN_DEPTH 3
+
+// changed whenever the digests or the files change meaning
+#define CACHE_VERSION "MONA automaton cache 2"
+
+////////// Digest /////////////////////////////////////////////////////////////
+
+static unsigned long long
+fmix64(unsigned long long h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+void
+Digest::add(unsigned long long x)
+{
+  // two lanes with different multipliers, so a collision must happen
+  // in both at once
+  h1 = (h1 ^ x) * 0x9e3779b97f4a7c15ULL;
+  h1 ^= h1 >> 29;
+  h2 = (h2 + x) * 0xc2b2ae3d27d4eb4fULL;
+  h2 ^= h2 >> 31;
+}
+
+void
+Digest::add(const char *s)
+{
+  size_t n = strlen(s);
+  add((unsigned long long) n);
+  while (n > 0) {
+    unsigned long long x = 0;
+    size_t k = n < 8 ? n : 8;
+    memcpy(&x, s, k);
+    add(x);
+    s += k;
+    n -= k;
+  }
+}
+
+void
+Digest::add(Signature &sign)
+{
+  add((unsigned long long) sign.size);
+  for (unsigned i = 0; i < sign.size; i++)
+    add((unsigned long long) sign.sign[i]);
+}
+
+void
+Digest::addNames(IdentList *ids)
+{ // identifiers are numbered differently in other runs, names are not
+  if (!ids) {
+    add(0ULL);
+    return;
+  }
+  add((unsigned long long) ids->size() + 1);
+  for (Ident *id = ids->begin(); id != ids->end(); id++)
+    add(symbolTable.lookupSymbol(*id));
+}
+
+void
+Digest::print(char *to) const
+{
+  snprintf(to, 33, "%016llx%016llx", fmix64(h1), fmix64(h2 ^ h1));
+}
+
+////////// Code keys //////////////////////////////////////////////////////////
+
+Digest *
+Code::key()
+{
+  if (keyed < 0) {
+    digest = Digest();
+    keyed = makeKey(digest);
+  }
+  return keyed ? &digest : NULL;
+}
+
+bool
+Code::makeKey(Digest &d)
+{
+  d.add((unsigned long long) kind);
+  return true;
+}
+
+bool
+Code_n::makeKey(Digest &d)
+{
+  d.add((unsigned long long) kind);
+  d.addNames(symbolTable.lookupUnivs(id));
+  return true;
+}
+
+bool
+Code_ni::makeKey(Digest &d)
+{
+  Code_n::makeKey(d);
+  d.add((unsigned long long) val);
+  return true;
+}
+
+bool
+Code_nn::makeKey(Digest &d)
+{
+  d.add((unsigned long long) kind);
+  d.add(sign);
+  d.addNames(symbolTable.lookupUnivs(id1));
+  d.addNames(symbolTable.lookupUnivs(id2));
+  return true;
+}
+
+bool
+Code_nni::makeKey(Digest &d)
+{
+  Code_nn::makeKey(d);
+  d.add((unsigned long long) val);
+  return true;
+}
+
+bool
+Code_nnn::makeKey(Digest &d)
+{
+  d.add((unsigned long long) kind);
+  d.add(sign);
+  d.addNames(symbolTable.lookupUnivs(id1));
+  d.addNames(symbolTable.lookupUnivs(id2));
+  d.addNames(symbolTable.lookupUnivs(id3));
+  return true;
+}
+
+bool
+Code_EqRoot::makeKey(Digest &d)
+{
+  Code_n::makeKey(d);
+  d.addNames(universes);
+  return true;
+}
+
+bool
+Code_InStateSpace::makeKey(Digest &d)
+{
+  Code_n::makeKey(d);
+  d.addNames(ss);
+  return true;
+}
+
+bool
+Code_c::makeKey(Digest &d)
+{
+  Digest *k;
+  if (!vc.code || !(k = vc.code->key()))
+    return false;
+  d.add((unsigned long long) kind);
+  d.add(*k);
+  d.add(sign);
+  return true;
+}
+
+bool
+Code_cc::makeKey(Digest &d)
+{
+  Digest *k1, *k2;
+  if (!vc1.code || !(k1 = vc1.code->key()) ||
+      !vc2.code || !(k2 = vc2.code->key()))
+    return false;
+  d.add((unsigned long long) kind);
+  if ((kind == cAnd || kind == cOr || kind == cBiimpl) && *k2 < *k1) {
+    // the constructor orders the operands by address, which varies
+    // from run to run, so order them by digest instead
+    IdentList v;
+    v.append(vc2.vars);
+    v.append(vc1.vars);
+    Signature s(v);
+    d.add(*k2);
+    d.add(*k1);
+    d.add(s);
+  }
+  else {
+    d.add(*k1);
+    d.add(*k2);
+    d.add(sign);
+  }
+  return true;
+}
+
+bool
+Code_Project::makeKey(Digest &d)
+{
+  if (!Code_c::makeKey(d))
+    return false;
+  d.add((unsigned long long) varpos);
+  d.addNames(symbolTable.lookupUnivs(var));
+  return true;
+}
+
+bool
+Code_PredCall::makeKey(Digest &d)
+{ // the body may have changed since another run, so it is part of the
+  // key together with the way its variables are passed
+  if (!Code_c::makeKey(d))
+    return false;
+  IdentList v;
+  v.append(vc.vars);
+  v.append(&vars);
+  Signature s(v);
+  d.add(symbolTable.lookupSymbol(name));
+  d.add(s);
+  for (Ident *id = vars.begin(); id != vars.end(); id++)
+    d.addNames(symbolTable.lookupUnivs(*id));
+  return true;
+}
+
+////////// AutCache ///////////////////////////////////////////////////////////
+
+void
+AutCache::open()
+{
+  char *s = getenv("MONACACHE");
+  if (!s)
+    s = (char *) "mona.cache";
+  dir = new char[strlen(s)+1];
+  strcpy(dir, s);
+
+  struct stat buf;
+  if (stat(dir, &buf))
+    if (mkdir(dir, S_IWUSR | S_IRUSR | S_IXUSR)) {
+      cout << "Unable to create directory '" << dir << "'\n"
+	   << "Execution aborted\n";
+      exit(-1);
+    }
+  makeContext();
+}
+
+void
+AutCache::openMemory()
+{
+  memory = true;
+  makeContext();
+}
+
+void
+AutCache::closeMemory()
+{
+  clearMemory();
+  memory = false;
+}
+
+void
+AutCache::clearMemory()
+{
+  std::lock_guard<std::mutex> l(lock);
+  for (auto &i : dfas)
+    dfaFree(i.second);
+  for (auto &i : gtas)
+    gtaFree(i.second);
+  dfas.clear();
+  gtas.clear();
+}
+
+void
+AutCache::makeContext()
+{
+  if (hasContext)
+    return;
+  hasContext = true;
+
+  // automata also depend on the mode and, in tree mode, on the guide
+  context.add(CACHE_VERSION);
+  context.add((unsigned long long) options.mode);
+  if (options.mode == TREE) {
+    unsigned i, j;
+    context.add((unsigned long long) guide.numSs);
+    for (i = 0; i < guide.numSs; i++) {
+      context.add((unsigned long long) guide.muLeft[i]);
+      context.add((unsigned long long) guide.muRight[i]);
+      context.add(guide.ssName[i]);
+      context.add((unsigned long long) guide.ssUniv[i]);
+      context.add((unsigned long long) guide.ssUnivRoot[i]);
+      if (guide.ssType)
+	context.add((unsigned long long) guide.ssType[i]);
+      if (guide.ssKind)
+	context.add((unsigned long long) guide.ssKind[i]);
+    }
+    context.add((unsigned long long) guide.numUnivs);
+    for (i = 0; i < guide.numUnivs; i++) {
+      context.add(guide.univName[i]);
+      context.add(guide.univPos[i]);
+      context.add((unsigned long long) guide.numUnivSS[i]);
+      for (j = 0; j < guide.numUnivSS[i]; j++)
+	context.add((unsigned long long) guide.univSS[i][j]);
+    }
+  }
+}
+
+bool
+AutCache::wanted(Code *c)
+{ // the key is always taken, it is needed by the parents
+  return c->key() && c->depth >= CACHE_MIN_DEPTH;
+}
+
+Digest
+AutCache::fullKey(Code *c)
+{
+  Digest d = context;
+  d.add(*c->key());
+  return d;
+}
+
+char *
+AutCache::fileName(Code *c, const char *suffix)
+{
+  char hex[33];
+  fullKey(c).print(hex);
+  const size_t bufsize = strlen(dir) + 1 + 32 + strlen(suffix) + 1;
+  char *t = new char[bufsize];
+  snprintf(t, bufsize, "%s/%s%s", dir, hex, suffix);
+  return t;
+}
+
+char *
+AutCache::tempName(const char *name)
+{
+  static std::atomic<unsigned> next(0);
+  const size_t bufsize = strlen(name) + 40;
+  char *t = new char[bufsize];
+  snprintf(t, bufsize, "%s.%ld.%u", name, (long) getpid(), next++);
+  return t;
+}
+
+// the automata are stored over the indices 0..n-1 of the variables of
+// the node, which are sorted by offset, so renaming is monotonic
+static void
+shadow(Code *c, IdentList &s)
+{
+  for (Ident i = 0; (unsigned) i < c->vars.size(); i++)
+    s.push_back(i);
+}
+
+static void
+namesAndOrders(Code *c, char **&names, char *&orders)
+{
+  names = new char*[c->vars.size()];
+  orders = new char[c->vars.size()];
+  for (unsigned i = 0; i < c->vars.size(); i++) {
+    names[i] = symbolTable.lookupSymbol(c->vars.get(i));
+    orders[i] = (char) symbolTable.lookupOrder(c->vars.get(i));
+  }
+}
+
+DFA *
+AutCache::lookupDFA(Code *c)
+{
+  if (!wanted(c))
+    return NULL;
+  DFA *a = NULL;
+  char *file = NULL;
+  if (memory) {
+    std::lock_guard<std::mutex> l(lock);
+    auto i = dfas.find(fullKey(c));
+    if (i != dfas.end())
+      a = dfaCopy(i->second);
+  }
+  if (!a && dir) {
+    file = fileName(c, ".dfb");
+    a = dfaImportBinary(file, NULL, NULL);
+    if (a)
+      keepDFA(c, a);
+  }
+  if (a) {
+    IdentList s;
+    shadow(c, s);
+    a = st_dfa_replace_indices(a, &c->vars, &s, true, false);
+    hits++;
+    if (options.statistics && file)
+      cout << "-- Found '" << file << "' in cache --\n";
+  }
+  else
+    misses++;
+  delete[] file;
+  return a;
+}
+
+GTA *
+AutCache::lookupGTA(Code *c)
+{
+  if (!wanted(c))
+    return NULL;
+  GTA *g = NULL;
+  char *file = NULL;
+  if (memory) {
+    std::lock_guard<std::mutex> l(lock);
+    auto i = gtas.find(fullKey(c));
+    if (i != gtas.end())
+      g = gtaCopy(i->second);
+  }
+  if (!g && dir) {
+    file = fileName(c, ".gta");
+    g = gtaImport(file, NULL, NULL, NULL, false);
+    if (g)
+      keepGTA(c, g);
+  }
+  if (g) {
+    IdentList s;
+    shadow(c, s);
+    g = st_gta_replace_indices(g, &c->vars, &s, true, false);
+    hits++;
+    if (options.statistics && file)
+      cout << "-- Found '" << file << "' in cache --\n";
+  }
+  else
+    misses++;
+  delete[] file;
+  return g;
+}
+
+// keep a copy of an automaton over 0..n-1 in memory
+void
+AutCache::keepDFA(Code *c, DFA *a)
+{
+  if (!memory)
+    return;
+  std::lock_guard<std::mutex> l(lock);
+  DFA *&d = dfas[fullKey(c)];
+  if (!d)
+    d = dfaCopy(a);
+}
+
+void
+AutCache::keepGTA(Code *c, GTA *g)
+{
+  if (!memory)
+    return;
+  std::lock_guard<std::mutex> l(lock);
+  GTA *&d = gtas[fullKey(c)];
+  if (!d)
+    d = gtaCopy(g);
+}
+
+void
+AutCache::storeDFA(Code *c)
+{
+  if (!enabled() || !wanted(c))
+    return;
+  IdentList s;
+  shadow(c, s);
+  c->dfa = st_dfa_replace_indices(c->dfa, &s, &c->vars, false, true);
+  keepDFA(c, c->dfa);
+  if (!dir) {
+    stores++;
+    c->dfa = st_dfa_replace_indices(c->dfa, &c->vars, &s, true, false);
+    return;
+  }
+
+  char *file = fileName(c, ".dfb"), *temp = tempName(file);
+  char **names, *orders;
+  namesAndOrders(c, names, orders);
+  if (dfaExportBinary(c->dfa, temp, c->vars.size(), names, orders) &&
+      rename(temp, file) == 0)
+    stores++;
+  else // the cache is only an optimization
+    unlink(temp);
+  c->dfa = st_dfa_replace_indices(c->dfa, &c->vars, &s, true, false);
+
+  delete[] names;
+  delete[] orders;
+  delete[] temp;
+  delete[] file;
+}
+
+void
+AutCache::storeGTA(Code *c)
+{
+  if (!enabled() || !wanted(c))
+    return;
+  IdentList s;
+  shadow(c, s);
+  c->gta = st_gta_replace_indices(c->gta, &s, &c->vars, false, true);
+  keepGTA(c, c->gta);
+  if (!dir) {
+    stores++;
+    c->gta = st_gta_replace_indices(c->gta, &c->vars, &s, true, false);
+    return;
+  }
+
+  char *file = fileName(c, ".gta"), *temp = tempName(file);
+  char **names, *orders;
+  namesAndOrders(c, names, orders);
+  SSSet *statespaces = new SSSet[c->vars.size()];
+  for (unsigned i = 0; i < c->vars.size(); i++)
+    statespaces[i] = stateSpaces(c->vars.get(i));
+
+  if (gtaExport(c->gta, temp, c->vars.size(), names, orders,
+		statespaces, false) &&
+      rename(temp, file) == 0)
+    stores++;
+  else
+    unlink(temp);
+  c->gta = st_gta_replace_indices(c->gta, &c->vars, &s, true, false);
+
+  for (unsigned i = 0; i < c->vars.size(); i++)
+    mem_free(statespaces[i]);
+  delete[] statespaces;
+  delete[] names;
+  delete[] orders;
+  delete[] temp;
+  delete[] file;
+}
+
+void
+AutCache::print_statistics()
+{
+  if (enabled())
+    cout << "\nAutomaton cache: " << hits << " hits, "
+	 << misses << " misses, " << stores << " stored\n";
+}
@@ -0,0 +1,102 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#ifndef __AUTCACHE_H
+#define __AUTCACHE_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+
+extern "C" {
+#include "../DFA/dfa.h"
+#include "../GTA/gta.h"
+}
+
+class Code;
+class IdentList;
+class Signature;
+
+// 128-bit structural hash of a code subtree, independent of pointers,
+// identifier numbers and offsets, so it is the same in every run
+class Digest {
+public:
+  Digest() :
+    h1(0x6a09e667f3bcc908ULL), h2(0xbb67ae8584caa73bULL) {}
+
+  void add(unsigned long long x);
+  void add(const char *s);
+  void add(const Digest &d) {add(d.h1); add(d.h2);}
+  void add(Signature &sign);
+  void addNames(IdentList *ids);
+  bool operator<(const Digest &d) const
+  {return h1 < d.h1 || (h1 == d.h1 && h2 < d.h2);}
+  void print(char *to) const; // 32 hex digits + '\0'
+
+  unsigned long long h1, h2;
+};
+
+// cache of the minimized automata of code nodes, keyed by the digest
+// of the node; on disk it has one file per node (in $MONACACHE, default
+// ./mona.cache), written to a temporary name and renamed, so concurrent
+// runs and threads may share the directory; in memory it keeps the
+// automata alive between the formulas of a library session
+class AutCache {
+public:
+  AutCache() :
+    dir(NULL), memory(false), hasContext(false),
+    hits(0), misses(0), stores(0) {}
+  ~AutCache() {delete[] dir; clearMemory();}
+
+  void open(); // create the directory, call after the guide is made
+  void openMemory(); // keep automata in memory as well
+  void closeMemory();
+  void clearMemory(); // free the automata kept in memory
+  bool enabled() {return dir != NULL || memory;}
+
+  DFA *lookupDFA(Code *c); // NULL if not found
+  GTA *lookupGTA(Code *c);
+  void storeDFA(Code *c);  // store c->dfa
+  void storeGTA(Code *c);  // store c->gta
+
+  void print_statistics();
+
+private:
+  bool wanted(Code *c);
+  char *fileName(Code *c, const char *suffix);
+  char *tempName(const char *name);
+  Digest fullKey(Code *c);
+  void keepDFA(Code *c, DFA *a); // a is over 0..n-1
+  void keepGTA(Code *c, GTA *g);
+  void makeContext();
+
+  char  *dir;     // cache directory, NULL if disabled
+  bool   memory;  // automata are also kept in memory
+  bool   hasContext;
+  Digest context; // mode and guide, mixed into all keys
+  std::map<Digest, DFA*> dfas; // automata in memory over 0..n-1
+  std::map<Digest, GTA*> gtas;
+  std::mutex lock; // guards the maps
+  std::atomic<unsigned> hits, misses, stores;
+};
+
+extern AutCache autCache;
+
+#endif
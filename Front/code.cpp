@@ -19,8 +19,10 @@
  */
 
 #include <iostream>
+#include <map>
 #include <string.h>
 #include "codetable.h"
+#include "scheduler.h"
 #include "offsets.h"
 #include "predlib.h"
 #include "symboltable.h"
@@ -102,21 +104,74 @@ VarCode::DFATranslate()
     invariant(!code->mark);
     if (options.intermediate)
       code->show();
-    code->makeDFA();
+    if (!autCache.enabled() || !(code->dfa = autCache.lookupDFA(code))) {
+      code->makeDFA();
+      autCache.storeDFA(code);
+    }
     code->mark = true;
     invariant(code->dfa);
     codeTable->print_progress();
   }
 
+  // other references share the automaton, it is copied when changed
   DFA *a = code->dfa;
   if (code->refs > 1)
-    a = st_dfa_copy(a);
+    a = dfaRef(a);
   else
     code->dfa = NULL;
-  st_dfa_replace_indices(a, vars, &code->vars); 
+  a = st_dfa_replace_indices(a, vars, &code->vars); 
   return a;
 }
 
+dfaLazy*
+VarCode::DFATranslateLazy()
+{
+  // nodes that are shared, already translated or renamed are made as
+  // usual
+  if (code->dfa || code->refs > 1 || !equal(vars, &code->vars))
+    return dfaLazyAutomaton(DFATranslate());
+
+  dfaLazy *z;
+  switch (code->kind) {
+  case cAnd:
+  case cOr:
+  case cImpl:
+  case cBiimpl:
+    {
+      Code_cc *c = (Code_cc *) code;
+      dfaLazy *l = c->vc1.DFATranslateLazy();
+      c->vc1.remove();
+      dfaLazy *r = c->vc2.DFATranslateLazy();
+      c->vc2.remove();
+      z = dfaLazyProduct(l, r, 
+			 code->kind == cAnd ? dfaAND :
+			 code->kind == cOr ? dfaOR :
+			 code->kind == cImpl ? dfaIMPL : dfaBIIMPL);
+      break;
+    }
+  case cProject:
+    { // the right-quotient needs all of the operand
+      Code_Project *c = (Code_Project *) code;
+      DFA *a = st_dfa_writable(c->vc.DFATranslate());
+      c->vc.remove();
+      dfaRightQuotient(a, offsets.off(c->var));
+      z = dfaLazyProject(dfaLazyAutomaton(a), offsets.off(c->var));
+      break;
+    }
+  case cNegate:
+    z = dfaLazyNegation(((Code_c *) code)->vc.DFATranslateLazy());
+    ((Code_c *) code)->vc.remove();
+    break;
+  case cRestrict:
+    z = dfaLazyRestrict(((Code_c *) code)->vc.DFATranslateLazy());
+    ((Code_c *) code)->vc.remove();
+    break;
+  default:
+    return dfaLazyAutomaton(DFATranslate());
+  }
+  return z;
+}
+
 GTA* 
 VarCode::GTATranslate()
 {
@@ -124,7 +179,10 @@ VarCode::GTATranslate()
     invariant(!code->mark);
     if (options.intermediate)
       code->show();
-    code->makeGTA();
+    if (!autCache.enabled() || !(code->gta = autCache.lookupGTA(code))) {
+      code->makeGTA();
+      autCache.storeGTA(code);
+    }
     code->mark = true;
     invariant(code->gta);
     codeTable->print_progress();
@@ -132,10 +190,10 @@ VarCode::GTATranslate()
 
   GTA *g = code->gta;
   if (code->refs > 1)
-    g = st_gta_copy(g);
+    g = gtaRef(g);
   else
     code->gta = NULL;
-  st_gta_replace_indices(g, vars, &code->vars); 
+  g = st_gta_replace_indices(g, vars, &code->vars); 
   return g;
 }
 
@@ -218,8 +276,6 @@ Code::remove() // remove one reference to this node
 {
   invariant(refs > 0);
   if (--refs == 0) {
-    if (!mark) // node skipped due to sep. comp.
-      codeTable->makes++;
     if (dfa)
       dfaFree(dfa);
     if (gta)
@@ -228,7 +284,12 @@ Code::remove() // remove one reference to this node
       delete conj;
     if (restrconj)
       delete restrconj;
-    codeTable->remove(this);
+    {
+      std::lock_guard<std::mutex> l(codeTable->lock);
+      if (!mark) // node skipped due to sep. comp.
+	codeTable->makes++;
+      codeTable->remove(this);
+    }
     forwarded.remove();
     delete this;
   }
@@ -404,6 +465,20 @@ Code_c::hash()
   return kind + ((long) vc.code)*128;
 }
 
+bool
+Code_c::findExclusive()
+{ // the child is gone if this node has been translated already
+  return !vc.code || (vc.code->refs == 1 && vc.code->exclusive());
+}
+
+int
+Code_c::findNeed()
+{ // the child, then the result while the child is still there
+  if (!vc.code) // translated already
+    return 1;
+  return vc.code->need() > 2 ? vc.code->need() : 2;
+}
+
 ////////// Code_cc ////////////////////////////////////////////////////////////
 
 Code_cc::Code_cc(CodeKind knd, VarCode c1, VarCode c2, Pos p):
@@ -442,11 +517,114 @@ Code_cc::hash()
   return kind*2 + ((long) vc1.code)*5 + ((long) vc2.code)*7;
 }
 
+bool
+Code_cc::findExclusive()
+{
+  return !vc1.code ||
+    (vc1.code->refs == 1 && vc1.code->exclusive() &&
+     vc2.code->refs == 1 && vc2.code->exclusive());
+}
+
+// the number of automata needed to make the n operands one after the
+// other and then their product, if the operands that need more are
+// made first, while fewer results are kept; order is set to that order
+static int
+orderByNeed(unsigned n, int *need, unsigned *order)
+{
+  unsigned i, j;
+  for (i = 0; i < n; i++) {
+    for (j = i; j > 0 && need[order[j-1]] < need[i]; j--)
+      order[j] = order[j-1];
+    order[j] = i;
+  }
+  int m = n + 1;
+  for (i = 0; i < n; i++)
+    if (need[order[i]] + (int) i > m)
+      m = need[order[i]] + i;
+  return m;
+}
+
+int
+Code_cc::findNeed()
+{ // the children, then the product while both are still there
+  if (!vc1.code) // translated already
+    return 1;
+  int need[2] = {vc1.code->need(), vc2.code->need()};
+  unsigned order[2];
+  return orderByNeed(2, need, order);
+}
+
+// operands already made need no more automata than the one kept
+static int
+needOf(VarCode &vc, bool made)
+{
+  return made ? 0 : vc.code->need();
+}
+
+// true if vc1 is to be translated before vc2; the one needing more
+// automata goes first (Sethi-Ullman), so its peak is reached while
+// only those around it are kept, otherwise the shared or deeper one
+// is left for last
+static bool
+leftFirst(VarCode &vc1, int need1, VarCode &vc2, int need2)
+{
+  if (need1 != need2)
+    return need1 > need2;
+  /* #warning NEW: heuristic choice through DAG - 1-15% lower max-aut. */
+  return vc1.code->refs==1 || 
+    (vc2.code->refs>1 && vc1.code->depth<=vc2.code->depth);
+}
+
+// subtrees of at least this depth are worth handing to another worker
+#define SPAWN_MIN_DEPTH 3
+
+class TranslateTask: public Task {
+public:
+  TranslateTask(VarCode &c) :
+    vc(c), dfa(NULL) {}
+
+  void run() {dfa = vc.DFATranslate(); vc.remove();}
+
+  VarCode &vc;
+  DFA *dfa;
+};
+
+static bool
+spawnable(VarCode &vc)
+{
+  return vc.code->refs == 1 && vc.code->depth >= SPAWN_MIN_DEPTH &&
+    vc.code->exclusive();
+}
+
 void 
 Code_cc::makeDFA()
 {
-  /* #warning NEW: heuristic choice through DAG - 1-15% lower max-aut. */
-  if (vc1.code->refs==1 || (vc2.code->refs>1 && vc1.code->depth<=vc2.code->depth)) {
+  bool left = leftFirst(vc1, needOf(vc1, vc1.code->dfa), 
+			vc2, needOf(vc2, vc2.code->dfa));
+
+  if (scheduler.active() && (spawnable(vc1) || spawnable(vc2))) {
+    // let another worker translate an exclusive subtree, preferably the
+    // one that would have been translated last, while this one
+    // translates the other child
+    bool spawn1 = left ? !spawnable(vc2) : spawnable(vc1);
+    TranslateTask task(spawn1 ? vc1 : vc2);
+
+    scheduler.spawn(&task);
+    if (spawn1) {
+      a2 = vc2.DFATranslate();
+      vc2.remove();
+    }
+    else {
+      a1 = vc1.DFATranslate();
+      vc1.remove();
+    }
+    scheduler.wait(&task);
+    if (spawn1)
+      a1 = task.dfa;
+    else
+      a2 = task.dfa;
+  }
+  else if (left) {
     a1 = vc1.DFATranslate();
     vc1.remove();
     a2 = vc2.DFATranslate();
@@ -463,7 +641,8 @@ Code_cc::makeDFA()
 void 
 Code_cc::makeGTA()
 {
-  if (vc1.code->refs==1 || (vc2.code->refs>1 && vc1.code->depth<=vc2.code->depth)) {
+  if (leftFirst(vc1, needOf(vc1, vc1.code->gta), 
+		vc2, needOf(vc2, vc2.code->gta))) {
     g1 = vc1.GTATranslate();
     vc1.remove();
     g2 = vc2.GTATranslate();
@@ -477,77 +656,6 @@ Code_cc::makeGTA()
   }
 }
 
-/**
-////////// Code_clist /////////////////////////////////////////////////////////
-
-Code_clist::Code_clist(CodeKind knd, Deque<VarCode> c, Pos p):
-  Code(knd, p), vcl(c) 
-{
-  Deque<VarCode>::iterator i;
-  int d = 0;
-  / * REQUIRE SIZE>0 * /
-  
-  if (kind==cAnd || kind==cOr || kind==cBiimpl) // exploit symmetry
-    / * SORT!   if (vc1.code < vc2.code) {
-      VarCode t = vc1;
-      vc1 = vc2;
-      vc2 = t;
-      }* /;
-
-  for (i = vcl.begin(); i != vcl.end(); i++) {
-    vars.append(i->vars);
-    if (i->code->depth > d)
-      d = i->code->depth+1;
-  }
-
-  sign.make(vars);
-  vars.compress();
-}
-
-bool
-Code_clist::equiv(Code &c)
-{
-  Deque<VarCode>::iterator i, j;
-  
-  if (kind != c.kind ||
-      !(sign == ((Code_clist&) c).sign) ||
-      vcl.size() != ((Code_clist&) c).vcl.size()) 
-    return 0;
-  
-  for (i = vcl.begin(), j = ((Code_clist&) c).vcl.begin(); i != vcl.end(); i++, j++)
-    if (!(i->code == j->code))
-      return 0;
-  
-  return 1;
-}
-
-unsigned 
-Code_clist::hash() 
-{
-  return kind*2 + vcl.size()*7;
-}
-
-void 
-Code_clist::makeDFA()
-{
-  Deque<VarCode>::iterator i;
-  for (i = vcl.begin(); i != vcl.end(); i++) {
-    al.push_back(i->DFATranslate());
-    i->remove();
-  }
-}
-
-void 
-Code_clist::makeGTA()
-{
-  Deque<VarCode>::iterator i;
-  for (i = vcl.begin(); i != vcl.end(); i++) {
-    gl.push_back(i->GTATranslate());
-    i->remove();
-  }
-}
-**/
-
 ////////// Atomic formulas ////////////////////////////////////////////////////
 
 void
@@ -921,22 +1029,64 @@ Code_Project::equiv(Code &c)
     sameUnivs(var, ((Code_Project&) c).var);
 }
 
+// the projections below c that are only used there, not made yet and
+// not renamed are done together with c, in one subset construction and
+// with one minimization; the nodes of the chain are not kept in the
+// automaton cache, so it is only followed when that is disabled
+static VarCode *
+projectionChain(Code_Project *c, IdentList &ids, Deque<VarCode *> &links)
+{
+  VarCode *vc = &c->vc;
+
+  ids.push_back(c->var);
+  links.push_back(vc);
+  while (!autCache.enabled() && vc->code->kind == cProject &&
+	 vc->code->refs == 1 && !vc->code->dfa && !vc->code->gta &&
+	 equal(vc->vars, &vc->code->vars)) {
+    c = (Code_Project *) vc->code;
+    vc = &c->vc;
+    ids.push_back(c->var);
+    links.push_back(vc);
+  }
+  return vc;
+}
+
+static bool fusedProduct(VarCode &vc, dfaProductType &ff);
+
 void 
 Code_Project::makeDFA()
 {
-  dfa = st_dfa_minimization(st_dfa_project
-			    (vc.DFATranslate(), 
-			     var, pos));
-  vc.remove();
+  IdentList ids;
+  Deque<VarCode *> links;
+  VarCode *operand = projectionChain(this, ids, links);
+  dfaProductType ff;
+
+  if (fusedProduct(*operand, ff)) {
+    Code_cc *c = (Code_cc *) operand->code;
+    c->Code_cc::makeDFA();
+    dfa = st_dfa_minimization(st_dfa_product_project
+			      (c->a1, c->a2, ff, &ids, pos));
+  }
+  else
+    dfa = st_dfa_minimization(st_dfa_project
+			      (operand->DFATranslate(), 
+			       &ids, pos));
+  while (links.size())
+    links.pop_back()->remove();
 }
 
 void 
 Code_Project::makeGTA()
 {
+  IdentList ids;
+  Deque<VarCode *> links;
+  VarCode *operand = projectionChain(this, ids, links);
+
   gta = st_gta_minimization(st_gta_project
-			    (vc.GTATranslate(),
-			     var, pos));
-  vc.remove();
+			    (operand->GTATranslate(),
+			     &ids, pos));
+  while (links.size())
+    links.pop_back()->remove();
 }
 
 ////////// Code_Negate ////////////////////////////////////////////////////////
@@ -966,11 +1116,176 @@ Code_Prefix::makeDFA()
 
 ////////// Code_And ///////////////////////////////////////////////////////////
 
+// chains of unshared, not yet translated conjunctions, or disjunctions,
+// with at least this many operands are translated with a single n-ary
+// product, which picks the order the operands are combined in
+#define PRODUCT_LIST_MIN 3
+
+static unsigned
+countOperands(VarCode &vc, CodeKind kind)
+{
+  if (vc.code->kind != kind || vc.code->refs > 1 || vc.code->dfa)
+    return 1;
+  Code_cc *c = (Code_cc *) vc.code;
+  return countOperands(c->vc1, kind) + countOperands(c->vc2, kind);
+}
+
+// true if c is translated with a product list
+static bool
+productChain(Code_cc *c)
+{
+  return countOperands(c->vc1, c->kind) + countOperands(c->vc2, c->kind) >=
+    PRODUCT_LIST_MIN;
+}
+
+// true if the binary product at vc is made together with the projection
+// above it, with the product type in ff; as with projection chains, the
+// node must be used only there, not made yet, not renamed and not cached
+static bool
+fusedProduct(VarCode &vc, dfaProductType &ff)
+{
+  if (autCache.enabled() || vc.code->refs > 1 || vc.code->dfa ||
+      !equal(vc.vars, &vc.code->vars))
+    return false;
+  switch (vc.code->kind) {
+  case cAnd:
+  case cOr:
+    if (productChain((Code_cc *) vc.code))
+      return false;
+    ff = vc.code->kind == cAnd ? dfaAND : dfaOR;
+    return true;
+  case cImpl:
+    ff = dfaIMPL;
+    return true;
+  case cBiimpl:
+    ff = dfaBIIMPL;
+    return true;
+  default:
+    return false;
+  }
+}
+
+static void
+collectOperands(VarCode &vc, CodeKind kind, Deque<VarCode> &operands)
+{ // move the operands of the chain at vc to operands, renamed to the
+  // variables of vc, and release the nodes of the chain; the deeper
+  // operand goes first, so a left or right deep chain keeps the order of
+  // the formula (the operands of a Code_cc are ordered by address)
+  if (vc.code->kind != kind || vc.code->refs > 1 || vc.code->dfa) {
+    operands.push_back(vc);
+    vc.code = NULL;
+    return;
+  }
+  Code_cc *c = (Code_cc *) vc.code;
+  bool swap = c->vc2.code->depth > c->vc1.code->depth;
+  VarCode *child[2] = {swap ? &c->vc2 : &c->vc1, swap ? &c->vc1 : &c->vc2};
+  for (int i = 0; i < 2; i++) {
+    if (vc.vars != &c->vars) {
+      IdentList *v = subst(child[i]->vars, &c->vars, vc.vars);
+      if (child[i]->vars != &child[i]->code->vars)
+	delete child[i]->vars;
+      child[i]->vars = v;
+    }
+    collectOperands(*child[i], kind, operands);
+  }
+  vc.remove();
+}
+
+static void
+listOperands(Code_cc *c, Deque<VarCode *> &operands)
+{ // the operands that collectOperands collects below c, in its order
+  bool swap = c->vc2.code->depth > c->vc1.code->depth;
+  VarCode *child[2] = {swap ? &c->vc2 : &c->vc1, swap ? &c->vc1 : &c->vc2};
+  for (int i = 0; i < 2; i++)
+    if (countOperands(*child[i], c->kind) == 1)
+      operands.push_back(child[i]);
+    else
+      listOperands((Code_cc *) child[i]->code, operands);
+}
+
+static int
+chainNeed(Code_cc *c)
+{ // all operands are kept until the product list is made, GTAs are
+  // made by binary products
+  if (options.mode == TREE || !c->vc1.code || !productChain(c))
+    return c->Code_cc::findNeed();
+  Deque<VarCode *> operands;
+  listOperands(c, operands);
+  unsigned n = operands.size(), i;
+  int *need = new int[n], m;
+  unsigned *order = new unsigned[n];
+  for (i = 0; i < n; i++)
+    need[i] = operands.get(i)->code->need();
+  m = orderByNeed(n, need, order);
+  delete[] order;
+  delete[] need;
+  return m;
+}
+
+static DFA *
+productList(Code_cc *c, dfaProductType ff)
+{
+  Deque<VarCode> operands;
+  if (c->vc2.code->depth > c->vc1.code->depth) {
+    collectOperands(c->vc2, c->kind, operands);
+    collectOperands(c->vc1, c->kind, operands);
+  }
+  else {
+    collectOperands(c->vc1, c->kind, operands);
+    collectOperands(c->vc2, c->kind, operands);
+  }
+
+  unsigned n = operands.size(), i;
+  DFA **a = new DFA*[n], *result;
+  TranslateTask **tasks = new TranslateTask*[n];
+  int *need = new int[n];
+  unsigned *order = new unsigned[n];
+  for (i = 0; i < n; i++) {
+    tasks[i] = NULL;
+    if (scheduler.active() && spawnable(operands.get(i))) {
+      tasks[i] = new TranslateTask(operands.get(i));
+      scheduler.spawn(tasks[i]);
+    }
+    need[i] = needOf(operands.get(i), operands.get(i).code->dfa);
+  }
+  // translated in the order that keeps the fewest automata, the
+  // product orders them again by their sizes and variables
+  orderByNeed(n, need, order);
+  for (i = 0; i < n; i++)
+    if (!tasks[order[i]]) {
+      a[order[i]] = operands.get(order[i]).DFATranslate();
+      operands.get(order[i]).remove();
+    }
+  for (i = 0; i < n; i++)
+    if (tasks[i]) {
+      scheduler.wait(tasks[i]);
+      a[i] = tasks[i]->dfa;
+      delete tasks[i];
+    }
+
+  result = st_dfa_product_list(a, n, ff, c->pos);
+  delete[] order;
+  delete[] need;
+  delete[] tasks;
+  delete[] a;
+  return result;
+}
+
+int
+Code_And::findNeed()
+{
+  return chainNeed(this);
+}
+
 void 
 Code_And::makeDFA()
 {
-  Code_cc::makeDFA();
-  dfa = st_dfa_minimization(st_dfa_product(a1, a2, dfaAND, pos));
+  if (productChain(this))
+    dfa = st_dfa_minimization(productList(this, dfaAND));
+  else {
+    Code_cc::makeDFA();
+    dfa = st_dfa_minimization(st_dfa_product(a1, a2, dfaAND, pos));
+  }
 }
 
 void 
@@ -1000,11 +1315,21 @@ Code_IdLeft::makeGTA()
 
 ////////// Code_Or ////////////////////////////////////////////////////////////
 
+int
+Code_Or::findNeed()
+{
+  return chainNeed(this);
+}
+
 void 
 Code_Or::makeDFA()
 {
-  Code_cc::makeDFA();
-  dfa = st_dfa_minimization(st_dfa_product(a1, a2, dfaOR, pos));
+  if (productChain(this))
+    dfa = st_dfa_minimization(productList(this, dfaOR));
+  else {
+    Code_cc::makeDFA();
+    dfa = st_dfa_minimization(st_dfa_product(a1, a2, dfaOR, pos));
+  }
 }
 
 void 
@@ -1125,7 +1450,7 @@ Code_PredCall::makeDFA()
     dfa = dfaImport(filename, NULL, NULL);
     if (!dfa)
       error((String) "Error reading file '" + filename + "'");
-    st_dfa_replace_indices(dfa, &vars, &s, true, false); 
+    dfa = st_dfa_replace_indices(dfa, &vars, &s, true, false); 
   }
 
   else { // need to make automaton
@@ -1134,7 +1459,7 @@ Code_PredCall::makeDFA()
 	   << "' --\n";   
 
     dfa = vc.DFATranslate();
-    st_dfa_replace_indices(dfa, &s, &vars, false, true);
+    dfa = st_dfa_replace_indices(dfa, &s, &vars, false, true);
 
     if (options.separateCompilation) {
       if (options.statistics)
@@ -1143,7 +1468,7 @@ Code_PredCall::makeDFA()
 	error("Unable to write file");
     }
 
-    st_dfa_replace_indices(dfa, &vars, &s, true, false);
+    dfa = st_dfa_replace_indices(dfa, &vars, &s, true, false);
 
     if (options.statistics)
       cout << "-- Leaving predicate '" << symbolTable.lookupSymbol(name)
@@ -1162,7 +1487,7 @@ Code_PredCall::makeGTA()
     gta = gtaImport(filename, NULL, NULL, NULL, false);
     if (!gta)
       error((String) "Error reading file '" + filename + "'");
-    st_gta_replace_indices(gta, &vars, &s, true, false); 
+    gta = st_gta_replace_indices(gta, &vars, &s, true, false); 
   }
 
   else { // need to make automaton
@@ -1171,7 +1496,7 @@ Code_PredCall::makeGTA()
 	   << "' --\n";
 
     gta = vc.GTATranslate();
-    st_gta_replace_indices(gta, &s, &vars, false, true);
+    gta = st_gta_replace_indices(gta, &s, &vars, false, true);
 
     if (options.separateCompilation) {
       SSSet *statespaces = new SSSet[vars.size()];
@@ -1190,7 +1515,7 @@ Code_PredCall::makeGTA()
       delete[] statespaces;
     }
 
-    st_gta_replace_indices(gta, &vars, &s, true, false);
+    gta = st_gta_replace_indices(gta, &vars, &s, true, false);
 
     if (options.statistics) {
       unsigned i, n = 0;
@@ -1238,7 +1563,7 @@ Code_Import::makeDFA()
     error((String) "Error reading file '" + file + "'");
 
   IdentList *off = getOffsets(fileVars, fileOrders, NULL);
-  st_dfa_replace_indices(dfa, actuals, off, true, false); 
+  dfa = st_dfa_replace_indices(dfa, actuals, off, true, false); 
 
   for (int i = 0; fileVars[i]; i++)
     mem_free(fileVars[i]);
@@ -1262,7 +1587,7 @@ Code_Import::makeGTA()
     error((String) "Error reading file '" + file + "'");
 
   IdentList *off = getOffsets(fileVars, fileOrders, fileSS);
-  st_gta_replace_indices(gta, actuals, off, true, false); 
+  gta = st_gta_replace_indices(gta, actuals, off, true, false); 
 
   for (int i = 0; fileVars[i]; i++) {
     mem_free(fileVars[i]);
@@ -1356,7 +1681,7 @@ Code_Export::makeDFA()
   if (options.statistics)
     cout << "-- Exporting '" << file << "' --\n";
   
-  DFA *dfa2 = dfaCopy(dfa);
+  DFA *dfa2 = dfaShare(dfa);
   if (lastPosVar != -1)
     dfa2 = st_dfa_lastpos(dfa2, offsets.off(lastPosVar));
   if (allPosVar != -1)
@@ -1367,7 +1692,7 @@ Code_Export::makeDFA()
     dfa2 = dfaMinimize(dfa2);
     dfaFree(t);
   }
-  st_dfa_replace_indices(dfa2, &s, &freevars, false, true);
+  dfa2 = st_dfa_replace_indices(dfa2, &s, &freevars, false, true);
   if (!dfaExport(dfa2, file, num, names, orders))
     error("Unable to write file");
   dfaFree(dfa2);
@@ -1387,7 +1712,7 @@ Code_Export::makeGTA()
   for (unsigned i = 0; i < freevars.size(); i++)
     statespaces[i] = stateSpaces(freevars.get(i));
 
-  GTA *gta2 = gtaCopy(gta);
+  GTA *gta2 = gtaShare(gta);
   if (allPosVar != -1)
     gta2 = st_gta_allpos(gta2, offsets.off(allPosVar));
   if (options.unrestrict) {
@@ -1396,7 +1721,7 @@ Code_Export::makeGTA()
     gta2 = gtaMinimize(gta2);
     gtaFree(t);
   }
-  st_gta_replace_indices(gta2, &s, &freevars, false, true);
+  gta2 = st_gta_replace_indices(gta2, &s, &freevars, false, true);
   if (!gtaExport(gta2, file, num, names, orders, statespaces, 
 		 options.inheritedAcceptance)) 
     error("Unable to write file");
@@ -1408,3 +1733,153 @@ Code_Export::makeGTA()
   
   vc.remove();
 }
+
+////////// Peak prediction ////////////////////////////////////////////////////
+
+// replays the DFA translation of the DAG without making any automaton,
+// taking the operands in the same order as makeDFA and counting each
+// automaton as one; the sizes are not known before translation
+class PeakPrediction {
+public:
+  PeakPrediction() : peak(0), live(0) {}
+
+  bool obtain(VarCode &vc);
+
+  unsigned peak; // most automata kept at the same time
+
+private:
+  bool made(VarCode &vc) {return uses.count(vc.code);}
+  void translate(VarCode &vc);
+  void obtain(VarCode &vc1, VarCode &vc2, unsigned &owned);
+  void produce(unsigned owned, unsigned extra, bool minimized);
+
+  std::map<Code *, int> uses; // references left to the nodes made so far
+  unsigned live;              // automata kept now
+};
+
+bool
+PeakPrediction::obtain(VarCode &vc)
+{ // the automaton of vc for one of its references, true if that
+  // reference owns it: it is the last one, or it is renamed and gets a
+  // copy (see VarCode::DFATranslate)
+  translate(vc);
+  if (--uses[vc.code] == 0)
+    return true;
+  if (!equal(vc.vars, &vc.code->vars)) {
+    if (++live > peak)
+      peak = live;
+    return true;
+  }
+  return false;
+}
+
+void
+PeakPrediction::obtain(VarCode &vc1, VarCode &vc2, unsigned &owned)
+{ // the operands of a Code_cc, in the order of Code_cc::makeDFA
+  if (leftFirst(vc1, needOf(vc1, made(vc1)), vc2, needOf(vc2, made(vc2)))) {
+    owned += obtain(vc1);
+    owned += obtain(vc2);
+  }
+  else {
+    owned += obtain(vc2);
+    owned += obtain(vc1);
+  }
+}
+
+void
+PeakPrediction::produce(unsigned owned, unsigned extra, bool minimized)
+{ // extra automata are made while the operands are still kept, then
+  // the owned operands are freed and the result is minimized
+  if (live + extra > peak)
+    peak = live + extra;
+  live -= owned;
+  if (minimized && live + 2 > peak)
+    peak = live + 2;
+  if (++live > peak)
+    peak = live;
+}
+
+void
+PeakPrediction::translate(VarCode &vc)
+{
+  Code *c = vc.code;
+  unsigned owned = 0;
+  if (made(vc))
+    return;
+
+  switch (c->kind) {
+  case cAnd:
+  case cOr:
+    if (productChain((Code_cc *) c)) {
+      Deque<VarCode *> operands;
+      listOperands((Code_cc *) c, operands);
+      unsigned n = operands.size(), i;
+      int *need = new int[n];
+      unsigned *order = new unsigned[n];
+      for (i = 0; i < n; i++)
+	need[i] = needOf(*operands.get(i), made(*operands.get(i)));
+      orderByNeed(n, need, order);
+      for (i = 0; i < n; i++)
+	owned += obtain(*operands.get(order[i]));
+      produce(owned, 1, true);
+      delete[] order;
+      delete[] need;
+      break;
+    }
+    // fall through
+  case cImpl:
+  case cBiimpl:
+    obtain(((Code_cc *) c)->vc1, ((Code_cc *) c)->vc2, owned);
+    produce(owned, 1, true);
+    break;
+  case cIdLeft: // the left operand is the result
+    obtain(((Code_cc *) c)->vc1, ((Code_cc *) c)->vc2, owned);
+    produce(owned, 0, false);
+    break;
+  case cProject:
+    {
+      IdentList ids;
+      Deque<VarCode *> links;
+      VarCode *operand = projectionChain((Code_Project *) c, ids, links);
+      dfaProductType ff;
+      if (fusedProduct(*operand, ff)) {
+	// the product is kept until its projection is made
+	Code_cc *cc = (Code_cc *) operand->code;
+	obtain(cc->vc1, cc->vc2, owned);
+	produce(owned, 2, true);
+      }
+      else
+	produce(obtain(*operand), 1, true);
+      break;
+    }
+  case cPrefix:
+    produce(obtain(((Code_c *) c)->vc), 1, true);
+    break;
+  case cNegate: // changed in place, or a copy if shared
+  case cPredCall:
+    owned = obtain(((Code_c *) c)->vc);
+    produce(owned, !owned, false);
+    break;
+  case cRestrict:
+    owned = obtain(((Code_c *) c)->vc);
+    produce(owned, !owned, true);
+    break;
+  case cExport: // the automaton is shared with the exported one
+    produce(obtain(((Code_c *) c)->vc), 1, false);
+    break;
+  default:
+    produce(0, 1, false);
+    break;
+  }
+  uses[c] = c->refs;
+}
+
+unsigned
+predictPeak(VarCode &root, Deque<VarCode> &more)
+{
+  PeakPrediction p;
+  p.obtain(root);
+  for (Deque<VarCode>::iterator i = more.begin(); i != more.end(); i++)
+    p.obtain(*i);
+  return p.peak;
+}
@@ -28,6 +28,7 @@
 #include "printline.h"
 #include "ident.h"
 #include "str.h"
+#include "autcache.h"
 
 ////////// StateSpaces ////////////////////////////////////////////////////////
 
@@ -44,7 +45,7 @@ enum CodeKind {
   cEqMinus1, cEqPlus2, cEqMinus2, cEqPlusModulo, cEqMinusModulo,
   cEqMin, cEqMax, cAnd, cOr, cImpl, cBiimpl, cRestrict, cProject,
   cNegate, cImport, cExport, cPrefix, cInStateSpace, cIdLeft, 
-  cEqPresbConst, cWellFormedTree, cSomeType, cAndList
+  cEqPresbConst, cWellFormedTree, cSomeType
 };
 
 class Code;
@@ -62,6 +63,10 @@ public:
   DFA *DFATranslate(); 
   GTA *GTATranslate(); 
 
+  // generate a lazy DFA whose outermost connectives are only expanded
+  // as far as the analysis explores them
+  dfaLazy *DFATranslateLazy();
+
   // reduction (reduce.cpp)
   void reduceAll(Deque<VarCode> *vcl);
   void reduce();
@@ -113,7 +118,8 @@ class Code {
 public:
   Code(CodeKind knd, Pos p) :
     kind(knd), refs(1), pos(p), mark(0), eqlist(NULL), dfa(NULL), gta(NULL),
-    conj(NULL), restrconj(NULL), depth(0)/**, conjhash(0)**/ {}
+    conj(NULL), restrconj(NULL), depth(0), excl(-1), needs(-1), keyed(-1)
+    /**, conjhash(0)**/ {}
   virtual ~Code() {}
 
   // determine syntax/signature equivalence
@@ -129,6 +135,24 @@ public:
   // remove one reference to this node, if last then call recursively
   void remove();
 
+  // true if no node below is shared with the rest of the DAG and no
+  // global front-end state is needed, so another thread may translate
+  // the subtree (code.cpp)
+  bool exclusive() {if (excl < 0) excl = findExclusive(); return excl;}
+  virtual bool findExclusive() {return true;}
+
+  // number of automata that must be in memory at the same time to make
+  // the automaton of this node from scratch, with the children taken in
+  // the best order (code.cpp)
+  int need() {if (needs < 0) needs = findNeed(); return needs;}
+  virtual int findNeed() {return 1;}
+
+  // digest of the subtree for the automaton cache, NULL if the subtree
+  // cannot be cached; must be taken before the node is translated
+  // (autcache.cpp)
+  Digest *key();
+  virtual bool makeKey(Digest &d);
+
   // dump node/subtree contents
   virtual void viz(); // graphviz format
   virtual void dump(bool rec) = 0; // dump recursively/non-recursively
@@ -165,6 +189,10 @@ public:
   VarCodeList *conj;       // conjuncts (used during red.)
   VarCodeList *restrconj;  // restricted conjuncts (used during red.)
   int        depth;        // max number of steps to leaf
+  int        excl;         // cached exclusive(), -1 if not known yet
+  int        needs;        // cached need(), -1 if not known yet
+  int        keyed;        // cached key() != NULL, -1 if not known yet
+  Digest     digest;       // cached key()
 /**
   unsigned   conjhash;     // hashing of conj and restrconj (used during red.)
 **/
@@ -178,6 +206,7 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
 
   Ident id;
 };
@@ -188,6 +217,7 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
 
   int val;
 };
@@ -198,6 +228,7 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
 
   Ident id1;
   Ident id2;
@@ -209,6 +240,7 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
 
   int val;
 };
@@ -219,6 +251,7 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
 
   Ident id1;
   Ident id2;
@@ -232,6 +265,7 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
   void setmark(int val);
   void viz();
   void reduce1();
@@ -239,6 +273,8 @@ public:
   void clearEqlist();
   virtual bool checkExport(Ident x);
   void show() {};
+  virtual bool findExclusive();
+  int findNeed();
 
   VarCode vc;
 };
@@ -250,6 +286,7 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
   void setmark(int val);
   void viz();
   void reduce1();
@@ -257,6 +294,8 @@ public:
   void clearEqlist();
   bool checkExport(Ident x);
   void show() {};
+  bool findExclusive();
+  int findNeed();
   virtual void makeDFA();
   virtual void makeGTA();
 
@@ -266,30 +305,6 @@ public:
   GTA *g1,*g2;
 };
 
-/**
-class Code_clist: public Code {
-public:
-  Code_clist(CodeKind knd, Deque<VarCode> c, Pos p);
-  ~Code_clist() {for (Deque<VarCode>::iterator i = vcl.begin(); i != vcl.end(); i++) i->remove();}
-
-  bool equiv(Code&);
-  unsigned hash();
-  void setmark(int val);
-  void viz();
-  void reduce1();
-  virtual void reduce2();
-  void clearEqlist();
-  bool checkExport(Ident x);
-  void show() {};
-  virtual void makeDFA();
-  virtual void makeGTA();
-
-  Deque<VarCode> vcl;
-  Deque<DFA*> al;
-  Deque<GTA*> gl;
-};
-**/
-
 ////////// Atomic formulas ////////////////////////////////////////////////////
 
 class Code_True: public Code {
@@ -332,6 +347,7 @@ public:
   ~Code_EqRoot() {delete universes;}
 
   bool equiv(Code&);
+  bool makeKey(Digest&);
   void makeGTA();
   void dump(bool rec);
   VarCode substCopy(IdentList *actuals);
@@ -390,6 +406,7 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
   void makeGTA();
   void dump(bool rec);
   VarCode substCopy(IdentList *actuals);
@@ -658,6 +675,7 @@ public:
   Code_Project(Ident n, VarCode c, Pos p);
 
   bool equiv(Code&);
+  bool makeKey(Digest&);
 
   void makeDFA();
   void makeGTA();
@@ -699,6 +717,7 @@ public:
   Code_And(VarCode vc1, VarCode vc2, Pos p) :
     Code_cc(cAnd, vc1, vc2, p) {}
 
+  int findNeed();
   void makeDFA();
   void makeGTA();
   void dump(bool rec);
@@ -707,21 +726,6 @@ public:
   VarCode substCopy(IdentList *actuals);
 };
 
-/*
-class Code_AndList: public Code_cc {
-public:
-  Code_AndList(Deque<VarCode> c, Pos p) :
-    Code_clist(cAndList, c, p) {}
-
-  void makeDFA();
-  void makeGTA();
-  void dump(bool rec);
-  void reduce1();
-  void reduce2();
-  VarCode substCopy(IdentList *actuals);
-};
-*/
-
 class Code_IdLeft: public Code_cc {
 public:
   Code_IdLeft(VarCode vc1, VarCode vc2, Pos p) :
@@ -738,6 +742,7 @@ public:
   Code_Or(VarCode vc1, VarCode vc2, Pos p) :
     Code_cc(cOr, vc1, vc2, p) {}
 
+  int findNeed();
   void makeDFA();
   void makeGTA();
   void dump(bool rec);
@@ -780,12 +785,14 @@ public:
 
   bool equiv(Code&);
   unsigned hash();
+  bool makeKey(Digest&);
   void makeDFA();
   void makeGTA();
   void dump(bool rec);
   void reduce1();
   void reduce2();
   VarCode substCopy(IdentList *actuals);
+  bool findExclusive() {return false;} // uses lib and files
 
   Ident     name;       // predicate name
   char     *filename;   // filename for separate compilation
@@ -807,6 +814,8 @@ public:
   IdentList *getOffsets(char**, int*, SSSet*);
   void dump(bool rec);
   VarCode substCopy(IdentList *actuals);
+  bool findExclusive() {return false;} // uses lib and files
+  bool makeKey(Digest&) {return false;} // depends on files
 
   char         *file;
   Deque<char*> *formals;
@@ -825,6 +834,8 @@ public:
   void makeGTA();
   void dump(bool rec);
   VarCode substCopy(IdentList *actuals);
+  bool findExclusive() {return false;} // uses lib and files
+  bool makeKey(Digest&) {return false;} // writes a file
   bool checkExport(Ident x);
 
   char  *file;   // file name
@@ -834,4 +845,9 @@ public:
   IdentList freevars, s;
 };
 
+// the largest number of automata in memory at the same time while the
+// roots are translated to DFAs one after the other, as predicted from
+// the DAG before translation (code.cpp)
+unsigned predictPeak(VarCode &root, Deque<VarCode> &more);
+
 #endif
@@ -24,6 +24,7 @@
 #include <iostream>
 #include <signal.h>
 #include "codetable.h"
+#include "scheduler.h"
 #include "env.h"
 #include "config.h"
 
@@ -195,14 +196,15 @@ CodeTable::init_print_progress()
 void 
 CodeTable::begin()
 {
-  if (options.printProgress)
+  // the alarm is process-wide, so it is not used by concurrent workers
+  if (options.printProgress && !scheduler.active())
     alarm(1);
 }
 
 void 
 CodeTable::done()
 {
-  if (options.printProgress)
+  if (options.printProgress && !scheduler.active())
     alarm(0);
 }
 
@@ -239,6 +241,7 @@ void
 CodeTable::print_progress()
 {
   if (options.printProgress) {
+    std::lock_guard<std::mutex> l(lock);
     invariant(total_nodes > 0);
     makes++;
     int part = 100 * makes / total_nodes;
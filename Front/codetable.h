@@ -21,6 +21,7 @@
 #ifndef __CODETABLE_H
 #define __CODETABLE_H
 
+#include <mutex>
 #include "code.h"
 
 #define CODE_TABLE_SIZE 1019
@@ -78,6 +79,8 @@ public:
   int num_prod, num_proj, num_other; // number of operations
 
   int makes, prev; // number of automata constructed
+
+  std::mutex lock; // guards the table and counters during translation
 };
 
 #endif
@@ -35,7 +35,9 @@ public:
     graphvizSatisfyingEx(false), graphvizCounterEx(false), 
     externalWhole(false), demo(false), 
     inheritedAcceptance(false), unrestrict(false), 
-    alternativeM2LStr(false), reorder(false), optimize(0) {}
+    alternativeM2LStr(false), reorder(false), automatonCache(false),
+    lazyAnalysis(false),
+    optimize(0), threads(1) {}
 
   bool time;
   bool whole;
@@ -58,7 +60,10 @@ public:
   bool unrestrict;
   bool alternativeM2LStr;
   bool reorder;
+  bool automatonCache;
+  bool lazyAnalysis;
   unsigned optimize;
+  unsigned threads;
 };
 
 #endif
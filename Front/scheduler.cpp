@@ -0,0 +1,128 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#include "scheduler.h"
+
+Scheduler scheduler;
+
+static thread_local unsigned worker = 0; // index of the calling worker
+
+void
+Scheduler::start(unsigned workers)
+{
+  stopping = false;
+  for (unsigned i = 0; i < workers; i++)
+    queues.push_back(new Queue);
+  for (unsigned i = 1; i < workers; i++)
+    threads.push_back(std::thread(&Scheduler::work, this, i));
+}
+
+void
+Scheduler::stop()
+{
+  {
+    std::lock_guard<std::mutex> l(idle);
+    stopping = true;
+  }
+  wakeup.notify_all();
+  for (unsigned i = 0; i < threads.size(); i++)
+    threads[i].join();
+  threads.clear();
+  for (unsigned i = 0; i < queues.size(); i++)
+    delete queues[i];
+  queues.clear();
+}
+
+void
+Scheduler::spawn(Task *t)
+{
+  Queue *q = queues[worker];
+  {
+    std::lock_guard<std::mutex> l(q->lock);
+    q->tasks.push_back(t);
+  }
+  std::lock_guard<std::mutex> l(idle);
+  pending++;
+  wakeup.notify_one();
+}
+
+Task*
+Scheduler::take(unsigned self)
+{
+  Task *t = NULL;
+  for (unsigned i = 0; i < queues.size() && !t; i++) {
+    Queue *q = queues[(self + i) % queues.size()];
+    std::lock_guard<std::mutex> l(q->lock);
+    if (!q->tasks.empty()) {
+      if (i == 0) { // own queue: newest first
+	t = q->tasks.back();
+	q->tasks.pop_back();
+      }
+      else { // steal: oldest first, probably the largest subtree
+	t = q->tasks.front();
+	q->tasks.pop_front();
+      }
+    }
+  }
+  if (t)
+    pending--;
+  return t;
+}
+
+void
+Scheduler::execute(Task *t)
+{
+  t->run();
+  t->done.store(true, std::memory_order_release);
+  // a worker may sleep waiting for exactly this task
+  std::lock_guard<std::mutex> l(idle);
+  wakeup.notify_all();
+}
+
+void
+Scheduler::wait(Task *t)
+{
+  while (!t->done.load(std::memory_order_acquire)) {
+    Task *other = take(worker);
+    if (other)
+      execute(other);
+    else {
+      std::unique_lock<std::mutex> l(idle);
+      wakeup.wait(l, [&] {return pending > 0 || t->done.load();});
+    }
+  }
+}
+
+void
+Scheduler::work(unsigned self)
+{
+  worker = self;
+  for (;;) {
+    Task *t = take(self);
+    if (t)
+      execute(t);
+    else {
+      std::unique_lock<std::mutex> l(idle);
+      wakeup.wait(l, [&] {return pending > 0 || stopping;});
+      if (stopping && pending == 0)
+	return;
+    }
+  }
+}
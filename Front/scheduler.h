@@ -0,0 +1,76 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#ifndef __SCHEDULER_H
+#define __SCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a unit of work that can be run by any worker
+class Task {
+public:
+  Task() : done(false) {}
+  virtual ~Task() {}
+
+  virtual void run() = 0;
+
+  std::atomic<bool> done;
+};
+
+// work-stealing scheduler: every worker (the thread calling start is
+// worker 0) owns a deque of spawned tasks, runs its own newest task
+// first and steals the oldest tasks of the others when idle
+class Scheduler {
+public:
+  Scheduler() : stopping(false), pending(0) {}
+
+  void start(unsigned workers);
+  void stop();
+  bool active() {return !threads.empty();}
+
+  void spawn(Task *t); // make t available to all workers
+  void wait(Task *t);  // run other tasks until t is done
+
+private:
+  struct Queue {
+    std::mutex lock;
+    std::deque<Task*> tasks;
+  };
+
+  Task *take(unsigned self);
+  void work(unsigned self);
+  void execute(Task *t);
+
+  std::vector<Queue*> queues;
+  std::vector<std::thread> threads;
+  std::mutex idle;
+  std::condition_variable wakeup;
+  bool stopping;
+  std::atomic<int> pending; // tasks spawned but not yet taken
+};
+
+extern Scheduler scheduler;
+
+#endif
@@ -19,6 +19,8 @@
  */
 
 #include <iostream>
+#include <atomic>
+#include <mutex>
 
 #include "st_dfa.h"
 #include "printline.h"
@@ -27,6 +29,10 @@
 #include "timer.h"
 #include "codetable.h"
 
+extern "C" {
+#include "../Mem/mem.h"
+}
+
 using std::cout;
 
 extern Offsets offsets;
@@ -42,22 +48,30 @@ Timer timer_minimization;
 Timer timer_copy;
 Timer timer_replace_indices;
 Timer timer_prefix;
-
-unsigned num_minimizations = 0;
-unsigned num_projections = 0;
-unsigned num_products = 0;
-unsigned num_copies = 0;
-unsigned num_replaces = 0;
-unsigned num_right_quotients = 0;
-unsigned num_restricts = 0;
-unsigned num_negations = 0;
-unsigned num_prefixes = 0;
+Timer timer_product_project;
+
+// counted atomically, the operations may run in several threads
+std::atomic<unsigned> num_minimizations(0);
+std::atomic<unsigned> num_projections(0);
+std::atomic<unsigned> num_products(0);
+std::atomic<unsigned> num_copies(0);
+std::atomic<unsigned> num_replaces(0);
+std::atomic<unsigned> num_right_quotients(0);
+std::atomic<unsigned> num_restricts(0);
+std::atomic<unsigned> num_negations(0);
+std::atomic<unsigned> num_prefixes(0);
+std::atomic<unsigned> num_product_projects(0);
+std::atomic<unsigned long> product_project_states(0); // never minimized
+
+unsigned predicted_dfa_in_mem = 0;
 
 int largest_states = 0, largest_bdd = 0;
+static std::mutex largest_lock;
 
 void
 update_largest(DFA *a)
 {
+  std::lock_guard<std::mutex> l(largest_lock);
   if (a->ns > largest_states)
     largest_states = a->ns;
   if ((int) bdd_size(a->bddm) > largest_bdd)
@@ -81,6 +95,7 @@ st_dfa_restrict(DFA *a, Pos &p)
     cout << "\n";
   }
 
+  a = st_dfa_writable(a);
   dfaRestrict(a);
   num_restricts++;
 
@@ -117,6 +132,7 @@ st_dfa_negation(DFA *a, Pos &p)
     cout <<"\n";
   }
 
+  a = st_dfa_writable(a);
   dfaNegation(a);
   num_negations++;
 
@@ -136,6 +152,25 @@ st_dfa_negation(DFA *a, Pos &p)
   return a;
 }
 
+static void
+print_product_type(dfaProductType ff)
+{
+  switch (ff) {
+  case dfaAND:
+    cout << "&";
+    break;
+  case dfaOR:
+    cout << "|";
+    break;
+  case dfaIMPL:
+    cout << "=>";
+    break;
+  case dfaBIIMPL:
+    cout << "<=>";
+    break;
+  }
+}
+
 DFA* 
 st_dfa_product(DFA *a1, DFA *a2, dfaProductType ff, Pos &p)
 {
@@ -152,20 +187,7 @@ st_dfa_product(DFA *a1, DFA *a2, dfaProductType ff, Pos &p)
 
   if (options.statistics) {
     cout << "Product ";
-    switch (ff) {
-    case dfaAND:
-      cout << "&";
-      break;
-    case dfaOR:
-      cout << "|";
-      break;
-    case dfaIMPL:
-      cout << "=>";
-      break;
-    case dfaBIIMPL:
-      cout << "<=>";
-      break;
-    }
+    print_product_type(ff);
     p.printsource();
     cout << "\n  (" << a1_ns << "," << bdd_size(a1->bddm) << ")x("
 	 << a2_ns << "," << bdd_size(a2->bddm) << ") -> ";
@@ -196,10 +218,70 @@ st_dfa_product(DFA *a1, DFA *a2, dfaProductType ff, Pos &p)
   return result;
 }
 
+DFA* 
+st_dfa_product_list(DFA **a, unsigned n, dfaProductType ff, Pos &p)
+{
+  Timer temp;
+  unsigned i;
+
+  if (options.time) {
+    timer_product.start();
+    if (options.statistics)
+      temp.start();
+  }
+
+  if (options.statistics) {
+    cout << "Product " << (ff == dfaAND ? "&" : "|") << " of " << n;
+    p.printsource();
+    cout << "\n  ";
+    for (i = 0; i < n; i++)
+      cout << (i ? "x(" : "(") << a[i]->ns << "," << bdd_size(a[i]->bddm) << ")";
+    cout << " -> ";
+    cout.flush();
+  }
+
+  codeTable->begin();
+  DFA *result = dfaProductList(a, n, ff); 
+  codeTable->done();
+  num_products++;
+
+  if (options.statistics)
+    cout << "(" << result->ns << "," << bdd_size(result->bddm) << ")\n";
+
+  if (options.time) {
+    timer_product.stop();
+    if (options.statistics) {
+      temp.stop();
+      cout << "  Time: ";
+      temp.print();
+    }
+  }
+
+  for (i = 0; i < n; i++)
+    dfaFree(a[i]);
+
+  return result;
+}
+
 DFA* 
 st_dfa_project(DFA *a, Ident i, Pos &p, bool quotient) 
+{
+  IdentList ids(i);
+
+  return st_dfa_project(a, &ids, p, quotient);
+}
+
+DFA* 
+st_dfa_project(DFA *a, IdentList *ids, Pos &p, bool quotient) 
 {
   Timer temp1, temp2;
+  unsigned n = ids->size();
+  unsigned *indices = new unsigned[n];
+  Ident *id;
+  unsigned k;
+
+  for (id = ids->begin(), k = 0; id != ids->end(); id++, k++)
+    indices[k] = offsets.off(*id);
 
   int a_ns = a->ns;
   
@@ -213,10 +295,11 @@ st_dfa_project(DFA *a, Ident i, Pos &p, bool quotient)
     cout << "Right-quotient\n";
 
   if (quotient) {
+    a = st_dfa_writable(a);
     codeTable->begin();
-    dfaRightQuotient(a, offsets.off(i));
+    dfaRightQuotientList(a, n, indices);
     codeTable->done();
-    num_right_quotients++;
+    num_right_quotients += n;
   }
 
   if (options.time) {
@@ -235,16 +318,18 @@ st_dfa_project(DFA *a, Ident i, Pos &p, bool quotient)
   }
 
   if (options.statistics) {
-    cout << "Projecting #" << i;
+    cout << "Projecting";
+    for (id = ids->begin(); id != ids->end(); id++)
+      cout << " #" << *id;
     p.printsource();
     cout << "\n  (" << a_ns << "," << bdd_size(a->bddm) << ") -> ";
     cout.flush();
   }
 
   codeTable->begin();
-  DFA *result = dfaProject(a, offsets.off(i));
+  DFA *result = dfaProjectList(a, n, indices);
   codeTable->done();
-  num_projections++;
+  num_projections += n;
 
   if (options.statistics)
     cout << "("  << result->ns << "," << bdd_size(result->bddm) << ")\n";
@@ -259,11 +344,74 @@ st_dfa_project(DFA *a, Ident i, Pos &p, bool quotient)
   }
 
   dfaFree(a);
+  delete[] indices;
 
   /*#warning  update_largest(result);*/
   return result;
 }
 
+DFA* 
+st_dfa_product_project(DFA *a1, DFA *a2, dfaProductType ff, 
+		       IdentList *ids, Pos &p)
+{
+  Timer temp;
+  unsigned n = ids->size();
+  unsigned *indices = new unsigned[n];
+  int product_size[2];
+  Ident *id;
+  unsigned k;
+
+  for (id = ids->begin(), k = 0; id != ids->end(); id++, k++)
+    indices[k] = offsets.off(*id);
+
+  if (options.time) {
+    timer_product_project.start();
+    if (options.statistics)
+      temp.start();
+  }
+
+  if (options.statistics) {
+    cout << "Product ";
+    print_product_type(ff);
+    cout << " and projecting";
+    for (id = ids->begin(); id != ids->end(); id++)
+      cout << " #" << *id;
+    p.printsource();
+    cout << "\n  (" << a1->ns << "," << bdd_size(a1->bddm) << ")x("
+	 << a2->ns << "," << bdd_size(a2->bddm) << ") -> ";
+    cout.flush();
+  }
+
+  codeTable->begin();
+  DFA *result = 
+    dfaProductProject(a1, a2, ff, n, indices, product_size);
+  codeTable->done();
+  num_products++;
+  num_projections += n;
+  num_right_quotients += n;
+  num_product_projects++;
+  product_project_states += product_size[0];
+
+  if (options.statistics)
+    cout << "[" << product_size[0] << "," << product_size[1] << "] -> ("
+	 << result->ns << "," << bdd_size(result->bddm) << ")\n";
+
+  if (options.time) {
+    timer_product_project.stop();
+    if (options.statistics) {
+      temp.stop();
+      cout << "  Time: ";
+      temp.print();
+    }
+  }
+
+  dfaFree(a1);
+  dfaFree(a2);
+  delete[] indices;
+
+  return result;
+}
+
 DFA* 
 st_dfa_minimization(DFA *a)
 {
@@ -310,10 +458,13 @@ st_dfa_minimization(DFA *a)
 }
 
 DFA*
-st_dfa_copy(DFA *a)
+st_dfa_writable(DFA *a)
 {
   Timer temp;
 
+  if (a->refs == 1)
+    return a;
+
   if (options.time) {
     timer_copy.start();
     if (options.statistics)
@@ -323,7 +474,7 @@ st_dfa_copy(DFA *a)
   if (options.statistics) 
     cout << "Copying (" << a->ns << "," << bdd_size(a->bddm) << ")\n";
     
-  DFA *result = dfaCopy(a);
+  DFA *result = dfaWritable(a);
   num_copies++;
 
   if (options.time) {
@@ -342,7 +493,7 @@ st_dfa_copy(DFA *a)
   return result;
 }
 
-void 
+DFA* 
 st_dfa_replace_indices(DFA *a, IdentList *newvars, IdentList *oldvars,
 		       bool offnew, bool offold)
 {
@@ -375,6 +526,7 @@ st_dfa_replace_indices(DFA *a, IdentList *newvars, IdentList *oldvars,
       if (options.statistics)
 	cout << "Replacing indices\n";
 
+      a = st_dfa_writable(a);
       dfaReplaceIndices(a, indexmap);
       num_replaces++;
 
@@ -395,6 +547,7 @@ st_dfa_replace_indices(DFA *a, IdentList *newvars, IdentList *oldvars,
   }
 
   /*#warning  update_largest(a);*/
+  return a;
 }
 
 DFA* 
@@ -414,6 +567,7 @@ st_dfa_prefix(DFA *a, Pos &p)
     cout <<"\n";
   }
 
+  a = st_dfa_writable(a);
   dfaPrefixClose(a);
   num_prefixes++;
 
@@ -465,6 +619,26 @@ st_dfa_allpos(DFA *dfa, Ident i)
   return t2;
 }
 
+dfaLazy*
+st_dfa_lazy_lastpos(dfaLazy *z, Ident i)
+{
+  return dfaLazyProject(dfaLazyProduct(z,
+				       dfaLazyAutomaton
+				       (dfaLastPos(offsets.off(i))),
+				       dfaAND),
+			offsets.off(i));
+}
+
+dfaLazy*
+st_dfa_lazy_allpos(dfaLazy *z, Ident i)
+{
+  return dfaLazyProject(dfaLazyProduct(z,
+				       dfaLazyAutomaton
+				       (dfaAllPos(offsets.off(i))),
+				       dfaAND),
+			offsets.off(i));
+}
+
 void
 print_timing()
 {
@@ -493,6 +667,11 @@ print_timing()
     cout << "Prefix:         ";
     timer_prefix.print();
   }
+
+  if (num_product_projects > 0) {
+    cout << "Fused product:  ";
+    timer_product_project.print();
+  }
 }
 
 void
@@ -507,9 +686,16 @@ print_statistics()
        << "\nNegations:       " << num_negations << "\n";
   if (num_prefixes > 0) 
     cout << "Prefixes:        " << num_prefixes << "\n";
+  if (num_product_projects > 0) 
+    cout << "Fused products:  " << num_product_projects << " ("
+	 << product_project_states << " product states not minimized)\n";
 
   cout << "\nLargest number of states in a minimized automaton: " << largest_states
        << ", BDD nodes: " << largest_bdd << "\n";
 
-  cout << "Maximum number of automata in memory: " << max_dfa_in_mem+max_gta_in_mem << "\n";
+  cout << "Maximum number of automata in memory: " << max_dfa_in_mem+max_gta_in_mem;
+  if (predicted_dfa_in_mem)
+    cout << " (predicted: " << predicted_dfa_in_mem << ")";
+  cout << "\nMaximum memory for BDD tables and caches: " 
+       << (mem_peak_charged()+1023)/1024 << " KB\n";
 }
@@ -31,16 +31,26 @@ extern "C" {
 DFA *st_dfa_restrict(DFA *a, Pos &p);
 DFA *st_dfa_negation(DFA *a, Pos &p);
 DFA *st_dfa_product(DFA *a1, DFA *a2, dfaProductType ff, Pos &p);
+DFA *st_dfa_product_list(DFA **a, unsigned n, dfaProductType ff, Pos &p);
 DFA *st_dfa_project(DFA *a, Ident i, Pos &p, bool quotient = true);
+DFA *st_dfa_project(DFA *a, IdentList *ids, Pos &p, bool quotient = true);
+// the projection of the product, which is not kept or minimized
+DFA *st_dfa_product_project(DFA *a1, DFA *a2, dfaProductType ff,
+			    IdentList *ids, Pos &p);
 DFA *st_dfa_minimization(DFA *a);
-DFA *st_dfa_copy(DFA *a);
-void st_dfa_replace_indices(DFA *a, IdentList *newvars, IdentList *oldvars,
+DFA *st_dfa_writable(DFA *a); // a copy if a has other owners
+DFA *st_dfa_replace_indices(DFA *a, IdentList *newvars, IdentList *oldvars,
 			    bool offnew = true, bool offold = true);
 DFA *st_dfa_prefix(DFA *a, Pos &p);
 DFA *st_dfa_lastpos(DFA *dfa, Ident i);
 DFA *st_dfa_allpos(DFA *dfa, Ident i);
+dfaLazy *st_dfa_lazy_lastpos(dfaLazy *z, Ident i);
+dfaLazy *st_dfa_lazy_allpos(dfaLazy *z, Ident i);
 
 void print_timing();
 void print_statistics();
 
+// the peak predicted before translation, 0 if not predicted
+extern unsigned predicted_dfa_in_mem;
+
 #endif
@@ -99,6 +99,7 @@ st_gta_restrict(GTA *g, Pos &p)
     cout << "\n";
   }
 
+  g = st_gta_writable(g);
   gtaRestrict(g);
   num_restricts++;
 
@@ -135,6 +136,7 @@ st_gta_negation(GTA *g, Pos &p)
     cout << "\n";
   }
 
+  g = st_gta_writable(g);
   gtaNegation(g);
   num_negations++;
 
@@ -218,8 +220,23 @@ st_gta_product(GTA *g1, GTA *g2, gtaProductType ff, Pos &p)
 
 GTA * 
 st_gta_project(GTA *g, Ident i, Pos &p, bool quotient) 
+{
+  IdentList ids(i);
+
+  return st_gta_project(g, &ids, p, quotient);
+}
+
+GTA * 
+st_gta_project(GTA *g, IdentList *ids, Pos &p, bool quotient) 
 {
   Timer temp;
+  unsigned n = ids->size();
+  unsigned *indices = new unsigned[n];
+  Ident *id;
+  unsigned k;
+
+  for (id = ids->begin(), k = 0; id != ids->end(); id++, k++)
+    indices[k] = offsets.off(*id);
 
   if (options.time) {
     timer_project.start();
@@ -228,7 +245,9 @@ st_gta_project(GTA *g, Ident i, Pos &p, bool quotient)
   }
   
   if (options.statistics) {
-    cout << "Right-quotient\n" << "Projecting #" << i;
+    cout << "Right-quotient\n" << "Projecting";
+    for (id = ids->begin(); id != ids->end(); id++)
+      cout << " #" << *id;
     p.printsource();
     cout << "\n  ";
     print_stat(g);
@@ -237,11 +256,11 @@ st_gta_project(GTA *g, Ident i, Pos &p, bool quotient)
   }
   
   codeTable->begin();
-  GTA *result = gtaQuotientAndProject(g, offsets.off(i), quotient);
+  GTA *result = gtaQuotientAndProjectList(g, n, indices, quotient);
   codeTable->done();
   
-  num_projections++;
-  num_right_quotients++;
+  num_projections += n;
+  num_right_quotients += n;
 
   if (options.statistics) {
     print_stat(result);
@@ -258,6 +277,7 @@ st_gta_project(GTA *g, Ident i, Pos &p, bool quotient)
   }
 
   gtaFree(g);
+  delete[] indices;
 
   /*#warning  update_largest(result);*/
   return result;
@@ -310,10 +330,13 @@ st_gta_minimization(GTA *g)
 }
 
 GTA *
-st_gta_copy(GTA *g)
+st_gta_writable(GTA *g)
 {
   Timer temp;
 
+  if (g->refs == 1)
+    return g;
+
   if (options.time) {
     timer_copy.start();
     if (options.statistics)
@@ -326,7 +349,7 @@ st_gta_copy(GTA *g)
     cout << "\n";
   }
   
-  GTA *result = gtaCopy(g);
+  GTA *result = gtaWritable(g);
   num_copies++;
 
   if (options.time) {
@@ -342,7 +365,7 @@ st_gta_copy(GTA *g)
   return result;
 }
 
-void
+GTA *
 st_gta_replace_indices(GTA *g, IdentList *newvars, IdentList *oldvars,
 		       bool offnew, bool offold)
 {
@@ -375,6 +398,7 @@ st_gta_replace_indices(GTA *g, IdentList *newvars, IdentList *oldvars,
       if (options.statistics) 
         cout << "Replacing indices\n";
 
+      g = st_gta_writable(g);
       gtaReplaceIndices(g, indexmap);
       num_replaces++;
 
@@ -392,6 +416,7 @@ st_gta_replace_indices(GTA *g, IdentList *newvars, IdentList *oldvars,
   }
 
   /*#warning  update_largest(g);*/
+  return g;
 }
 
 GTA *
@@ -32,9 +32,10 @@ GTA *st_gta_restrict(GTA *g, Pos &p);
 GTA *st_gta_negation(GTA *g, Pos &p);
 GTA *st_gta_product(GTA *g1, GTA *g2, gtaProductType ff, Pos &p);
 GTA *st_gta_project(GTA *a, Ident i, Pos &p, bool quotient = true);
+GTA *st_gta_project(GTA *a, IdentList *ids, Pos &p, bool quotient = true);
 GTA *st_gta_minimization(GTA *g);
-GTA *st_gta_copy(GTA *g);
-void st_gta_replace_indices(GTA *a, IdentList *newvars, IdentList *oldvars,
+GTA *st_gta_writable(GTA *g); // a copy if g has other owners
+GTA *st_gta_replace_indices(GTA *a, IdentList *newvars, IdentList *oldvars,
 			    bool offnew = true, bool offold = true);
 GTA *st_gta_allpos(GTA *gta, Ident i);
 
@@ -744,17 +744,19 @@ void SymbolTable::stats() {
 }
 
 void SymbolTable::openTmpMode() {
-  invariant(!tmpMode);
+  tmpMarks.push_back(tmpStack.size());
   tmpMode = true;
 }
 
 void SymbolTable::closeTmpMode() {
   invariant(tmpMode);
 
-  for (auto it = tmpStack.rbegin(); it != tmpStack.rend(); ++it) {
-    removeFull(*it);
+  size_t mark = tmpMarks.back();
+  while (tmpStack.size() > mark) {
+    removeFull(tmpStack.back());
+    tmpStack.pop_back();
   }
 
-  tmpStack.clear();
-  tmpMode = false;
+  tmpMarks.pop_back();
+  tmpMode = !tmpMarks.empty();
 }
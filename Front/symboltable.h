@@ -80,6 +80,7 @@ class SymbolTable {
 
   bool           tmpMode;
   std::vector<int> tmpStack;       // stack of "tmp" hashtable indices,
+  std::vector<size_t> tmpMarks;    // tmpStack sizes at the open scopes
 public:
    SymbolTable(int size);
   ~SymbolTable();
@@ -148,8 +149,8 @@ public:
   void        clear();
   void        stats();
 
-  void        openTmpMode();
-  void        closeTmpMode();
+  void        openTmpMode();  // may be nested, closeTmpMode removes
+  void        closeTmpMode(); // the identifiers of the innermost scope
 
   unsigned  noIdents;       // total number of identifiers
   int       noSS;           // number of state spaces
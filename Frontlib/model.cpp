@@ -2,6 +2,7 @@
 
 #include "codetable.h"
 #include "offsets.h"
+#include "st_dfa.h"
 #include "symboltable.h"
 
 extern "C" {
@@ -48,12 +49,26 @@ Model buildModelFromExample(char *example, int numVars, char **names, char *type
     return model;
 }
 
-std::optional<Model> getModel(const MonaAST &ast) {
+// the code table and the temporary symbols of one query, also released
+// when the query is abandoned for lack of memory
+struct QueryScope {
+    QueryScope() {
 #ifdef TMP_MODE_OPTIMIZATION
-    symbolTable.openTmpMode();
+        symbolTable.openTmpMode();
 #endif
+        codeTable = new CodeTable;
+    }
+    ~QueryScope() {
+        delete codeTable;
+        codeTable = nullptr;
+#ifdef TMP_MODE_OPTIMIZATION
+        symbolTable.closeTmpMode();
+#endif
+    }
+};
 
-    codeTable = new CodeTable;
+std::optional<Model> getModel(const MonaAST &ast) {
+    QueryScope scope;
     VarCode formulaCode = ast.formula->makeCode();
     DFA *dfa = formulaCode.DFATranslate();
     formulaCode.remove();
@@ -122,11 +137,81 @@ std::optional<Model> getModel(const MonaAST &ast) {
     delete[] types;
     delete[] univs;
     delete[] trees;
-    delete codeTable;
 
-#ifdef TMP_MODE_OPTIMIZATION
-    symbolTable.closeTmpMode();
-#endif
+    return model;
+}
+
+ModelEnumerator::ModelEnumerator(const MonaAST &ast, IdentList *projection) {
+    QueryScope scope;
+
+    // the globals are restricted as in mona, so that a first-order
+    // variable is assigned one position only
+    VarCode formulaCode = ast.formula->makeCode();
+    VarCode restrictions = codeTable->insert(new Code_True(dummyPos));
+    for (Ident id : ast.globals)
+        restrictions = andList(restrictions, getRestriction(id, nullptr));
+    if (restrictions.code->kind != cTrue)
+        restrictions = codeTable->insert(
+            new Code_Restrict(restrictions, restrictions.code->pos));
+    formulaCode = andList(formulaCode, restrictions);
+    DFA *dfa = formulaCode.DFATranslate();
+    formulaCode.remove();
 
+    // the globals left out are projected away together
+    IdentList hidden;
+    for (Ident id : ast.globals)
+        if (projection && !projection->exists(id))
+            hidden.push_back(id);
+    if (hidden.size())
+        dfa = st_dfa_minimization(st_dfa_project(dfa, &hidden, dummyPos));
+
+    std::vector<unsigned> offs;
+    for (Ident id : ast.globals) {
+        if (projection && !projection->exists(id))
+            continue;
+        names.push_back(symbolTable.lookupSymbol(id));
+        offs.push_back(offsets.off(id));
+        switch (symbolTable.lookupType(id)) {
+            case Varname0:
+                types.push_back(0);
+            break;
+            case Varname1:
+                types.push_back(1);
+            break;
+            default:
+                types.push_back(2);
+            break;
+        }
+    }
+
+    enumerator = dfaNewEnumerator(dfa, names.size(), offs.data(),
+                                  types.data());
+    dfaFree(dfa);
+}
+
+ModelEnumerator::~ModelEnumerator() {
+    dfaFreeEnumerator(enumerator);
+}
+
+std::optional<Model> ModelEnumerator::next() {
+    char *example = dfaNextExample(enumerator);
+    if (!example)
+        return {};
+    Model model = buildModelFromExample(example, names.size(), names.data(),
+                                        types.data());
+    mem_free(example);
     return model;
 }
+
+std::vector<Model> getModels(const MonaAST &ast, unsigned limit,
+                             IdentList *projection) {
+    ModelEnumerator models(ast, projection);
+    std::vector<Model> result;
+    while (result.size() < limit) {
+        std::optional<Model> model = models.next();
+        if (!model.has_value())
+            break;
+        result.push_back(*model);
+    }
+    return result;
+}
@@ -5,6 +5,7 @@
 #include <string>
 #include <map>
 #include <optional>
+#include <vector>
 
 #include "ast.h"
 
@@ -17,5 +18,30 @@ struct Model {
 
 std::optional<Model> getModel(const MonaAST &ast);
 
+/**
+ * The models of a formula, shortest first, read off a single automaton.
+ * With a projection only those of the global variables are assigned, the
+ * others are quantified away first, so each assignment comes once.
+ */
+class ModelEnumerator {
+public:
+    explicit ModelEnumerator(const MonaAST &ast,
+                             IdentList *projection = nullptr);
+    ~ModelEnumerator();
+    ModelEnumerator(const ModelEnumerator &) = delete;
+    ModelEnumerator &operator=(const ModelEnumerator &) = delete;
+
+    std::optional<Model> next();  // empty when there are no more
+
+private:
+    dfaEnumerator *enumerator;
+    std::vector<char *> names;
+    std::vector<char> types;
+};
+
+// at most limit models, shortest first
+std::vector<Model> getModels(const MonaAST &ast, unsigned limit,
+                             IdentList *projection = nullptr);
+
 
 #endif //MODEL_H
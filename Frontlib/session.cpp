@@ -0,0 +1,98 @@
+#include "session.h"
+
+#include <iostream>
+
+#include "autcache.h"
+#include "predlib.h"
+#include "symboltable.h"
+#include "utils.h"
+
+extern "C" {
+    #include "dfa.h"
+    #include "mem.h"
+}
+
+extern SymbolTable symbolTable;
+extern PredicateLib predicateLib;
+
+static bool sessionOpen = false;
+static mem_error_handler outerHandler;
+
+static void throwMemoryLimit() {
+    throw MemoryLimitExceeded();
+}
+
+// the kernels abandoned by the throw leave their state in the context
+template <typename F>
+static auto withinBudget(F query) -> decltype(query()) {
+    try {
+        return query();
+    } catch (const MemoryLimitExceeded &) {
+        dfaRecoverContext(dfaCurrentContext());
+        autCache.clearMemory();
+    }
+    try {
+        return query();
+    } catch (const MemoryLimitExceeded &) {
+        dfaRecoverContext(dfaCurrentContext());
+        throw;
+    }
+}
+
+Session::Session() {
+    invariant(!sessionOpen);
+    sessionOpen = true;
+    autCache.openMemory();
+    outerHandler = mem_set_error_handler(&throwMemoryLimit);
+}
+
+Session::~Session() {
+    while (!marks.empty())
+        pop();
+    autCache.closeMemory();
+    mem_set_error_handler(outerHandler);
+    mem_set_budget(0);
+    sessionOpen = false;
+}
+
+void Session::push() {
+    marks.push_back(symbolTable.noIdents);
+    symbolTable.openTmpMode();
+}
+
+void Session::pop() {
+    invariant(!marks.empty());
+    Ident first = marks.back();
+    marks.pop_back();
+
+    std::vector<Ident> preds;
+    for (PredLibEntry *e = predicateLib.first(); e; e = predicateLib.next())
+        if (e->name >= first)
+            preds.push_back(e->name);
+    for (Ident pred : preds)
+        predicateLib.remove(pred);
+
+    symbolTable.closeTmpMode();
+    forget(first);
+}
+
+std::optional<Model> Session::getModel(const MonaAST &ast) {
+    return withinBudget([&] { return ::getModel(ast); });
+}
+
+std::vector<Model> Session::getModels(const MonaAST &ast, unsigned limit,
+                                     IdentList *projection) {
+    return withinBudget([&] { return ::getModels(ast, limit, projection); });
+}
+
+void Session::setMemoryBudget(size_t bytes) {
+    mem_set_budget(bytes);
+}
+
+void Session::clearAutomata() {
+    autCache.clearMemory();
+}
+
+void Session::printStatistics() {
+    autCache.print_statistics();
+}
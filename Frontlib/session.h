@@ -0,0 +1,54 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <cstddef>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "model.h"
+
+// thrown by the queries of a session that run out of memory
+class MemoryLimitExceeded : public std::runtime_error {
+public:
+    MemoryLimitExceeded() : std::runtime_error("memory limit exceeded") {}
+};
+
+/**
+ * A session answers many related queries over the same symbol and predicate
+ * tables. The automata of subformulas and predicate calls are kept in memory
+ * (keyed by the digests of their code, see autcache.h), so a subformula
+ * shared by several queries is translated only once.
+ *
+ * Variables and predicates declared after `push` are removed by the matching
+ * `pop`; automata stay valid, since their keys do not depend on identifiers.
+ * Only one session may be open at a time.
+ *
+ * With a memory budget, a query that runs out of memory drops the kept
+ * automata and is tried once more; if that fails too, it throws
+ * MemoryLimitExceeded and the session stays usable.
+ */
+class Session {
+public:
+    Session();
+    ~Session();
+
+    void push();
+    void pop();
+    unsigned scopes() const { return marks.size(); }
+
+    std::optional<Model> getModel(const MonaAST &ast);
+    std::vector<Model> getModels(const MonaAST &ast, unsigned limit,
+                                 IdentList *projection = nullptr);
+
+    // bytes for BDD tables and caches and scratch arenas, 0 = no limit
+    void setMemoryBudget(size_t bytes);
+
+    void clearAutomata();  // free the automata kept so far
+    void printStatistics();
+
+private:
+    std::vector<Ident> marks;  // first identifier of each open scope
+};
+
+#endif //SESSION_H
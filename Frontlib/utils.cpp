@@ -27,6 +27,20 @@ void clear() {
     identsToStrings.clear();
 }
 
+/**
+ * Forgets the names of the identifiers from `first` on, after a scope of the
+ * symbol table that declared them has been closed. Those identifiers were
+ * the last ones added, so their strings are at the end of `strings`.
+ */
+void forget(Ident first) {
+    for (auto iter = identsToStrings.lower_bound(first);
+         iter != identsToStrings.end();
+         iter = identsToStrings.erase(iter)) {
+        stringsToIdents.erase(stringsToIdents.find(iter->second));
+        strings.pop_back();
+    }
+}
+
 Ident addVar(std::string_view name_str, MonaTypeTag tag) {
     if (const auto &iter = stringsToIdents.find(name_str);
         iter != stringsToIdents.end()) {
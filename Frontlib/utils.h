@@ -6,6 +6,7 @@
 #include "symboltable.h"
 
 void clear();
+void forget(Ident first);
 Ident addVar(std::string_view name_str, MonaTypeTag tag);
 Ident addPredicate(std::string_view name_str);
 void utils_stats();
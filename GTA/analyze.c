@@ -263,7 +263,7 @@ Tree *gtaMakeExample(GTA *gta, int status)
 	  for (p2 = 0; p2 < gta->ss[d2].size; p2++)
 	    if (sample_tree[d2][p2] != NULL) {
 	      bdd_handle behavior_handle = 
-		ss_ptr->behaviour[p_hat * ss_ptr->rs + p2];
+		BEH((*ss_ptr), p_hat, p2);
 	      State *new_states;
 	      unsigned new_states_size;
 	    
@@ -309,7 +309,7 @@ Tree *gtaMakeExample(GTA *gta, int status)
 	  for (p1 = 0; p1 < gta->ss[d1].size; p1++) 
 	    if (sample_tree[d1][p1] != NULL) {
 	      bdd_handle behavior_handle = 
-		ss_ptr->behaviour[p1 * ss_ptr->rs + p_hat]; 
+		BEH((*ss_ptr), p1, p_hat);
 	      State *new_states;
 	      unsigned new_states_size;
 	  
@@ -22,9 +22,30 @@
 #include "../Mem/mem.h"
 #include "gta.h"
 
+/* copy the BDDs of state space i of P into a new manager for ss,
+   whose behaviour matrix may be the one of P */
+static void copyBdds(GTA *P, SsId i, StateSpace *ss)
+{
+  unsigned p1, p2;
+  StateSpace from = P->ss[i];
+
+  ss->bddm = bdd_new_manager(from.size*8, ((from.size+3)/4)*4);
+    
+  bdd_prepare_apply1(from.bddm);
+  for (p1 = 0; p1 < P->ss[guide.muLeft[i]].size; p1++) {
+    for (p2 = 0; p2 < P->ss[guide.muRight[i]].size; p2++) {
+      bdd_apply1(from.bddm, 
+		 BDD_ROOT(from.bddm, BEH(from, p1, p2)), 
+		 ss->bddm, 
+		 &fn_identity);
+      BEH((*ss), p1, p2) = BDD_LAST_HANDLE(ss->bddm);
+    }
+  }
+}
+
 GTA *gtaCopy(GTA *P) 
 {
-  unsigned i, p1, p2;
+  unsigned i;
   GTA *res = gtaMake();
   res->final = (int *) mem_alloc(sizeof(int)*P->ss[0].size);
 
@@ -38,22 +59,45 @@ GTA *gtaCopy(GTA *P)
 
     ss->initial = P->ss[i].initial;
     ss->size = P->ss[i].size;
-    ss->ls = P->ss[i].ls;
-    ss->rs = P->ss[i].rs;
-    ss->behaviour = (bdd_handle *) mem_alloc(sizeof(bdd_handle)*ss->ls*ss->rs);
-    ss->bddm = bdd_new_manager(ss->size*8, ((ss->size+3)/4)*4);
-    
-    bdd_prepare_apply1(P->ss[i].bddm);
-    for (p1 = 0; p1 < P->ss[guide.muLeft[i]].size; p1++) {
-      for (p2 = 0; p2 < P->ss[guide.muRight[i]].size; p2++) {
-	bdd_apply1(P->ss[i].bddm, 
-		   BDD_ROOT(P->ss[i].bddm, BEH(P->ss[i], p1, p2)), 
-		   ss->bddm, 
-		   &fn_identity);
-	BEH((*ss), p1, p2) = BDD_LAST_HANDLE(ss->bddm);
-      }
-    }
+    gtaAllocBehaviour(ss, P->ss[i].ls, P->ss[i].rs);
+    copyBdds(P, i, ss);
   }
   
   return res;
 }
+
+GTA *gtaShare(GTA *P) 
+{
+  unsigned i, p1;
+  GTA *res = gtaMake();
+  res->final = (int *) mem_alloc(sizeof(int)*P->ss[0].size);
+
+  mem_copy(res->final, P->final, sizeof(int)*P->ss[0].size);
+
+  /* the behaviour matrices hold handles, which are valid in the
+     shared managers */
+  for (i = 0; i < guide.numSs; i++) {
+    StateSpace *ss = &res->ss[i];
+
+    ss->initial = P->ss[i].initial;
+    ss->size = P->ss[i].size;
+    gtaAllocBehaviour(ss, P->ss[i].ls, P->ss[i].rs);
+    for (p1 = 0; p1 < ss->ls; p1++)
+      mem_copy(ss->behaviour[p1], P->ss[i].behaviour[p1], 
+	       sizeof(bdd_handle)*ss->rs);
+    ss->bddm = bdd_share_manager(P->ss[i].bddm);
+  }
+
+  return res;
+}
+
+void gtaUnshare(GTA *P, SsId d)
+{
+  if (bdd_manager_shared(P->ss[d].bddm) || 
+      bdd_manager_renamed(P->ss[d].bddm)) {
+    bdd_manager *bddm = P->ss[d].bddm;
+
+    copyBdds(P, d, &P->ss[d]);
+    bdd_kill_manager(bddm);
+  }
+}
@@ -52,14 +52,16 @@ void paInsert(PairArray *q, State i, State j)
 
 void initBM(BehaviourMatrix *b) 
 { 
-  b->m = (bdd_handle *) mem_alloc(sizeof(bdd_handle)); 
-  b->lf = b->rf = 0; 
-  b->ls = b->rs = b->lu = b->ru = 1; 
+  initBMtoSize(b, 1, 1);
 }
 
 void initBMtoSize(BehaviourMatrix *b, unsigned l, unsigned r) 
 { 
-  b->m = (bdd_handle *) mem_alloc(sizeof(bdd_handle)*l*r); 
+  unsigned i;
+
+  b->m = (bdd_handle **) mem_alloc(sizeof(bdd_handle *)*l); 
+  for (i = 0; i < l; i++)
+    b->m[i] = (bdd_handle *) mem_alloc(sizeof(bdd_handle)*r);
   b->lf = b->rf = 0; 
   b->ls = b->lu = l; 
   b->rs = b->ru = r; 
@@ -68,35 +70,50 @@ void initBMtoSize(BehaviourMatrix *b, unsigned l, unsigned r)
 void extendLeftBM(BehaviourMatrix *b) 
 { 
   if (b->lu >= b->ls) { 
-    unsigned l, r; 
-    bdd_handle *t = 
-      (bdd_handle *) mem_alloc(sizeof(bdd_handle)*(b->ls*2+1)*b->rs); 
-    for (l = 0; l < b->lu; l++) 
-      for (r = 0; r < b->ru; r++)
-        t[l*b->rs+r] = b->m[l*b->rs+r]; 
-    mem_free(b->m); 
-    b->m = t; 
     b->ls = b->ls*2+1; 
+    b->m = (bdd_handle **) mem_resize(b->m, sizeof(bdd_handle *)*b->ls);
   } 
+  b->m[b->lu] = (bdd_handle *) mem_alloc(sizeof(bdd_handle)*b->rs);
   b->lu += 1; 
 }
 
 void extendRightBM(BehaviourMatrix *b) 
 {
   if (b->ru >= b->rs) { 
-    unsigned l, r; 
-    bdd_handle *t = 
-      (bdd_handle *) mem_alloc(sizeof(bdd_handle)*b->ls*(b->rs*2+1)); 
-    for (l = 0; l < b->lu; l++) 
-      for (r = 0; r < b->ru; r++) 
-        t[l*(b->rs*2+1)+r] = b->m[l*b->rs+r]; 
-    mem_free(b->m); 
-    b->m = t; 
+    unsigned l; 
     b->rs = b->rs*2+1; 
+    for (l = 0; l < b->lu; l++) 
+      b->m[l] = (bdd_handle *) mem_resize(b->m[l], sizeof(bdd_handle)*b->rs);
   } 
   b->ru += 1; 
 }
 
+/* hand the filled matrix over to a state space, trimmed to the used
+   size; small matrices are copied into one block (gtaAllocBehaviour) */
+void moveBM(BehaviourMatrix *b, StateSpace *ss)
+{
+  unsigned l;
+
+  invariant(b->lf == b->lu && b->rf == b->ru);
+  if (b->lu*b->ru <= BM_DENSE_LIMIT) {
+    gtaAllocBehaviour(ss, b->lu, b->ru);
+    for (l = 0; l < b->lu; l++) {
+      mem_copy(ss->behaviour[l], b->m[l], sizeof(bdd_handle)*b->ru);
+      mem_free(b->m[l]);
+    }
+    mem_free(b->m);
+  }
+  else {
+    for (l = 0; l < b->lu; l++)
+      b->m[l] = (bdd_handle *) mem_resize(b->m[l], sizeof(bdd_handle)*b->ru);
+    ss->behaviour = (bdd_handle **) 
+      mem_resize(b->m, sizeof(bdd_handle *)*b->lu);
+    ss->ls = b->lu;
+    ss->rs = b->ru;
+  }
+  b->m = 0;
+}
+
 #ifndef NDEBUG
 void dumpBM(BehaviourMatrix *bbb, bdd_manager *bddm)
 {
@@ -104,7 +121,7 @@ void dumpBM(BehaviourMatrix *bbb, bdd_manager *bddm)
   printf("\nBEHAVIOUR:");
   for (i = 0; i < bbb->lf; i++) {
     for (j = 0; j < bbb->rf; j++)
-      printf("%u ", BDD_ROOT(bddm, bbb->m[i*bbb->rs+j]));
+      printf("%u ", BDD_ROOT(bddm, bbb->m[i][j]));
     printf("\n");
   }
   bddDump(bddm);
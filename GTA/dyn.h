@@ -39,21 +39,26 @@ void paInit(PairArray *q);
 void paFree(PairArray *q); 
 void paInsert(PairArray *q, State i, State j); 
 
-/* Dynamic matrix containing bdd_handles */
+/* Dynamic matrix containing bdd_handles, kept as separately allocated
+   rows so that growing it never copies the whole matrix */
 
 typedef struct {
-  bdd_handle *m;
-  unsigned ls, rs; /* allocated size */
+  bdd_handle **m;
+  unsigned ls, rs; /* allocated size (row pointers, row length) */
   unsigned lu, ru; /* used size */
   unsigned lf, rf; /* filled size */
 } BehaviourMatrix;
 
-#define BM(b, i, j) b.m[(i)*b.rs+(j)]
+#define BM(b, i, j) b.m[i][j]
+
+/* matrices with at most this many entries are moved into a single block */
+#define BM_DENSE_LIMIT 4096
 
 void initBM(BehaviourMatrix *b); 
 void initBMtoSize(BehaviourMatrix *b, unsigned l, unsigned r);
 void extendLeftBM(BehaviourMatrix *b);
 void extendRightBM(BehaviourMatrix *b); 
+void moveBM(BehaviourMatrix *b, StateSpace *ss);
 
 #ifndef NDEBUG
 void dumpBM(BehaviourMatrix *bbb, bdd_manager *bddm);
@@ -26,8 +26,8 @@
 #include "../BDD/bdd_external.h"
 #include "../Mem/mem.h"
 
-extern BddNode *table;
-extern bdd_manager *import_bddm;
+extern GNUC_THREAD BddNode *table;
+extern GNUC_THREAD bdd_manager *import_bddm;
 
 int gtaExport(GTA *G, char *filename, int num, char *vars[], 
 	      char orders[], SSSet *statespaces, int opt_inhacc)
@@ -183,6 +183,7 @@ GTA *gtaImport(char *filename, char ***vars, int **orders,
     return 0;
 
   G = (GTA *) mem_alloc(sizeof(GTA));
+  G->refs = 1;
   gta_in_mem++;
   if (fscanf(file,
 	     "MONA GTA\n"
@@ -343,9 +344,7 @@ GTA *gtaImport(char *filename, char ***vars, int **orders,
       if (fscanf(file, "behaviour:\n") != 0)
 	return 0;
     }
-    G->ss[i].behaviour = (bdd_ptr *) mem_alloc(sizeof(bdd_ptr)*ri*le);
-    G->ss[i].ls = le;
-    G->ss[i].rs = ri;
+    gtaAllocBehaviour(&G->ss[i], le, ri);
     for (l = 0; l < le; l++) 
       for (r = 0; r < ri; r++) {
 	if (fscanf(file, "%u ", &BEH(G->ss[i], l, r)) != 1)
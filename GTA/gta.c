@@ -287,6 +287,7 @@ GTA *gtaMake()
   GTA *res = (GTA *) mem_alloc(sizeof(GTA));
   res->final = 0; /* nothing allocated */
   res->ss = (StateSpace *) mem_alloc(sizeof(StateSpace)*guide.numSs);
+  res->refs = 1;
 
   for (s = 0; s < guide.numSs; s++) {
     StateSpace *ss = &res->ss[s];
@@ -302,13 +303,64 @@ GTA *gtaMake()
   return res;
 }
 
+/* a behaviour matrix is an array of row pointers; when the size is
+   known in advance the rows are placed in the same block right after
+   the pointers, while the extendable matrices of dyn.c hand over
+   separately allocated rows (see moveBM) */
+void gtaAllocBehaviour(StateSpace *ss, unsigned ls, unsigned rs)
+{
+  unsigned i;
+  bdd_handle *rows;
+
+  ss->ls = ls;
+  ss->rs = rs;
+  ss->behaviour = (bdd_handle **) 
+    mem_alloc(sizeof(bdd_handle *)*ls + sizeof(bdd_handle)*ls*rs);
+  rows = (bdd_handle *) (ss->behaviour + ls);
+  for (i = 0; i < ls; i++)
+    ss->behaviour[i] = rows + i*rs;
+}
+
+void gtaFreeBehaviour(StateSpace *ss)
+{
+  unsigned i;
+
+  if (!ss->behaviour)
+    return;
+  if (ss->ls > 0 && ss->behaviour[0] != (bdd_handle *) (ss->behaviour + ss->ls))
+    for (i = 0; i < ss->ls; i++)
+      mem_free(ss->behaviour[i]);
+  mem_free(ss->behaviour);
+  ss->behaviour = 0;
+}
+
+GTA *gtaRef(GTA *P)
+{
+  P->refs++;
+  return P;
+}
+
+/* only an automaton with one owner may be changed */
+GTA *gtaWritable(GTA *P)
+{
+  if (P->refs > 1) {
+    GTA *res = gtaShare(P);
+    gtaFree(P);
+    return res;
+  }
+  return P;
+}
+
 void gtaFree(GTA* P)
 {
   SsId i;
 
+  if (--P->refs > 0)
+    return;
+
   mem_free(P->final);
   for (i = 0; i < guide.numSs; i++) {
-    mem_free(P->ss[i].behaviour);
+    gtaFreeBehaviour(&P->ss[i]);
     bdd_kill_manager(P->ss[i].bddm);
   }
   mem_free(P->ss);
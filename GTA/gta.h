@@ -63,14 +63,16 @@ extern Guide guide; /* common global guide is declared in the front end */
 typedef struct {
   State initial;         /* initial state */
   unsigned size;         /* number of states */
-  unsigned ls, rs;       /* dimensions of behaviour matrix incl. unused */
-  bdd_handle *behaviour; /* behaviour[i*rs+j]: BDD ptr for state pair (i,j) */
+  unsigned ls, rs;       /* dimensions of behaviour matrix */
+  bdd_handle **behaviour; /* behaviour[i][j]: BDD ptr for state pair (i,j),
+			     one row per left state, see gtaAllocBehaviour */
   bdd_manager *bddm;     /* BDD manager */
 } StateSpace;
 
 typedef struct {
   int *final;     /* final-status vector, -1:reject, 0:don't care, +1:accept */
   StateSpace *ss; /* array of state spaces */
+  int refs;       /* number of owners, see gtaRef */
 } GTA;
 
 /* misc. */
@@ -85,7 +87,7 @@ typedef enum {
 typedef char *SSSet; /* set of state-spaces, bitvector of size guide.numSs */
 
 /* macro for indexing into behaviour matrix */
-#define BEH(ss, i, j) ss.behaviour[(i)*ss.rs+(j)]
+#define BEH(ss, i, j) ss.behaviour[i][j]
 
 /* tree for examples and counter-examples */
 typedef struct Tree {
@@ -133,6 +135,10 @@ int checkDisjoint(); /* check each s.s. associated to max one universe */
 int checkAllUsed(); /* check all state spaces used */
 GTA *gtaMake();
 void gtaFree(GTA* a);
+GTA *gtaRef(GTA *a); /* add an owner, each owner calls gtaFree */
+GTA *gtaWritable(GTA *a); /* a, or a copy if a has other owners */
+void gtaAllocBehaviour(StateSpace *ss, unsigned ls, unsigned rs);
+void gtaFreeBehaviour(StateSpace *ss);
 
 /* external.c */
 int gtaExport(GTA *a, char *filename, int num, char *names[], 
@@ -170,6 +176,9 @@ void gtaReplaceIndices(GTA *a, unsigned map[]);
 
 /* copy.c */
 GTA *gtaCopy(GTA *a); 
+GTA *gtaShare(GTA *a); /* copy sharing the BDD managers of a, see bdd.h */
+void gtaUnshare(GTA *a, SsId d); /* give state space d of a its own,
+				  unrenamed BDD manager */
 
 /* negation.c */
 void gtaNegation(GTA *a);
@@ -179,6 +188,9 @@ GTA *gtaProduct(GTA *a1, GTA *a2, gtaProductType mode);
 
 /* project.c */
 GTA *gtaQuotientAndProject(GTA *a, unsigned index, int quotient);
+/* all of n >= 1 variables projected away in one subset construction */
+GTA *gtaQuotientAndProjectList(GTA *a, unsigned n, unsigned index[], 
+			       int quotient);
 
 /* minimize.c */
 GTA *gtaMinimize(GTA *a);
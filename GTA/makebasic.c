@@ -141,11 +141,7 @@ void gtaSetupDelta(SsId d, unsigned lsize, unsigned rsize,
   gta->ss[guide.muRight[s]].size = rsize;
 
   /* prepare behaviour matrix and BDD manager */
-  gta->ss[s].ls = lsize;
-  gta->ss[s].rs = rsize;
-  gta->ss[s].behaviour = (bdd_handle *) mem_alloc(sizeof(bdd_handle)*
-						  gta->ss[s].ls*
-						  gta->ss[s].rs);
+  gtaAllocBehaviour(&gta->ss[s], lsize, rsize);
   gta->ss[s].bddm = bdd_new_manager(8, 4);
 
   /* sort offsets */
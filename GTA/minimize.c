@@ -20,6 +20,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "../Mem/mem.h"
 #include "gta.h"
 
@@ -55,111 +56,82 @@ static enum Candidate {
                    if s has been refined at
 		   least once (s could still have just one block) */
 
-/* sorting */
-
-static bdd_ptr **sorted; /* invariant: sorted[i][j] == qm[original[i]*maxSize + j]
-			    in fact, sorted[i] == &qm[original[i]*maxSize] */
-static unsigned *original; /* original[i] = the original number of a row
-			      in sorted order */
-static bdd_ptr *qm; /* matrix to be sorted, for storage allocation
-		       purposes, row length is assume to be maxSize; actual
-		       rowlength is given by qcols; also maxSize rows are
-		       allocated */
-static unsigned qcols, maxSize; /* used and allocated number of columns
-				   in matrix qm */
-static unsigned *qb; /* qb[i] = block[s][original[i]] */
-
-int compare(unsigned i, unsigned j)
-{
-  int n;
-
-  /* we compare block numbers first, so that all rows in new ordering
-     that are in the same old block are consecutive */
-  if (qb[i] > qb[j])
-    return 1;
-  else if (qb[i] < qb[j])
-    return -1;
- 
- /* compare wrt. matrix rows and previous block assignments */
-  for (n = 0; n < qcols; n++)
-    if (sorted[i][n] > sorted[j][n])
-      return 1;
-    else if (sorted[i][n] < sorted[j][n])
-      return -1;
+/* refinement */
 
-  /* i and j belong to the same old block and they have the same behavior
-     across the row */
-  return 0;
-}
+static bdd_ptr *qm; /* matrix being refined, row length is qcols */
+static unsigned qcols, maxSize; /* number of columns in matrix qm and
+				   largest state space */
+static unsigned *qb; /* qb[i] = block[s][i] before the refinement */
+static unsigned *table; /* open addressing table of class numbers + 1,
+			   0 for empty */
+static unsigned tableSize; /* allocated size of table, a power of two */
+static unsigned *cls; /* cls[i] = the class of row i */
+static unsigned *reps; /* reps[c] = the first row of class c */
+static unsigned *rank; /* rank[c] = the new block number of class c */
 
-void swap(unsigned i, unsigned j)
+static unsigned hashRow(unsigned i)
 {
-  bdd_ptr *tp;
-  unsigned tb, to;
-
-  /* swap 'block' and 'original' along with 'sorted' */
-  tp = sorted[i];
-  to = original[i];
-  tb = qb[i];
-  sorted[i] = sorted[j];
-  original[i] = original[j];
-  qb[i] = qb[j];
-  sorted[j] = tp;
-  original[j] = to;
-  qb[j] = tb;
+  bdd_ptr *row = &qm[i*qcols];
+  unsigned h = qb[i]*0x9e3779b1u, n;
+
+  for (n = 0; n < qcols; n++)
+    h = (h ^ row[n])*0x01000193u;
+  return h ^ (h >> 16);
 }
 
-void quicksort(int from, int to) /*** IMPROVE SORTING?!?!? ***/
-     /* yes, cryptic */
+static int compareRows(const void *a, const void *b)
 {
-  if (from < to) {
-    int i = from, j = to, v = to;
-    do {
-      while (i < to && compare(i, v) < 0)
-	i++;
-      while (j > from && compare(j, v) > 0)
-	j--;
-      if (i <= j) {
-	swap(i, j);
-	if (v == i)
-	  v = j;
-	else if (v == j)
-	  v = i;
-	i++;
-	j--;
-      }
-    } while (i <= j);
-    quicksort(from, j);
-    quicksort(i, to);
-  }
+  unsigned i = *(const unsigned *) a, j = *(const unsigned *) b, n;
+  bdd_ptr *ri = &qm[i*qcols], *rj = &qm[j*qcols];
+
+  /* we compare block numbers first, so that all rows in the same old
+     block get consecutive new numbers */
+  if (qb[i] != qb[j])
+    return (qb[i] > qb[j]) ? 1 : -1;
+  for (n = 0; n < qcols; n++)
+    if (ri[n] != rj[n])
+      return (ri[n] > rj[n]) ? 1 : -1;
+  return 0;
 }
 
-void sort(bdd_ptr *m, unsigned *b,
-	  unsigned rows, unsigned cols)
+/* split the blocks b of the states 0..rows-1 by the rows of m: states
+   with the same old block and the same row are found by hashing, and
+   only one representative of each class is sorted, so the new block
+   numbers are those that sorting all the rows would give; returns the
+   number of blocks */
+static unsigned refine(bdd_ptr *m, unsigned *b, unsigned rows, unsigned cols)
 {
-  int i;
-  qm = m; 
+  unsigned i, c, h, mask, numClasses = 0;
+
+  qm = m;
   qcols = cols;
+  qb = b;
+  for (mask = 1; mask < 2*rows; mask <<= 1);
+  invariant(mask <= tableSize);
+  mask--;
+  mem_zero(table, sizeof(unsigned)*(mask+1));
 
-  /* initialize unsorted */
   for (i = 0; i < rows; i++) {
-    sorted[i] = &m[i*maxSize];
-    original[i] = i;
-    qb[i] = b[i];
+    for (h = hashRow(i) & mask; table[h]; h = (h+1) & mask) {
+      c = table[h]-1;
+      if (b[reps[c]] == b[i] &&
+	  memcmp(&m[reps[c]*cols], &m[i*cols], sizeof(bdd_ptr)*cols) == 0)
+	break;
+    }
+    if (!table[h]) {
+      c = numClasses++;
+      reps[c] = i;
+      table[h] = c+1;
+    }
+    cls[i] = c;
   }
 
-  /* sort rows in m */
-  quicksort(0, rows-1);
-
-  /************
-    printf("SORT\n");
-    for (i = 0; i < rows; i++) {
-      for (j = 0; j < cols; j++)
-        printf("%-3u ", sorted[i][j]);
-      printf("   %-3u\n", b[i]);
-    }
-    printf("SORTDONE\n");
-  *********/
+  qsort(reps, numClasses, sizeof(unsigned), compareRows);
+  for (c = 0; c < numClasses; c++)
+    rank[cls[reps[c]]] = c;
+  for (i = 0; i < rows; i++)
+    b[i] = rank[cls[i]];
+  return numClasses;
 }
 
 /* leaf function */
@@ -175,7 +147,7 @@ GTA *gtaMinimize(GTA *g)
 {
   int done;
   State i, j;
-  unsigned p;
+  unsigned p, maxMatrix;
 
   /* initialize */
   orig = g;
@@ -229,11 +201,22 @@ GTA *gtaMinimize(GTA *g)
 
   /*....optimize case when numBlocks[0]==1...*/
 
-  sorted = (bdd_ptr **) mem_alloc(sizeof(bdd_ptr*)*maxSize);
-  matrix = (bdd_ptr *) mem_alloc(sizeof(bdd_ptr)*maxSize*maxSize);
-  transposed = (bdd_ptr *) mem_alloc(sizeof(bdd_ptr)*maxSize*maxSize);
-  original = (unsigned *) mem_alloc(sizeof(unsigned)*maxSize);
-  qb = (unsigned *) mem_alloc(sizeof(unsigned)*maxSize);
+  /* the matrices are sized for the largest pair of successor spaces,
+     not for the square of the largest space */
+  maxMatrix = 1;
+  for (s = 0; s < guide.numSs; s++) {
+    unsigned n = orig->ss[guide.muLeft[s]].size*orig->ss[guide.muRight[s]].size;
+    if (n > maxMatrix)
+      maxMatrix = n;
+  }
+
+  matrix = (bdd_ptr *) mem_alloc(sizeof(bdd_ptr)*maxMatrix);
+  transposed = (bdd_ptr *) mem_alloc(sizeof(bdd_ptr)*maxMatrix);
+  for (tableSize = 1; tableSize < 2*maxSize; tableSize <<= 1);
+  table = (unsigned *) mem_alloc(sizeof(unsigned)*tableSize);
+  cls = (unsigned *) mem_alloc(sizeof(unsigned)*maxSize);
+  reps = (unsigned *) mem_alloc(sizeof(unsigned)*maxSize);
+  rank = (unsigned *) mem_alloc(sizeof(unsigned)*maxSize);
 
   /* refine partitions until fixed point reached */
   do {
@@ -255,24 +238,16 @@ GTA *gtaMinimize(GTA *g)
 
 	for (i = 0; i < orig->ss[lSs].size; i++)
 	  for (j = 0; j < orig->ss[rSs].size; j++)
-	    matrix[i*maxSize + j] = transposed[j*maxSize + i] = 
+	    matrix[i*orig->ss[rSs].size + j] = 
+	      transposed[j*orig->ss[lSs].size + i] = 
 	      bdd_apply1(orig->ss[s].bddm, 
 			 BDD_ROOT(orig->ss[s].bddm,BEH(orig->ss[s], i, j)),
 			 res->ss[s].bddm,
 			 fn_block);
 	      
 	/* refine left state space */
-	sort(matrix, block[lSs], 
-	     orig->ss[lSs].size, orig->ss[rSs].size);
-	p = 0;
-	for (i = 0; i < orig->ss[lSs].size - 1; i++) {
-	  invariant(compare(i, i+1) <= 0);
-	  if (compare(i, i+1) != 0)
-	    block[lSs][original[i]] = p++;
-	  else
-	    block[lSs][original[i]] = p;
-	}
-	block[lSs][original[i]] = p++;
+	p = refine(matrix, block[lSs], 
+		   orig->ss[lSs].size, orig->ss[rSs].size);
 	invariant(p >= numBlocks[lSs]);
 	if (p > numBlocks[lSs]) {
 	  candidate[lSs] = cYES;
@@ -281,17 +256,8 @@ GTA *gtaMinimize(GTA *g)
 	}
 	
 	/* refine right state space */
-	sort(transposed, block[rSs],
-	     orig->ss[rSs].size, orig->ss[lSs].size);
-	p = 0;
-	for (i = 0; i < orig->ss[rSs].size - 1; i++) {
-	  invariant(compare(i, i+1) <= 0);
-	  if (compare(i, i+1) != 0)
-	    block[rSs][original[i]] = p++;
-	  else
-	    block[rSs][original[i]] = p;
-	}
-	block[rSs][original[i]] = p++;
+	p = refine(transposed, block[rSs],
+		   orig->ss[rSs].size, orig->ss[lSs].size);
 	invariant(p >= numBlocks[rSs]);
 	if (p > numBlocks[rSs]) {
 	  candidate[rSs] = cYES;
@@ -315,8 +281,7 @@ GTA *gtaMinimize(GTA *g)
     else
       res->ss[s].rs = numBlocks[rSs];
     
-    res->ss[s].behaviour = 
-      (bdd_handle *) mem_alloc(sizeof(bdd_handle)*res->ss[s].ls*res->ss[s].rs);
+    gtaAllocBehaviour(&res->ss[s], res->ss[s].ls, res->ss[s].rs);
     
     if (candidate[s] == cNEVER) {
 
@@ -367,9 +332,10 @@ GTA *gtaMinimize(GTA *g)
   mem_free(transposed);
   mem_free(numBlocks);
   mem_free(candidate);
-  mem_free(sorted);
-  mem_free(original);
-  mem_free(qb);
+  mem_free(table);
+  mem_free(cls);
+  mem_free(reps);
+  mem_free(rank);
   mem_free(matrix);
 
   return res;
@@ -18,10 +18,12 @@
  * USA.
  */
 
+#include <stdlib.h>
 #include "gta.h"
 
 void gtaNegation(GTA *g) {
   unsigned i;
+  invariant(g->refs == 1);
   for (i = 0; i < g->ss[0].size; i++)
     g->final[i] = -(g->final[i]);
 }
@@ -20,14 +20,10 @@
 
 /* hash tables for mapping from state pairs to new states */
 
-typedef struct PairHashTableEntry {
-  unsigned p, q, n;
-  struct PairHashTableEntry *overflow;
-} PairHashTableEntry;
+#include "../BDD/hash.h"
 
 typedef struct {
-  PairHashTableEntry *t;
-  unsigned size, overflows, prime;
+  pair_map m;  /* (p, q) -> n+1 */
 } PairHashTable;
 
 void initPHT(PairHashTable *t, unsigned prime);
@@ -145,9 +145,7 @@ GTA *gtaProduct(GTA *a1, GTA *a2, gtaProductType type)
     StateSpace *ss = &res->ss[s];
     ss->initial = 0; 
     ss->size = paSize(pairs[s]);
-    ss->ls = b[s].ls;
-    ss->rs = b[s].rs;
-    ss->behaviour = b[s].m;
+    moveBM(&b[s], ss);
   }  
 
   /* set up final-status vector */
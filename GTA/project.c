@@ -39,40 +39,37 @@ static unsigned finalAllocated; /* allocated size of 'final' */
 
 /* quotient auxiliary functions */
 
-State read0X0(bdd_manager *bddm, bdd_ptr p, unsigned idx, unsigned choice) {
-  if (bdd_is_leaf(bddm, p)) 
-    return bdd_leaf_value(bddm, p);
-  else 
-    if (bdd_ifindex(bddm, p) == idx) {
-      if (choice)
-        return read0X0(bddm, bdd_then(bddm, p), idx, choice);
-      else
-        return read0X0(bddm, bdd_else(bddm, p), idx, choice);
-    }
-    else
-      return read0X0(bddm, bdd_else(bddm, p), idx, choice);
-}
+static unsigned numIdx, *idxs; /* the variables projected away */
 
-void zeroPathStates(SsId d, State i, State j, unsigned idx)
-{
-  State z0, z1;
-  bdd_ptr pp = BDD_ROOT(orig->ss[d].bddm,
-			orig->ss[d].behaviour[i*orig->ss[d].rs + j]);
+/* insert the states reached from p along letters that are 0 except on
+   the variables */
+void read0X0(SsId d, bdd_manager *bddm, bdd_ptr p) {
+  if (bdd_is_leaf(bddm, p)) {
+    State z = bdd_leaf_value(bddm, p);
 
-  z0 = read0X0(orig->ss[d].bddm, pp, idx, 0);
-  z1 = read0X0(orig->ss[d].bddm, pp, idx, 1);
-  
-  if (!setExists(&initial[d], z0)) {
-    setInsert(&unproc[d], z0);
-    setInsert(&initial[d], z0);
+    if (!setExists(&initial[d], z)) {
+      setInsert(&unproc[d], z);
+      setInsert(&initial[d], z);
+    }
   }
-  if (z0 != z1 && 
-      !setExists(&initial[d], z1)) {
-    setInsert(&unproc[d], z1);
-    setInsert(&initial[d], z1);
+  else {
+    unsigned k;
+
+    read0X0(d, bddm, bdd_else(bddm, p));
+    for (k = 0; k < numIdx; k++)
+      if (bdd_ifindex(bddm, p) == idxs[k]) {
+	read0X0(d, bddm, bdd_then(bddm, p));
+	break;
+      }
   }
 }
 
+void zeroPathStates(SsId d, State i, State j)
+{
+  read0X0(d, orig->ss[d].bddm, 
+	  BDD_ROOT(orig->ss[d].bddm, BEH(orig->ss[d], i, j)));
+}
+
 /* project auxiliary functions */
 
 unsigned fn_union(unsigned v1, unsigned v2)
@@ -152,10 +149,19 @@ void makeProjectBehaviour(State i, State j)
 
 GTA *gtaQuotientAndProject(GTA *g, unsigned idx, int quotient)
 {
-  unsigned i, j;
+  return gtaQuotientAndProjectList(g, 1, &idx, quotient);
+}
+
+GTA *gtaQuotientAndProjectList(GTA *g, unsigned n, unsigned idx[], 
+			       int quotient)
+{
+  unsigned i, j, k;
   int done;
 
+  invariant(n > 0);
   orig = g;
+  numIdx = n;
+  idxs = idx;
   res = gtaMake();
 
   /* QUOTIENT */
@@ -191,7 +197,7 @@ GTA *gtaQuotientAndProject(GTA *g, unsigned idx, int quotient)
 	      State q2 = setRead(&initial[d2], j);
 	      
 	      /* find zero path states and extend sets */
-	      zeroPathStates(d, q_hat, q2, idx);
+	      zeroPathStates(d, q_hat, q2);
 	    }
 	  }
 	  
@@ -205,7 +211,7 @@ GTA *gtaQuotientAndProject(GTA *g, unsigned idx, int quotient)
 	      State q1 = setRead(&initial[d1], j);
 	      
 	      /* find zero path states and extend sets */
-	      zeroPathStates(d, q1, q_hat, idx);
+	      zeroPathStates(d, q1, q_hat);
 	    }
 	  }
 	}
@@ -234,18 +240,34 @@ GTA *gtaQuotientAndProject(GTA *g, unsigned idx, int quotient)
     ssInit(&sets[s], g->ss[s].size, 7);
   }
   
-  /* make nondeterministic automaton and prepare determinization */
+  /* make nondeterministic automaton and prepare determinization, one
+     variable at a time; the leaves are sets after the first one, and
+     each intermediate result has a manager of its own */
   for (s = 0; s < guide.numSs; s++) {
-    for (i = 0; i < g->ss[guide.muLeft[s]].size; i++)
-      for (j = 0; j < g->ss[guide.muRight[s]].size; j++) {
-	bdd_project(g->ss[s].bddm,
-		    BDD_ROOT(g->ss[s].bddm,
-			     g->ss[s].behaviour[i*g->ss[s].rs+j]),
-		    idx,
-		    res->ss[s].bddm,
-		    fn_union);
-	BM(b[s], i, j) = BDD_LAST_HANDLE(res->ss[s].bddm);
+    bdd_manager *from = g->ss[s].bddm, *to;
+    unsigned estimate = 2 * bdd_size(g->ss[s].bddm);
+
+    for (k = 0; k < n; k++) {
+      if (k == n - 1)
+	to = res->ss[s].bddm;
+      else {
+	to = bdd_new_manager(estimate, estimate/8 + 2);
+	bdd_make_cache(to, estimate, estimate/8 + 2);
       }
+      for (i = 0; i < g->ss[guide.muLeft[s]].size; i++)
+	for (j = 0; j < g->ss[guide.muRight[s]].size; j++) {
+	  bdd_project(from,
+		      BDD_ROOT(from, 
+			       k ? BM(b[s], i, j) : BEH(g->ss[s], i, j)),
+		      idx[k],
+		      to,
+		      fn_union);
+	  BM(b[s], i, j) = BDD_LAST_HANDLE(to);
+	}
+      if (k)
+	bdd_kill_manager(from);
+      from = to;
+    }
     b[s].lf = g->ss[guide.muLeft[s]].size;
     b[s].rf = g->ss[guide.muRight[s]].size;
   }
@@ -320,9 +342,7 @@ GTA *gtaQuotientAndProject(GTA *g, unsigned idx, int quotient)
 
     ss->initial = init[s]; 
     ss->size = ssSize(&sets[s]);
-    ss->ls = b[s].ls;
-    ss->rs = b[s].rs;
-    ss->behaviour = b[s].m;
+    moveBM(&b[s], ss);
   }
 
   /* set final status */
@@ -132,9 +132,7 @@ GTA *gtaReachable(GTA *g)
 
     ss->initial = 0; 
     ss->size = nextNewNumber[s];
-    ss->ls = resbeh[s].ls;
-    ss->rs = resbeh[s].rs;
-    ss->behaviour = resbeh[s].m;
+    moveBM(&resbeh[s], ss);
   }
 
   /* set final status */
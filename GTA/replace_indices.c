@@ -18,16 +18,28 @@
  * USA.
  */
 
+#include <stdlib.h>
 #include "gta.h"
 
 void gtaReplaceIndices(GTA *P, unsigned map[]) 
 {
   unsigned i,p1,p2;
   
+  invariant(P->refs == 1);
   for (i = 0; i < guide.numSs; i++) {
     unsigned rs = P->ss[guide.muRight[i]].size; 
     unsigned ls = P->ss[guide.muLeft[i]].size;
+    bdd_manager *bddm;
 
+    /* usually the manager is just renamed, see bdd.h, otherwise the
+       nodes are rewritten */
+    bddm = bdd_rename_manager(P->ss[i].bddm, map);
+    if (bddm) {
+      P->ss[i].bddm = bddm;
+      continue;
+    }
+
+    gtaUnshare(P, i);
     bdd_prepare_apply1(P->ss[i].bddm);
 
     for (p1 = 0; p1 < ls; p1++) 
@@ -19,11 +19,13 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "gta.h"
 
 void gtaRestrict(GTA *g)
 {
   int i;
+  invariant(g->refs == 1);
   for (i = 0; i < g->ss[0].size; i++)
     if (g->final[i] == -1)
       g->final[i] = 0; /* turn rejects into don't-cares */
@@ -32,6 +34,7 @@ void gtaRestrict(GTA *g)
 void gtaUnrestrict(GTA *g)
 {
   int i;
+  invariant(g->refs == 1);
   for (i = 0; i < g->ss[0].size; i++)
     if (g->final[i] == 0)
       g->final[i] = -1; /* turn don't-cares into rejects */
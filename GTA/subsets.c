@@ -22,6 +22,7 @@
 #include <stdio.h> /* for ssDump */
 #include <string.h>
 #include "../Mem/mem.h"
+#include "../Mem/arena.h"
 #include "subsets.h"
 
 extern long primes[]; /* defined in ../BDD/hash.c */
@@ -44,6 +45,7 @@ void ssInit(Subsets *s, unsigned singletons, unsigned initialCapacity)
   s->inverseAllocated = 0;
   s->num = 0;
   s->singletons = singletons;
+  s->mem = new_arena(0);
   s->t = (SubsetsEntry *) mem_alloc(sizeof(SubsetsEntry)*s->size);
   for (i = 0; i < s->size; i++) {
     s->t[i].length = 0; /* free mark */
@@ -53,19 +55,7 @@ void ssInit(Subsets *s, unsigned singletons, unsigned initialCapacity)
 
 void ssFree(Subsets *s)
 {
-  int i;
-  for (i = 0; i < s->size; i++) {
-    SubsetsEntry *e = s->t[i].overflow, *w;
-    while (e) {
-      w = e->overflow;
-      mem_free(e->elements);
-      invariant(s->inverse[e->n - s->singletons] = e);
-      mem_free(e);
-      e = w;
-    }
-    if (s->t[i].length != 0)
-      mem_free(s->t[i].elements);
-  }
+  free_arena(s->mem);
   mem_free(s->t);
   mem_free(s->inverse);
 }
@@ -94,7 +84,7 @@ int ssLookupAndInsert(Subsets *s, unsigned c1, unsigned c2, unsigned *n)
 
   if (c2 < s->singletons) {
     /* both c1 and c2 are singletons */
-    unionSet = (unsigned *) mem_alloc(sizeof(unsigned)*2);
+    unionSet = (unsigned *) arena_alloc(s->mem, sizeof(unsigned)*2);
     unionSet[len++] = c1;
     unionSet[len++] = c2;
   }
@@ -103,7 +93,7 @@ int ssLookupAndInsert(Subsets *s, unsigned c1, unsigned c2, unsigned *n)
     e1 = s->inverse[c1 - s->singletons];
     e2 = s->inverse[c2 - s->singletons];
     unionSet = 
-      (unsigned *) mem_alloc(sizeof(unsigned)*(e1->length + e2->length));
+      (unsigned *) arena_alloc(s->mem, sizeof(unsigned)*(e1->length + e2->length));
 
     while (i1 < e1->length && i2 < e2->length)
       if (e1->elements[i1] < e2->elements[i2])
@@ -121,7 +111,7 @@ int ssLookupAndInsert(Subsets *s, unsigned c1, unsigned c2, unsigned *n)
   else {
     /* c1 is singleton, c2 is non-singleton */
     e2 = s->inverse[c2 - s->singletons];
-    unionSet = (unsigned *) mem_alloc(sizeof(unsigned)*(e2->length+1));
+    unionSet = (unsigned *) arena_alloc(s->mem, sizeof(unsigned)*(e2->length+1));
 
     while (i2 < e2->length && c1 > e2->elements[i2])
       unionSet[len++] = e2->elements[i2++];
@@ -140,7 +130,7 @@ int ssLookupAndInsert(Subsets *s, unsigned c1, unsigned c2, unsigned *n)
 
       /* found it */
       *n = e->n;
-      mem_free(unionSet);
+      arena_unalloc(s->mem, unionSet);
       return 1;
     }
     eee = e;
@@ -150,7 +140,7 @@ int ssLookupAndInsert(Subsets *s, unsigned c1, unsigned c2, unsigned *n)
   /* NOT FOUND, INSERT IT */
 
   if (ee->length != 0) { /* main entry occupied? */
-    ee = (SubsetsEntry *) mem_alloc(sizeof(SubsetsEntry));
+    ee = (SubsetsEntry *) arena_alloc(s->mem, sizeof(SubsetsEntry));
     eee->overflow = ee;
     s->overflows++;
   } /* ee is now the new entry */
@@ -190,7 +180,7 @@ int ssLookupAndInsert(Subsets *s, unsigned c1, unsigned c2, unsigned *n)
     }
     /* rehash */
     for (i = 0; i < s->size; i++) { 
-      SubsetsEntry *w = &s->t[i], *ww;
+      SubsetsEntry *w = &s->t[i];
       if (w->length != 0)
 	while (w) {
 	  SubsetsEntry *d = &r[ssHash(w->elements, w->length, newsize)];
@@ -200,7 +190,7 @@ int ssLookupAndInsert(Subsets *s, unsigned c1, unsigned c2, unsigned *n)
 	    while (d->overflow)
 	      d = d->overflow;
 	    d->overflow = 
-	      (SubsetsEntry *) mem_alloc(sizeof(SubsetsEntry));
+	      (SubsetsEntry *) arena_alloc(s->mem, sizeof(SubsetsEntry));
 	    d = d->overflow;
 	    s->overflows++;
 	  }
@@ -211,10 +201,7 @@ int ssLookupAndInsert(Subsets *s, unsigned c1, unsigned c2, unsigned *n)
 	  d->c2 = w->c2;
 	  d->overflow = 0;
 	  s->inverse[d->n - s->singletons] = d;
-	  ww = w;
-	  w = w->overflow;
-	  if (ww != &s->t[i])
-	    mem_free(ww);
+	  w = w->overflow; /* old overflow entries stay in the arena */
 	}
     }
     mem_free(s->t);
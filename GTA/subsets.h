@@ -38,6 +38,7 @@ typedef struct {
   unsigned inverseAllocated;
   unsigned num; /* number of subsets excluding singletons */
   unsigned singletons; /* number of singleton sets */
+  struct arena_ *mem; /* element arrays and overflow entries */
 } Subsets;
 
 void ssInit(Subsets *s, unsigned singletons, unsigned initialCapacity);
@@ -0,0 +1,75 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../DFA/dfa.h"
+#include "../Mem/mem.h"
+
+/* converts between the text format written by 'mona -x' and the
+   binary format read by dfaImportBinary */
+
+int main(int argc, char *argv[])
+{
+  int reverse = argc == 4 && strcmp(argv[1], "-r") == 0;
+  char *in, *out, **names;
+  int *orders;
+  char *ords;
+  int i, num, ok;
+  DFA *a;
+
+  if (argc != 3 && !reverse) {
+    printf("usage: dfa2bin [-r] <dfa-file> <binary-file>\n"
+	   "  -r  convert from binary to text\n");
+    exit(-1);
+  }
+  in = argv[1 + reverse];
+  out = argv[2 + reverse];
+
+  a = reverse ?
+    dfaImportBinary(in, &names, &orders) :
+    dfaImport(in, &names, &orders);
+  if (!a) {
+    printf("dfa load error\n");
+    exit(-1);
+  }
+  for (num = 0; names[num]; num++);
+  ords = (char *) mem_alloc(num + 1);
+  for (i = 0; i < num; i++)
+    ords[i] = (char) orders[i];
+
+  ok = reverse ?
+    dfaExport(a, out, num, names, ords) :
+    dfaExportBinary(a, out, num, names, ords);
+  if (!ok) {
+    printf("unable to write to %s\n", out);
+    exit(-1);
+  }
+
+  for (i = 0; i < num; i++)
+    mem_free(names[i]);
+  mem_free(names);
+  mem_free(orders);
+  mem_free(ords);
+  dfaFree(a);
+
+  exit(0);
+}
@@ -0,0 +1,108 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#include "mem.h"
+#include "arena.h"
+
+#define ARENA_DEFAULT_BLOCK 4096
+#define ARENA_MAX_BLOCK (1 << 20)
+#define ARENA_HEADER \
+  ((sizeof(arena_block) + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1))
+
+static void arena_new_block(arena a, size_t s)
+{
+  arena_block *b;
+  if (s < a->block_size)
+    s = a->block_size;
+  if (a->block_size < ARENA_MAX_BLOCK) /* grow geometrically */
+    a->block_size *= 2;
+  mem_charge(ARENA_HEADER + s);
+  b = (arena_block *) mem_alloc(ARENA_HEADER + s);
+  b->next = a->block;
+  b->size = s;
+  a->block = b;
+  a->top = (char *) b + ARENA_HEADER;
+  a->end = a->top + s;
+}
+
+arena new_arena(size_t block_size)
+{
+  arena a = (arena) mem_alloc(sizeof *a);
+  a->block = 0;
+  a->block_size = block_size ? block_size : ARENA_DEFAULT_BLOCK;
+  arena_new_block(a, a->block_size);
+  return a;
+}
+
+/* slow path of arena_alloc: the current block is full; the rest of it
+   is abandoned */
+void *arena_grow(arena a, size_t s)
+{
+  char *x;
+  arena_new_block(a, s);
+  x = a->top;
+  a->top += s;
+  return x;
+}
+
+/* give back x, which must be the most recent allocation (used when a
+   tentatively built object turns out to exist already) */
+void arena_unalloc(arena a, void *x)
+{
+  if ((char *) x >= (char *) a->block + ARENA_HEADER && (char *) x < a->top)
+    a->top = (char *) x;
+}
+
+/* release all allocations, keeping the most recent block for reuse */
+void arena_clear(arena a)
+{
+  arena_block *b = a->block->next;
+  while (b) {
+    arena_block *n = b->next;
+    mem_discharge(ARENA_HEADER + b->size);
+    mem_free(b);
+    b = n;
+  }
+  a->block->next = 0;
+  a->top = (char *) a->block + ARENA_HEADER;
+  a->end = a->top + a->block->size;
+}
+
+void free_arena(arena a)
+{
+  arena_block *b = a->block;
+  while (b) {
+    arena_block *n = b->next;
+    mem_discharge(ARENA_HEADER + b->size);
+    mem_free(b);
+    b = n;
+  }
+  mem_free(a);
+}
+
+/* bytes held by the arena */
+size_t arena_size(arena a)
+{
+  size_t s = 0;
+  arena_block *b;
+  for (b = a->block; b; b = b->next)
+    s += ARENA_HEADER + b->size;
+  return s;
+}
@@ -0,0 +1,64 @@
+/*
+ * MONA
+ * Copyright (C) 1997-2013 Aarhus University.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the  Free Software
+ * Foundation, Inc., 51 Franklin Street, Suite 500, Boston, MA 02110-1335,
+ * USA.
+ */
+
+#ifndef __ARENA_H
+#define __ARENA_H
+
+#include <stddef.h>
+#include "gnuc.h"
+
+/* An arena hands out memory by bumping a pointer through large
+   blocks; nothing is freed individually, everything is released at
+   once with free_arena (or recycled with arena_clear).  Used for the
+   scratch structures that live exactly as long as one automaton
+   operation. */
+
+#define ARENA_ALIGN (2 * sizeof(void *))
+
+typedef struct arena_block_ {
+  struct arena_block_ *next; /* older block */
+  size_t size;               /* usable bytes after the header */
+} arena_block;
+
+typedef struct arena_ {
+  char *top, *end;           /* free space in the current block */
+  arena_block *block;        /* current block, chained to older ones */
+  size_t block_size;         /* size of the next fresh block */
+} *arena;
+
+arena new_arena(size_t block_size); /* 0 = default first block size */
+void *arena_grow(arena, size_t);
+void arena_unalloc(arena, void *);
+void arena_clear(arena);
+void free_arena(arena);
+size_t arena_size(arena);
+
+/* allocate s bytes, aligned to ARENA_ALIGN */
+static GNUC_INLINE void *arena_alloc(arena a, size_t s)
+{
+  char *x = a->top;
+  s = (s + ARENA_ALIGN - 1) & ~(ARENA_ALIGN - 1);
+  if ((size_t) (a->end - x) < s)
+    return arena_grow(a, s);
+  a->top = x + s;
+  return x;
+}
+
+#endif
@@ -24,12 +24,14 @@
 #if (! defined __GNUC__) || (__GNUC__ < 2) || (__GNUC__ == 2 && __GNUC_MINOR__ < 7)
 # define __attribute__(x)
 # define __inline__
+# define __thread
 #endif
 
 #define GNUC_NORETURN __attribute__ ((__noreturn__))
 #define GNUC_CONST __attribute__ ((__const__))
 #define GNUC_FORMAT(a,s,f) __attribute__ ((__format__ (a, s, f)))
 #define GNUC_INLINE __inline__
+#define GNUC_THREAD __thread
 
 #if (__GNUC__ > 2) || (__GNUC == 2 && __GNUC_MINOR >= 96)
 # define GNUC_PURE __attribute__ ((__pure__))
@@ -46,6 +48,7 @@
    GNUC_FORMAT:    printf-like argument check
    GNUC_MALLOC:    result is a fresh pointer
    GNUC_INLINE:    inline function
+   GNUC_THREAD:    one instance of the variable per thread
  */
 
 #endif
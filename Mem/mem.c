@@ -37,8 +37,21 @@ void updatemaxallocated()
 
 int memlimit = 0;
 
+static mem_error_handler error_handler;
+static size_t budget;
+static size_t charged, peak_charged; /* shared by all threads */
+
+mem_error_handler mem_set_error_handler(mem_error_handler h)
+{
+  mem_error_handler old = error_handler;
+  error_handler = h;
+  return old;
+}
+
 void mem_error()
 {
+  if (error_handler)
+    error_handler();
   if (memlimit)
     printf("\n\n-----\n"
            "Interactive Demo memory limit exceeded, execution stopped.\n");
@@ -47,6 +60,54 @@ void mem_error()
   exit(-1);
 }
 
+void mem_set_budget(size_t b)
+{
+  budget = b;
+}
+
+size_t mem_budget()
+{
+  return budget;
+}
+
+size_t mem_charged()
+{
+  return __atomic_load_n(&charged, __ATOMIC_RELAXED);
+}
+
+size_t mem_peak_charged()
+{
+  return __atomic_load_n(&peak_charged, __ATOMIC_RELAXED);
+}
+
+int mem_try_charge(size_t s)
+{
+  size_t c = __sync_add_and_fetch(&charged, s), p;
+  if (budget && c > budget) {
+    __sync_sub_and_fetch(&charged, s);
+    return 0;
+  }
+  while ((p = __atomic_load_n(&peak_charged, __ATOMIC_RELAXED)) < c &&
+	 !__sync_bool_compare_and_swap(&peak_charged, p, c));
+  return 1;
+}
+
+void mem_charge(size_t s)
+{
+  if (!mem_try_charge(s))
+    mem_error();
+}
+
+void mem_discharge(size_t s)
+{
+  __sync_sub_and_fetch(&charged, s);
+}
+
+int mem_pressure()
+{
+  return budget && mem_charged() > budget / 4 * 3;
+}
+
 void *mem_alloc(size_t s)
 {
 #ifdef USE_DLMALLOC
@@ -62,6 +123,25 @@ void *mem_alloc(size_t s)
   return x;
 }
 
+/* the block is released with mem_free; the alignment must be a power
+   of two and a multiple of sizeof(void *) */
+void *mem_alloc_aligned(size_t a, size_t s)
+{
+#ifdef USE_DLMALLOC
+  void *x = dlmemalign(a, s);
+#else
+  void *x;
+  if (posix_memalign(&x, a, s))
+    x = 0;
+#endif
+  if (!x)
+    mem_error();
+#ifdef MAXALLOCATED
+  updatemaxallocated();
+#endif
+  return x;
+}
+
 void mem_free(void *x)
 {
 #ifdef USE_DLMALLOC
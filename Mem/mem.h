@@ -31,7 +31,27 @@ extern int maxallocated;
 #endif
 
 void mem_error();
+
+/* mem_error calls the handler, if any, before giving up; a handler
+   that does not return (longjmp, or a C++ throw, the C modules being
+   compiled with -fexceptions) lets the program survive the failed
+   operation, whose partial results are lost */
+typedef void (*mem_error_handler)(void);
+mem_error_handler mem_set_error_handler(mem_error_handler);
+
+/* the memory budget, in bytes, 0 = none; the big tables (BDD node
+   tables and caches, arena blocks) are charged to it before they are
+   allocated and discharged when freed */
+void mem_set_budget(size_t);
+size_t mem_budget();
+size_t mem_charged();
+size_t mem_peak_charged();  /* the most charged at any time */
+void mem_charge(size_t);     /* calls mem_error if over budget */
+int mem_try_charge(size_t);  /* 0 (and nothing charged) if over budget */
+void mem_discharge(size_t);
+int mem_pressure();          /* more than 3/4 of the budget charged */
 void *mem_alloc(size_t);
+void *mem_alloc_aligned(size_t, size_t); /* alignment, size */
 void mem_free(void *);
 void *mem_resize(void *, size_t);
 void mem_copy(void *, void *, size_t);
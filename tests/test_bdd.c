@@ -1,9 +1,61 @@
 #include <stdio.h>
 #include "bdd.h"
 
+/* a node with the largest variable index survives the packing of the
+   node layout in use */
+static void largest_index(void) {
+    bdd_manager *bddm = bdd_new_manager(16, 4);
+    bdd_ptr l = bdd_find_leaf_hashed_add_root(bddm, 0);
+    bdd_ptr r = bdd_find_leaf_hashed_add_root(bddm, 1);
+    bdd_ptr p = bdd_find_node_hashed_add_root(bddm, l, r, BDD_MAX_INDEX);
+
+    printf("Largest index: %s\n",
+           (bdd_ifindex(bddm, p) == BDD_MAX_INDEX &&
+            bdd_else(bddm, p) == l && bdd_then(bddm, p) == r &&
+            !bdd_is_leaf(bddm, p) && bdd_is_leaf(bddm, r) &&
+            bdd_leaf_value(bddm, r) == 1) ? "ok" : "wrong");
+    bdd_kill_manager(bddm);
+}
+
+/* a renamed manager shows the composed renaming without touching the
+   nodes, a view leaves the other owners alone, and bdd_apply1 stores
+   the renamed indices */
+static void renaming(void) {
+    unsigned map1[4] = {0, 2, 0, 5}, map2[6] = {0, 0, 4, 0, 0, 6};
+    unsigned swap[4] = {0, 5, 0, 2};
+    bdd_manager *bddm = bdd_new_manager(16, 4), *view, *copy;
+    bdd_ptr l = bdd_find_leaf_hashed_add_root(bddm, 0);
+    bdd_ptr r = bdd_find_leaf_hashed_add_root(bddm, 1);
+    bdd_ptr p = bdd_find_node_hashed_add_root(bddm, l, r, 3);
+    bdd_ptr q = bdd_find_node_hashed_add_root(bddm, p, r, 1);
+    bdd_ptr c;
+    int ok;
+
+    view = bdd_rename_manager(bdd_share_manager(bddm), map1);
+    ok = view && view != bddm &&
+        bdd_ifindex(view, q) == 2 && bdd_ifindex(view, p) == 5 &&
+        bdd_ifindex(bddm, q) == 1 && bdd_ifindex(bddm, p) == 3;
+    view = bdd_rename_manager(view, map2);
+    ok = ok && view && bdd_ifindex(view, q) == 4 && bdd_ifindex(view, p) == 6;
+    ok = ok && !bdd_rename_manager(bddm, swap);
+
+    copy = bdd_new_manager(16, 4);
+    bdd_prepare_apply1(view);
+    c = bdd_apply1(view, q, copy, &fn_identity);
+    ok = ok && !bdd_manager_renamed(copy) && bdd_ifindex(copy, c) == 4 &&
+        bdd_ifindex(copy, bdd_else(copy, c)) == 6;
+
+    printf("Renaming: %s\n", ok ? "ok" : "wrong");
+    bdd_kill_manager(copy);
+    bdd_kill_manager(view);
+    bdd_kill_manager(bddm);
+}
+
 int main() {
     printf("Testing monabdd\n");
     bdd_init();
+    largest_index();
+    renaming();
     
     return 0;
-}
\ No newline at end of file
+}
@@ -1,10 +1,230 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
 #include "dfa.h"
+#include "mem.h"
+
+/* decide a small formula in a private engine context */
+static void *decide(void *arg) {
+    dfaContext *ctx = dfaNewContext();
+    DFA *a, *b, *p, *m;
+
+    dfaUseContext(ctx);
+    a = dfaLess(0, 1);
+    b = dfaLess(1, 2);
+    p = dfaProductCtx(ctx, a, b, dfaAND);
+    m = dfaMinimizeCtx(ctx, p);
+    *(int *) arg = m->ns;
+    dfaFree(a);
+    dfaFree(b);
+    dfaFree(p);
+    dfaFree(m);
+    dfaUseContext(NULL);
+    dfaFreeContext(ctx);
+    return NULL;
+}
+
+/* a conjunction and a disjunction of several automata, all at once and
+   pairwise */
+static void product_list(void) {
+    DFA *a[4], *p, *q, *m;
+    int i;
+
+    a[0] = dfaLess(0, 1);
+    a[1] = dfaLess(1, 2);
+    a[2] = dfaLess(2, 3);
+    a[3] = dfaFirstOrder(3);
+    p = dfaProductList(a, 4, dfaAND);
+    m = dfaMinimize(p);
+    printf("Product of 4: %d states\n", m->ns);
+    dfaFree(p);
+    dfaFree(m);
+    p = dfaCopy(a[0]);
+    for (i = 1; i < 4; i++) {
+        q = dfaProduct(p, a[i], dfaAND);
+        dfaFree(p);
+        p = dfaMinimize(q);
+        dfaFree(q);
+    }
+    printf("Pairwise product: %d states\n", p->ns);
+    dfaFree(p);
+    /* combined in the order of the cost model, not the given one */
+    p = dfaProductList(a, 4, dfaOR);
+    m = dfaMinimize(p);
+    printf("Disjunction of 4: %d states\n", m->ns);
+    dfaFree(p);
+    dfaFree(m);
+    p = dfaCopy(a[3]);
+    for (i = 0; i < 3; i++) {
+        q = dfaProduct(p, a[i], dfaOR);
+        dfaFree(p);
+        p = dfaMinimize(q);
+        dfaFree(q);
+    }
+    printf("Pairwise disjunction: %d states\n", p->ns);
+    dfaFree(p);
+    for (i = 0; i < 4; i++)
+        dfaFree(a[i]);
+}
+
+static void minimization(void) {
+    DFA *x = dfaPlus1(0, 1, 3), *y = dfaLess(1, 2), *a, *m;
+    int i;
+
+    a = dfaProduct(x, y, dfaAND);
+    dfaFree(x);
+    dfaFree(y);
+
+    for (i = 0; i < 2; i++) {
+        dfaSetMinimization(i ? dfaITERATE : dfaREFINE);
+        m = dfaMinimize(a);
+        printf("%s: %d states\n", i ? "Iterate" : "Refine", m->ns);
+        dfaFree(m);
+    }
+    dfaSetMinimization(dfaREFINE);
+    dfaFree(a);
+}
+
+/* write an automaton in the binary format and read it back */
+static void binary_roundtrip(void) {
+    char file[] = "/tmp/test_dfaXXXXXX";
+    char *names[] = {"X", "Y"}, orders[] = {2, 2}, **vars;
+    int fd = mkstemp(file), *ords;
+    DFA *a = dfaLess(0, 1), *b;
+
+    close(fd);
+    if (!dfaExportBinary(a, file, 2, names, orders) ||
+        !(b = dfaImportBinary(file, &vars, &ords))) {
+        printf("Binary roundtrip failed\n");
+        unlink(file);
+        return;
+    }
+    printf("Binary roundtrip: %d states, variables %s %s\n",
+           b->ns, vars[0], vars[1]);
+    dfaPrintVerbose(b);
+    unlink(file);
+    mem_free(vars[0]);
+    mem_free(vars[1]);
+    mem_free(vars);
+    mem_free(ords);
+    dfaFree(a);
+    dfaFree(b);
+}
+
+/* two variables projected away at once, from a product made for it, and
+   one at a time */
+static void project_list(void) {
+    DFA *a[3], *p, *q, *m;
+    unsigned indices[] = {1, 2}, i;
+    int size[2];
+
+    a[0] = dfaLess(0, 1);
+    a[1] = dfaLess(1, 2);
+    a[2] = dfaLess(2, 3);
+    p = dfaProductList(a, 3, dfaAND);
+    q = dfaCopy(p);
+    dfaRightQuotientList(q, 2, indices);
+    m = dfaProjectList(q, 2, indices);
+    dfaFree(q);
+    q = dfaMinimize(m);
+    printf("Projected at once: %d states, status %d\n", q->ns, dfaStatus(q));
+    dfaFree(m);
+    dfaFree(q);
+    q = dfaProduct(a[0], a[1], dfaAND);
+    m = dfaProductProject(q, a[2], dfaAND, 2, indices, size);
+    dfaFree(q);
+    q = dfaMinimize(m);
+    printf("Product projected: %d states, status %d, from %d states\n",
+           q->ns, dfaStatus(q), size[0]);
+    dfaFree(m);
+    dfaFree(q);
+    for (i = 0; i < 2; i++) {
+        dfaRightQuotient(p, indices[i]);
+        q = dfaProject(p, indices[i]);
+        dfaFree(p);
+        p = dfaMinimize(q);
+        dfaFree(q);
+    }
+    printf("One at a time: %d states, status %d\n", p->ns, dfaStatus(p));
+    dfaFree(p);
+    for (i = 0; i < 3; i++)
+        dfaFree(a[i]);
+}
+
+/* the graph of an automaton, kept with it, and prefix closure */
+static void successor_graph(void) {
+    DFA *a = dfaLess(0, 1);
+    dfaGraph *g = dfaSuccessorGraph(a);
+    int i, j;
+
+    for (i = 0; i < g->ns; i++) {
+        printf("State %d: successors", i);
+        for (j = g->succ_at[i]; j < g->succ_at[i+1]; j++)
+            printf(" %d", g->succ[j]);
+        printf(", predecessors");
+        for (j = g->pred_at[i]; j < g->pred_at[i+1]; j++)
+            printf(" %d", g->pred[j]);
+        printf("\n");
+    }
+    printf("Kept: %s\n", dfaSuccessorGraph(a) == g ? "yes" : "no");
+    dfaPrefixClose(a);
+    printf("Prefix closed:");
+    for (i = 0; i < a->ns; i++)
+        printf(" %d", a->f[i]);
+    printf("\n");
+    dfaFree(a);
+}
+
+/* the verdict and examples of a lazy product and projection */
+static void lazy_analysis(void) {
+    char *names[] = {"X", "Y", "Z"}, orders[] = {1, 1, 1};
+    unsigned indices[] = {0, 1, 2};
+    DFA *a = dfaLess(0, 1), *b = dfaLess(1, 2), *p, *q;
+    dfaLazy *z;
+    int n;
+
+    p = dfaProduct(a, b, dfaAND);
+    q = dfaProject(p, 1);
+    printf("Eager:\n");
+    dfaAnalyze(q, 3, names, indices, orders, 0);
+    dfaFree(p);
+    dfaFree(q);
+
+    dfaRightQuotient(a, 1);
+    z = dfaLazyProject(dfaLazyProduct(dfaLazyAutomaton(a),
+                                      dfaLazyAutomaton(b), dfaAND), 1);
+    printf("Lazy:\n");
+    n = dfaLazyAnalyze(z, 3, names, indices, orders, 0);
+    printf("%d states explored\n", n);
+    dfaLazyFree(z);
+
+    z = dfaLazyNegation(dfaLazyAutomaton(dfaLess(0, 1)));
+    printf("Lazy negation:\n");
+    dfaLazyAnalyze(z, 2, names, indices, orders, 0);
+    dfaLazyFree(z);
+}
 
 int main() {
+    pthread_t threads[2];
+    int states[2], i;
+
     printf("Testing monadfa\n");
     DFA *dfa = dfaTrue();
     dfaPrintVerbose(dfa);
     dfaFree(dfa);
+
+    for (i = 0; i < 2; i++)
+        pthread_create(&threads[i], NULL, decide, &states[i]);
+    for (i = 0; i < 2; i++) {
+        pthread_join(threads[i], NULL);
+        printf("Thread %d: %d states\n", i, states[i]);
+    }
+    product_list();
+    minimization();
+    binary_roundtrip();
+    project_list();
+    successor_graph();
+    lazy_analysis();
     return 0;
 }
@@ -8,6 +8,7 @@
 #include "untyped.h"
 
 #include "model.h"
+#include "session.h"
 #include "utils.h"
 
 Options options;
@@ -140,6 +141,75 @@ int main() {
         printf("}\n");
     }
 
+    {
+        // the same query twice in a session, then one in a scope with a
+        // variable of its own
+        Session session;
+        std::optional<Model> first = session.getModel(*ast);
+        std::optional<Model> second = session.getModel(*ast);
+        std::cout << "Session: "
+                  << (first.has_value() && second.has_value() &&
+                      first->ints == second->ints &&
+                      first->sets == second->sets ? "same" : "different")
+                  << " models\n";
+
+        session.push();
+        Ident zId = addVar("z", Varname1);
+        auto zVar = std::make_shared<ASTTerm1_Var1>(zId);
+        std::unique_ptr<MonaAST> scoped = std::make_unique<MonaAST>(
+            std::make_shared<ASTForm_And>(
+                withP,
+                std::make_shared<ASTForm_Less>(zVar, bVar)));
+        for (Ident id : ast->globals)
+            scoped->globals.insert(id);
+        scoped->globals.insert(zId);
+        std::optional<Model> third = session.getModel(*scoped);
+        std::cout << "Scope " << session.scopes() << ": z = "
+                  << third.value().ints["z"] << "\n";
+        session.pop();
+        std::cout << "Scopes left: " << session.scopes() << "\n";
+        session.printStatistics();
+    }
+
+    {
+        // all models of x < c & c = 5, projected onto x, and the first
+        // few of them with c
+        std::unique_ptr<MonaAST> below = std::make_unique<MonaAST>(
+            std::make_shared<ASTForm_And>(
+                cIs5,
+                std::make_shared<ASTForm_Less>(xVar, cVar)));
+        below->globals.insert(cId);
+        below->globals.insert(xId);
+        IdentList onlyX(xId);
+        std::cout << "Models:";
+        for (Model &m : getModels(*below, 10, &onlyX))
+            std::cout << " x = " << m.ints["x"];
+        std::cout << "\n";
+        ModelEnumerator models(*below);
+        for (int i = 0; i < 3; i++) {
+            std::optional<Model> m = models.next();
+            std::cout << "Model " << i << ": c = " << m->ints["c"]
+                      << ", x = " << m->ints["x"] << "\n";
+        }
+    }
+
+    {
+        // a budget too small for the query fails it, and the session
+        // answers it once the budget is lifted
+        Session session;
+        session.setMemoryBudget(4096);
+        try {
+            session.getModel(*ast);
+            std::cout << "Budget: not exceeded\n";
+        } catch (const MemoryLimitExceeded &e) {
+            std::cout << "Budget: " << e.what() << "\n";
+        }
+        session.setMemoryBudget(0);
+        std::cout << "Without budget: "
+                  << (session.getModel(*ast).has_value() ? "model" : "none")
+                  << "\n";
+    }
+
     predicateLib.remove(pred);
 
     return 0;
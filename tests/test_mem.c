@@ -1,9 +1,30 @@
 #include <stdio.h>
 
 #include "mem.h"
+#include "arena.h"
 
 int main() {
     printf("Testing monamem\n");
+
+    arena a = new_arena(64);
+    int i, *first = 0, *p = 0, ok = 1;
+    for (i = 0; i < 1000; i++) {
+        p = arena_alloc(a, sizeof(int) * (i % 7 + 1));
+        if ((size_t) p % ARENA_ALIGN)
+            ok = 0;
+        p[0] = i;
+        if (!first)
+            first = p;
+    }
+    arena_unalloc(a, p);
+    if (arena_alloc(a, sizeof(int)) != p)
+        ok = 0;
+    printf("Arena: %s, first = %d, %lu bytes\n",
+           ok ? "aligned" : "misaligned", *first, (unsigned long) arena_size(a));
+    arena_clear(a);
+    printf("Arena after clear: %lu bytes\n", (unsigned long) arena_size(a));
+    free_arena(a);
+
     mem_error();
     return 0;
-}
\ No newline at end of file
+}